@@ -2,6 +2,8 @@
 
 #include <Arduino.h>
 
+#include "effect_ids.h"
+
 // Button pins - directly mapped to GPIO numbers
 // GPIO 2 needs external pull-up resistor (10k to 3.3V) - onboard LED pulls it LOW
 // Set to 255 to disable a button slot
@@ -58,12 +60,10 @@ namespace Instrument
     constexpr uint16_t kBaesse      = 0x0080;  // Register 7 - bit 7
 }
 
-// Command codes (same as nano constants.h)
+// Command codes (same as nano constants.h), effect IDs come from effect_ids.h
 namespace Cmd
 {
     constexpr uint8_t kStateBlackout = 0x14;
-    constexpr uint8_t kEffectBlink = 0x21;
-    constexpr uint8_t kEffectSolid = 0x20;
 }
 
 // Flags (lower 4 bits of flags byte)
@@ -74,10 +74,12 @@ namespace Flag
     constexpr uint8_t kNoRebroadcast = 0x08;
 }
 
-// TTL configuration (upper 4 bits of flags byte)
+// Flags byte: source (bits 7-6), TTL (bits 5-4), flags (bits 3-0)
 constexpr uint8_t kDefaultTTL = 2;  // 2 hops for applausmaschine
 constexpr uint8_t kTTLShift = 4;
+constexpr uint8_t kSourceId = 2;  // applausmaschine, Nanos dedup SEQs per source
+constexpr uint8_t kSourceShift = 6;
 
 inline uint8_t MakeFlagsByte(uint8_t ttl, uint8_t flags) {
-    return ((ttl << kTTLShift) & 0xF0) | (flags & 0x0F);
+    return (kSourceId << kSourceShift) | ((ttl << kTTLShift) & 0x30) | (flags & 0x0F);
 }
@@ -70,7 +70,7 @@ bool sendCommand(uint8_t effect, uint16_t groups, uint8_t r, uint8_t g, uint8_t
     frame[1] = sequenceNumber & 0xFF;
     sequenceNumber++;
 
-    // Flags byte: upper 4 bits = TTL, lower 4 bits = flags
+    // Flags byte: bits 7-6 = source, bits 5-4 = TTL, bits 3-0 = flags
     frame[2] = MakeFlagsByte(ttl, flags);
 
     // Effect/Command
@@ -2,6 +2,8 @@
 
 #include <Arduino.h>
 
+#include "effect_ids.h"
+
 // Button pins - same as applausmaschine
 // GPIO 2 needs external pull-up resistor (10k to 3.3V) - onboard LED pulls it LOW
 // Set to 255 to disable a button slot
@@ -39,29 +41,10 @@ namespace Group
     constexpr uint16_t kBroadcast = 0xFFFF;
 }
 
-// Command codes (same as nano constants.h)
+// Command codes (same as nano constants.h), effect IDs come from effect_ids.h
 namespace Cmd
 {
     constexpr uint8_t kStateBlackout = 0x14;
-    constexpr uint8_t kEffectSolid = 0x20;
-    constexpr uint8_t kEffectBlink = 0x21;
-    constexpr uint8_t kEffectRainbow = 0x23;
-    constexpr uint8_t kEffectRainbowCycle = 0x24;
-    constexpr uint8_t kEffectChase = 0x25;
-    constexpr uint8_t kEffectTheaterChase = 0x26;
-    constexpr uint8_t kEffectTwinkle = 0x27;
-    constexpr uint8_t kEffectFire = 0x29;
-    constexpr uint8_t kEffectPulse = 0x2A;
-    constexpr uint8_t kEffectWave = 0x2D;
-    constexpr uint8_t kEffectMeteor = 0x2E;
-    constexpr uint8_t kEffectBounce = 0x31;
-    constexpr uint8_t kEffectScanner = 0x33;
-    constexpr uint8_t kEffectConfetti = 0x34;
-    constexpr uint8_t kEffectLightning = 0x35;
-    constexpr uint8_t kEffectPolice = 0x36;
-    constexpr uint8_t kEffectStacking = 0x37;
-    constexpr uint8_t kEffectRipple = 0x39;
-    constexpr uint8_t kEffectPlasma = 0x3A;
 }
 
 // Demo mode effects array
@@ -92,12 +75,14 @@ namespace Flag
     constexpr uint8_t kPriority = 0x01;
 }
 
-// TTL configuration (upper 4 bits of flags byte)
+// Flags byte: source (bits 7-6), TTL (bits 5-4), flags (bits 3-0)
 constexpr uint8_t kDefaultTTL = 2;
 constexpr uint8_t kTTLShift = 4;
+constexpr uint8_t kSourceId = 1;  // crowdcontrol, Nanos dedup SEQs per source
+constexpr uint8_t kSourceShift = 6;
 
 inline uint8_t MakeFlagsByte(uint8_t ttl, uint8_t flags) {
-    return ((ttl << kTTLShift) & 0xF0) | (flags & 0x0F);
+    return (kSourceId << kSourceShift) | ((ttl << kTTLShift) & 0x30) | (flags & 0x0F);
 }
 
 // =============================================================================
@@ -0,0 +1,31 @@
+// Generated by nano/generate_effects.py from nano/effects.json - do not edit
+#pragma once
+
+#include <Arduino.h>
+
+namespace Cmd
+{
+   constexpr uint8_t kEffectSolid        = 0x20;
+   constexpr uint8_t kEffectBlink        = 0x21;
+   constexpr uint8_t kEffectRainbow      = 0x23;
+   constexpr uint8_t kEffectRainbowCycle = 0x24;
+   constexpr uint8_t kEffectChase        = 0x25;
+   constexpr uint8_t kEffectTheaterChase = 0x26;
+   constexpr uint8_t kEffectTwinkle      = 0x27;
+   constexpr uint8_t kEffectFire         = 0x29;
+   constexpr uint8_t kEffectPulse        = 0x2A;
+   constexpr uint8_t kEffectGradient     = 0x2C;
+   constexpr uint8_t kEffectWave         = 0x2D;
+   constexpr uint8_t kEffectMeteor       = 0x2E;
+   constexpr uint8_t kEffectDna          = 0x30;
+   constexpr uint8_t kEffectBounce       = 0x31;
+   constexpr uint8_t kEffectColorWipe    = 0x32;
+   constexpr uint8_t kEffectScanner      = 0x33;
+   constexpr uint8_t kEffectConfetti     = 0x34;
+   constexpr uint8_t kEffectLightning    = 0x35;
+   constexpr uint8_t kEffectPolice       = 0x36;
+   constexpr uint8_t kEffectStacking     = 0x37;
+   constexpr uint8_t kEffectMarquee      = 0x38;
+   constexpr uint8_t kEffectRipple       = 0x39;
+   constexpr uint8_t kEffectPlasma       = 0x3A;
+}
@@ -2,18 +2,49 @@
 #define CONSTANTS_H
 #define MSG_TYPE_PAIRING 0x01
 #define MSG_TYPE_CONFIG_ACK 0x02
+#define MSG_TYPE_TIME 0x03
+#define MSG_TYPE_SERIAL_MODE 0x04
+#define MSG_TYPE_TIMELINE 0x05
+#define MSG_TYPE_LOG 0x06
+#define MSG_TYPE_STATS 0x07
+#define MSG_TYPE_ECHO 0x08
+#define MSG_TYPE_STRESS 0x09
+#define MSG_TYPE_TELEMETRY 0x0A
 #define CMD_PAIRING_REQUEST 0xA0
+#define CMD_STATUS_BEACON 0xA1
 #define CMD_CONFIG_ACK 0x83
 #define CMD_PAIRING_ACK 0x81
 #define CMD_CONFIG_SET 0x82
+#define CMD_DEBUG_ECHO 0xF0
+#define CMD_DEBUG_STRESS 0xF2
+#define CMD_SERIAL_MODE 0xF8
+#define CMD_LOG_LEVEL 0xF9
+#define CMD_STATS 0xFA
 #define CONFIG_FRAME_SIZE 24
 
 #include <cstdint>
 
 constexpr uint8_t SERIAL_START_BYTE = 0xAA;
 constexpr uint8_t SERIAL_FRAME_SIZE = 18;
+// Timed frame: START + 16-byte payload + execute-at (uint32 ms network time) + CHK
+constexpr uint8_t SERIAL_TIMED_START_BYTE = 0xAC;
+constexpr uint8_t SERIAL_TIMED_FRAME_SIZE = 22;
+constexpr uint8_t EXECUTE_AT_SIZE = 4;
 constexpr uint8_t ESPNOW_PAYLOAD_SIZE = 16;
 constexpr uint32_t SERIAL_BAUD_RATE = 115200;
+constexpr size_t SERIAL_RX_BUFFER_SIZE = 2048;
+
+// Fast link, negotiated by the hub with a legacy CMD_SERIAL_MODE frame.
+// COBS packets delimited by 0x00, decoded:
+//   [type][count][count x ([len][16-byte payload + optional execute-at])][CRC-16 BE]
+constexpr uint8_t LINK_PACKET_COMMANDS = 0x01;
+constexpr uint8_t LINK_PACKET_TIMELINE = 0x02;   // [start index u16][n][n x (offset ms u32 + 16-byte payload)]
+constexpr uint8_t LINK_PACKET_TRANSPORT = 0x03;  // [action][a u32][b u32]
+constexpr uint8_t LINK_PACKET_SCENES = 0x04;     // one scene store/trigger frame, broadcast as is
+constexpr size_t LINK_MAX_PACKET_SIZE = 1024;
+constexpr uint32_t LINK_IDLE_TIMEOUT_MS = 12000;  // back to legacy 115200 without valid packets
+constexpr uint32_t LINK_BAUD_RATES[] = {115200, 230400, 460800, 921600};
+constexpr uint8_t LINK_BAUD_RATE_COUNT = 4;
 constexpr uint8_t ESPNOW_CHANNEL = 11;
 
 constexpr uint8_t LED_PIN = 2;
@@ -22,8 +53,118 @@ constexpr uint8_t BOOT_BUTTON_PIN = 0;
 constexpr uint32_t FRAME_TIMEOUT_MS = 100;
 constexpr uint32_t INIT_FAIL_REBOOT_MS = 5000;
 constexpr uint32_t TEST_FRAME_INTERVAL_MS = 2000;
+
+// Echo benchmark: the hub sends CMD_DEBUG_ECHO with a probe id in [6-7] and the
+// Nano MAC in [10-15]. The Nano answers with
+//   [0xF0][probe id u16][synced][rx network time us u32][processing us u32]
+// and the gateway reports the stages as MSG_TYPE_ECHO.
+constexpr uint8_t ECHO_REPLY_SIZE = 12;
+constexpr uint8_t ECHO_REPORT_SIZE = 22;  // probe id + 5 x uint32 stages, sent up as MSG_TYPE_ECHO
+constexpr uint32_t ECHO_UNSYNCED = 0xFFFFFFFF;  // air split unknown, Nano has no network time
+
+// Stress test: CMD_DEBUG_STRESS with the action in [8]. START carries the rate
+// (frames/s) in [6-7] and the frame count in [10-11] (0 = until STOP). The
+// radio task then broadcasts numbered DATA frames, SEQ 1.. from source GW.
+// Nanos answer REPORT with [0xF2][6 x uint32 counters], sent up as MSG_TYPE_STRESS.
+constexpr uint8_t STRESS_DATA = 0x00;
+constexpr uint8_t STRESS_START = 0x01;
+constexpr uint8_t STRESS_STOP = 0x02;
+constexpr uint8_t STRESS_REPORT = 0x03;
+constexpr uint16_t STRESS_MAX_RATE = 1000;
+constexpr uint32_t STRESS_START_DELAY_US = 100000;  // relayed STARTs reach far Nanos first
+constexpr uint8_t STRESS_REPORT_SIZE = 25;
+
+// Status beacons from the Nanos (17 bytes, 0xA1 first) are collected and sent up as
+//   [0xBB][0x0A][length][n x (MAC + beacon without 0xA1)][CRC-8]
+// once the batch is full or its first beacon is TELEMETRY_FLUSH_MS old.
+constexpr uint8_t TELEMETRY_BEACON_SIZE = 17;
+constexpr uint8_t TELEMETRY_ENTRY_SIZE = 6 + TELEMETRY_BEACON_SIZE - 1;
+constexpr uint8_t TELEMETRY_BATCH_MAX = 11;  // fits the length byte
+constexpr uint32_t TELEMETRY_FLUSH_MS = 1000;
 constexpr uint32_t LED_BLINK_DURATION_MS = 20;
 
+constexpr uint8_t FLAG_SYNC = 0x04;
+constexpr uint8_t FLAG_NO_REBROADCAST = 0x08;
+constexpr uint8_t SYNC_FRAME_SIZE = 20;
+
+// Batch frame: [marker][count][start time (uint32 ms)][count x 16-byte payload]
+// Commands arriving within BATCH_WINDOW_MS share one ESP-NOW transmission.
+constexpr uint8_t BATCH_MARKER = 0xB5;
+constexpr uint8_t BATCH_HEADER_SIZE = 6;
+constexpr uint8_t BATCH_MAX_COMMANDS = 15;
+constexpr uint8_t BATCH_FRAME_MAX_SIZE = BATCH_HEADER_SIZE + BATCH_MAX_COMMANDS * ESPNOW_PAYLOAD_SIZE;
+constexpr uint32_t BATCH_WINDOW_MS = 5;
+
+// Scene frames from the hub (LINK_PACKET_SCENES), see PROTOCOL.md:
+// [marker][count][flags][seq u16][table u16]..., broadcast unchanged
+constexpr uint8_t SCENE_STORE_MARKER = 0xB7;
+constexpr uint8_t SCENE_TRIGGER_MARKER = 0xB6;
+constexpr uint8_t SCENE_HEADER_SIZE = 7;
+
+// Flags byte: [source 2 bits][TTL 2 bits][flags 4 bits]. The timeline player
+// sends as its own source, replayed cues must not collide with hub SEQs.
+constexpr uint8_t SOURCE_MASK = 0xC0;
+constexpr uint8_t SOURCE_SHIFT = 6;
+constexpr uint8_t SOURCE_GATEWAY = 3;
+
+// Cue timeline, uploaded over the fast link and played from RAM
+constexpr uint16_t TIMELINE_MAX_ENTRIES = 2048;
+constexpr uint8_t TIMELINE_ENTRY_SIZE = 4 + ESPNOW_PAYLOAD_SIZE;
+constexpr uint32_t TIMELINE_LEAD_MS = 100;  // cues go out this early as SYNC frames
+constexpr uint16_t TIMELINE_TEMPO_MIN = 250;
+constexpr uint16_t TIMELINE_TEMPO_MAX = 4000;
+constexpr uint8_t TIMELINE_ACK_OK = 0x00;
+constexpr uint8_t TIMELINE_ACK_REJECTED = 0x01;
+
+// Transmit queue, drained one frame at a time as send callbacks come in
+constexpr uint8_t TX_QUEUE_SIZE = 16;
+constexpr uint8_t TX_MAX_RETRIES = 3;
+constexpr uint32_t TX_MAX_AGE_MS = 150;      // older frames are stale and dropped unsent
+constexpr uint32_t TX_SEND_TIMEOUT_MS = 20;  // no send callback by then, count as failed
+constexpr uint32_t TX_STALE_CALLBACK_MS = 200;  // late callback of a timed-out send never came, resume
+constexpr uint32_t TX_STATS_INTERVAL_MS = 10000;
+
+// Unicast config traffic. Peers stay registered until their slot is needed
+// and only frames without pending sends are evicted (least recently used).
+constexpr uint8_t PEER_CACHE_SIZE = 16;      // ESP-NOW allows 20 peers, one is broadcast
+constexpr uint8_t UNICAST_QUEUE_SIZE = 16;
+constexpr uint8_t UNICAST_INBOX_SIZE = 16;
+constexpr uint32_t UNICAST_INBOX_WAIT_MS = 50; // serial task waits rather than dropping config
+constexpr uint8_t TX_BROADCASTS_PER_UNICAST = 4; // a waiting unicast goes out after at most this many broadcasts
+
+// Tasks: serial parsing and upstream on the APP core, radio next to WiFi on the PRO core
+constexpr uint8_t SERIAL_TASK_CORE = 1;
+constexpr uint8_t SERIAL_TASK_PRIORITY = 3;
+constexpr uint32_t SERIAL_TASK_STACK_SIZE = 6144;
+constexpr uint8_t RADIO_TASK_CORE = 0;
+constexpr uint8_t RADIO_TASK_PRIORITY = 4;
+constexpr uint32_t RADIO_TASK_STACK_SIZE = 6144;
+constexpr uint8_t UPSTREAM_TASK_CORE = 1;
+constexpr uint8_t UPSTREAM_TASK_PRIORITY = 2;
+constexpr uint32_t UPSTREAM_TASK_STACK_SIZE = 4096;
+
+constexpr uint8_t TX_INBOX_SIZE = 8;        // serial task -> radio task
+constexpr uint8_t UPSTREAM_QUEUE_SIZE = 32; // all tasks and callbacks -> upstream task
+constexpr uint8_t UPSTREAM_LOG_SIZE = 96;
+constexpr uint8_t UPSTREAM_DATA_SIZE = 24;  // largest fixed-size frame is the stress report
+
+// Log frame: [0xBB][0x06][level][length][text][CRC-8]. Records carry a format
+// string and up to LOG_MAX_ARGS values, the upstream task formats them.
+constexpr uint8_t LOG_MAX_ARGS = 8;
+constexpr uint32_t LOG_BURST = 20;
+constexpr uint32_t LOG_REFILL_MS = 50;  // one more line every 50 ms after a burst
+
+// Stats frame: [0xBB][0x07][length][counters, big-endian][CRC-8], see writeStatsFrame()
+constexpr uint8_t STATS_LATENCY_BUCKETS = 8;
+constexpr uint32_t STATS_LATENCY_BOUNDS_US[STATS_LATENCY_BUCKETS - 1] = {1000, 2000, 5000, 10000, 20000, 50000, 100000};
+constexpr uint32_t STATS_RATE_INTERVAL_MS = 1000;
+
+// Time beacon: [marker][id][ttl][gateway time in us (int64, big-endian)]
+constexpr uint8_t TIME_BEACON_MARKER = 0xB0;
+constexpr uint8_t TIME_BEACON_SIZE = 11;
+constexpr uint8_t TIME_BEACON_TTL = 1;
+constexpr uint32_t TIME_BEACON_INTERVAL_MS = 1000;
+
 constexpr bool ESPNOW_LONG_RANGE_ENABLED = true;
 constexpr int8_t ESPNOW_TX_POWER_DBM = 20;
 
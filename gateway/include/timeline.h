@@ -0,0 +1,59 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Cue timeline player. The hub uploads (offset ms, 16-byte payload) entries
+ * over the fast link and only sends transport commands during the show.
+ * Cues leave TIMELINE_LEAD_MS early as SYNC frames carrying their exact
+ * network start time, so Nanos fire them on the network clock no matter how
+ * the radio queue or mesh delays each copy.
+ *
+ * Upload and transport run in the serial task, frame generation in the radio
+ * task. All state is guarded by a mutex.
+ */
+
+enum class TimelineAction : uint8_t
+{
+  PLAY = 0x01,  // a = position ms, b = network start time ms (0 = now + lead)
+  STOP = 0x02,
+  SEEK = 0x03,  // a = position ms, b = network time ms (0 = now + lead)
+  TEMPO = 0x04  // a = speed in permille, 1000 = as uploaded
+};
+
+/**
+ * @brief Creates the mutex and the wake-up timer
+ * @param wake Called from the esp_timer task when the next cue is due
+ */
+void initTimeline(void (*wake)());
+
+/**
+ * @brief Stores uploaded entries, only while stopped
+ * @param data Chunk body: [start index u16][n][n x (offset ms u32 + 16-byte payload)]
+ * @param count Entries stored so far, the hub continues from there
+ * @returns false if the chunk was rejected
+ *
+ * Start index 0 begins a new timeline. Chunks not continuing the stored
+ * entries are ignored, so a repeated chunk is acked again without harm.
+ */
+bool storeTimelineChunk(const uint8_t *data, size_t len, uint16_t &count);
+
+/**
+ * @brief Handles a transport command from the hub
+ * @param nowMs Current network time in ms
+ * @returns false for unknown actions or out of range values
+ */
+bool applyTimelineAction(TimelineAction action, uint32_t a, uint32_t b, uint32_t nowMs);
+
+/**
+ * @brief Builds the frame for the next due cues, radio task only
+ * Cues with the same offset share one batch frame.
+ * @param nowMs Current network time in ms
+ * @param frame Output buffer of BATCH_FRAME_MAX_SIZE bytes
+ * @returns Frame length, 0 if nothing is due yet
+ */
+uint8_t nextTimelineFrame(uint32_t nowMs, uint8_t *frame);
+
+#endif
@@ -1,13 +1,42 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <esp_now.h>
+#include <esp_timer.h>
 #include <esp_wifi.h>
 
 #include "constants.h"
+#include "timeline.h"
 
 #define SERIAL_UPSTREAM_START_BYTE 0xBB
 
-void logMessage(const char *message);
+enum class LogLevel : uint8_t
+{
+  ERROR = 0,
+  WARN = 1,
+  INFO = 2,
+  DEBUG = 3
+};
+
+volatile LogLevel logLevel = LogLevel::INFO;
+
+void pushLogRecord(LogLevel level, const char *format, const uint32_t *args, uint8_t count);
+
+/**
+ * @brief Logs to the hub if the level is enabled, free otherwise
+ * @param format String literal with %lu/%lX conversions, formatted later in
+ *               the upstream task
+ */
+template <typename... Args>
+void logEvent(LogLevel level, const char *format, Args... args)
+{
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+  if (level > logLevel)
+  {
+    return;
+  }
+  const uint32_t values[] = {0, static_cast<uint32_t>(args)...};
+  pushLogRecord(level, format, &values[1], sizeof...(Args));
+}
 
 const uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
@@ -17,17 +46,252 @@ enum class FrameState
   RECEIVING_PAYLOAD
 };
 
+enum class LinkMode
+{
+  LEGACY,
+  COBS
+};
+
 FrameState frameState = FrameState::WAITING_FOR_START;
+LinkMode linkMode = LinkMode::LEGACY;
+uint8_t linkBuffer[LINK_MAX_PACKET_SIZE];
+uint8_t linkPacket[LINK_MAX_PACKET_SIZE];
+size_t linkIndex = 0;
+bool linkOverflow = false;
+uint32_t lastLinkPacketTime = 0;
 uint8_t frameBuffer[CONFIG_FRAME_SIZE];
 uint8_t bufferIndex = 0;
+uint8_t expectedFrameSize = SERIAL_FRAME_SIZE;
 uint32_t frameStartTime = 0;
 uint32_t ledOffTime = 0;
 bool ledBlinking = false;
 bool testMode = false;
 uint32_t lastTestFrameTime = 0;
+uint32_t lastTimeBeaconTime = 0;
+uint8_t timeBeaconId = 0;
+
+uint8_t batchFrame[BATCH_FRAME_MAX_SIZE];
+uint8_t batchCount = 0;
+bool batchTimed = false;
+uint32_t batchStartTime = 0;
+int64_t batchStartUs = 0;
+
+struct TxFrame
+{
+  uint8_t data[BATCH_FRAME_MAX_SIZE];
+  uint8_t length;
+  uint8_t retries;
+  bool timeBeacon;
+  uint16_t seq;
+  uint32_t queuedAt;
+  int64_t parsedAtUs; // first payload of the frame came in over serial
+  int64_t queuedAtUs; // handed to the radio task
+  int64_t sentAtUs;   // handed to ESP-NOW
+};
+
+/**
+ * @brief Latency of one pipeline stage, since boot
+ */
+struct StageStats
+{
+  uint32_t count;
+  uint32_t maxUs;
+  uint64_t sumUs;
+};
+
+enum class UpstreamKind : uint8_t
+{
+  HUB_FRAME,
+  LOG,
+  BAUD,
+  STATS,
+  TELEMETRY
+};
+
+/**
+ * @brief Everything written to Serial goes through the upstream task
+ */
+struct UpstreamMsg
+{
+  UpstreamKind kind;
+  uint8_t msgType;
+  uint8_t mac[6];
+  uint8_t data[UPSTREAM_DATA_SIZE];
+  uint8_t dataLen;
+  uint32_t baud;
+  int64_t queuedAtUs;
+  LogLevel level;
+  const char *format;
+  uint32_t args[LOG_MAX_ARGS];
+};
+
+/**
+ * @brief Config or pairing ACK for one Nano, sent without batching or expiry
+ */
+struct UnicastFrame
+{
+  uint8_t mac[6];
+  uint8_t data[ESPNOW_PAYLOAD_SIZE];
+  uint8_t length;
+  uint8_t retries;
+  int8_t peer;
+};
+
+/**
+ * @brief Registered ESP-NOW peer, refs counts queued and in-flight frames
+ */
+struct PeerSlot
+{
+  uint8_t mac[6];
+  bool used;
+  uint8_t refs;
+  uint32_t lastUsed;
+};
+
+constexpr int8_t PEER_BUSY = -1;       // every slot has pending frames
+constexpr int8_t PEER_ADD_FAILED = -2;
+
+struct TxStats
+{
+  uint32_t sent;
+  uint32_t retries;
+  uint32_t expired;
+  uint32_t overflows;
+  uint32_t failed;
+  uint8_t highWater;
+};
+
+TxFrame txQueue[TX_QUEUE_SIZE];
+uint8_t txHead = 0;
+uint8_t txCount = 0;
+bool txInFlight = false;
+uint32_t txSentAt = 0;
+bool txInFlightUnicast = false;
+uint8_t broadcastsSinceUnicast = 0;
+uint32_t txSendCount = 0;              // frames handed to ESP-NOW, radio task only
+volatile uint32_t txCallbackCount = 0; // send callbacks, they come in send order
+volatile bool txFailed = false;        // status of the latest callback
+TxStats txStats = {};
+uint32_t lastTxStatsTime = 0;
+
+UnicastFrame unicastQueue[UNICAST_QUEUE_SIZE];
+uint8_t unicastHead = 0;
+uint8_t unicastCount = 0;
+PeerSlot peerCache[PEER_CACHE_SIZE] = {};
+
+QueueHandle_t txInbox = nullptr;
+QueueHandle_t unicastInbox = nullptr;
+QueueHandle_t upstreamQueue = nullptr;
+TaskHandle_t radioTaskHandle = nullptr;
+volatile uint32_t txInboxOverflows = 0;
+volatile uint32_t upstreamDropped = 0;
+
+/**
+ * @brief The one echo probe in flight, shared by serial, radio and WiFi task
+ */
+struct EchoProbe
+{
+  bool active;
+  uint8_t mac[6];
+  uint16_t id;
+  uint16_t seq;
+  int64_t parsedAtUs;
+  int64_t sentAtUs; // 0 until the broadcast's send callback
+};
+
+EchoProbe echoProbe = {};
+portMUX_TYPE echoMux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Numbered test frames generated by the radio task (CMD_DEBUG_STRESS)
+ */
+struct StressRun
+{
+  bool active;
+  uint8_t flags;
+  uint16_t groups;
+  uint16_t seq;
+  uint16_t remaining; // 0 = until STOP
+  uint32_t intervalUs;
+  int64_t nextAtUs;
+};
+
+StressRun stressRun = {};
+
+// Status beacons, filled by the WiFi callback and emptied by the upstream task
+uint8_t telemetryBatch[TELEMETRY_BATCH_MAX * TELEMETRY_ENTRY_SIZE];
+uint8_t telemetryCount = 0;
+uint32_t telemetryFirstAt = 0;
+uint32_t lastTelemetryFlush = 0;
+portMUX_TYPE telemetryMux = portMUX_INITIALIZER_UNLOCKED;
+
+portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t logTokens = LOG_BURST;
+uint32_t logRefillTime = 0;
+uint32_t logSuppressed = 0;
+
+/**
+ * @brief Gateway health counters since boot, polled by the hub with CMD_STATS
+ */
+struct GatewayStats
+{
+  uint32_t framesIn;       // valid commands from the hub
+  uint32_t checksumErrors; // legacy frame checksum and link CRC failures
+  uint32_t resyncs;        // frame timeouts, truncated and oversized link packets
+  uint32_t sendFailures;   // failed or missing send callbacks, esp_now_send errors
+  uint32_t serialBytes;
+  uint32_t serialBytesPerSec;
+  uint32_t latency[STATS_LATENCY_BUCKETS]; // serial frame complete -> send callback
+};
+
+GatewayStats gatewayStats = {};
+uint32_t lastSerialRateTime = 0;
+uint32_t lastSerialBytes = 0;
+volatile int64_t txDoneAtUs = 0;
+
+StageStats batchStage = {};
+StageStats queueStage = {};
+StageStats airStage = {};
+StageStats upstreamStage = {};
+
+void addStageSample(StageStats &stage, int64_t us)
+{
+  uint32_t sample = us > 0 ? static_cast<uint32_t>(us) : 0;
+  stage.count++;
+  stage.sumUs += sample;
+  if (sample > stage.maxUs)
+  {
+    stage.maxUs = sample;
+  }
+}
+
+/**
+ * @brief Counts a frame's latency from serial into the histogram bucket
+ */
+void addLatencySample(int64_t us)
+{
+  uint8_t bucket = 0;
+  while (bucket < STATS_LATENCY_BUCKETS - 1 && us >= STATS_LATENCY_BOUNDS_US[bucket])
+  {
+    bucket++;
+  }
+  gatewayStats.latency[bucket]++;
+}
+
+/**
+ * @brief Hands a message to the upstream task, never blocks
+ */
+void pushUpstream(UpstreamMsg &msg)
+{
+  msg.queuedAtUs = esp_timer_get_time();
+  if (upstreamQueue == nullptr || xQueueSend(upstreamQueue, &msg, 0) != pdTRUE)
+  {
+    upstreamDropped = upstreamDropped + 1;
+  }
+}
 
 /**
- * @brief Sends upstream message to Hub via Serial
+ * @brief Queues upstream message to Hub, safe from any task or callback
  * @param msgType Message type (MSG_TYPE_PAIRING, MSG_TYPE_CONFIG_ACK)
  * @param macAddr Source MAC address (6 bytes)
  * @param data Optional additional data
@@ -35,273 +299,1658 @@ uint32_t lastTestFrameTime = 0;
  */
 void sendToHub(uint8_t msgType, const uint8_t *macAddr, const uint8_t *data = nullptr, uint8_t dataLen = 0)
 {
-  uint8_t frame[32];
+  UpstreamMsg msg;
+  msg.kind = UpstreamKind::HUB_FRAME;
+  msg.msgType = msgType;
+  memcpy(msg.mac, macAddr, 6);
+  msg.dataLen = dataLen < sizeof(msg.data) ? dataLen : sizeof(msg.data);
+  if (msg.dataLen > 0)
+  {
+    memcpy(msg.data, data, msg.dataLen);
+  }
+  pushUpstream(msg);
+}
+
+uint8_t calculateChecksum(const uint8_t *payload, uint8_t length);
+
+/**
+ * @brief Formats a log record and writes it as log frame, upstream task only
+ */
+void writeLog(LogLevel level, const char *format, const uint32_t *args)
+{
+  uint8_t frame[UPSTREAM_LOG_SIZE + 5];
+  char *text = reinterpret_cast<char *>(&frame[4]);
+
+  int length = snprintf(
+      text,
+      UPSTREAM_LOG_SIZE,
+      format,
+      (unsigned long)args[0], (unsigned long)args[1], (unsigned long)args[2], (unsigned long)args[3],
+      (unsigned long)args[4], (unsigned long)args[5], (unsigned long)args[6], (unsigned long)args[7]);
+  if (length < 0)
+  {
+    return;
+  }
+  if (length >= UPSTREAM_LOG_SIZE)
+  {
+    length = UPSTREAM_LOG_SIZE - 1;
+  }
+
+  frame[0] = SERIAL_UPSTREAM_START_BYTE;
+  frame[1] = MSG_TYPE_LOG;
+  frame[2] = static_cast<uint8_t>(level);
+  frame[3] = static_cast<uint8_t>(length);
+  frame[length + 4] = calculateChecksum(&frame[1], length + 3);
+
+  Serial.write(frame, length + 5);
+}
+
+/**
+ * @brief Serializes an upstream message to Hub, upstream task only
+ */
+void writeHubFrame(const UpstreamMsg &msg)
+{
+  uint8_t frame[UPSTREAM_DATA_SIZE + 9];
   uint8_t idx = 0;
 
   frame[idx++] = SERIAL_UPSTREAM_START_BYTE;
-  frame[idx++] = msgType;
+  frame[idx++] = msg.msgType;
+
+  for (int i = 0; i < 6; i++)
+  {
+    frame[idx++] = msg.mac[i];
+  }
+
+  for (int i = 0; i < msg.dataLen; i++)
+  {
+    frame[idx++] = msg.data[i];
+  }
+
+  // Calculate CRC-8 checksum for bytes 1 to idx-1 (excluding start byte)
+  uint8_t checksum = 0;
+  for (int i = 1; i < idx; i++)
+  {
+    checksum = pgm_read_byte(&CRC8_TABLE[checksum ^ frame[i]]);
+  }
+  frame[idx++] = checksum;
+
+  Serial.write(frame, idx);
+
+  if (msg.msgType == MSG_TYPE_TIME)
+  {
+    return;
+  }
+
+  logEvent(LogLevel::DEBUG, "RX->Hub type=0x%02lX from=%02lX:%02lX:%02lX:%02lX:%02lX:%02lX",
+           msg.msgType, msg.mac[0], msg.mac[1], msg.mac[2], msg.mac[3], msg.mac[4], msg.mac[5]);
+}
+
+/**
+ * @brief Writes a 32-bit value big-endian
+ * @returns Position after the value
+ */
+uint8_t *writeU32(uint8_t *dest, uint32_t value)
+{
+  dest[0] = (value >> 24) & 0xFF;
+  dest[1] = (value >> 16) & 0xFF;
+  dest[2] = (value >> 8) & 0xFF;
+  dest[3] = value & 0xFF;
+  return dest + 4;
+}
+
+/**
+ * @brief Snapshots all counters into a stats frame, upstream task only
+ *
+ * Data: uptime ms, frames in, frames sent, checksum errors, resyncs, send
+ * failures, TX retries, TX expired, TX overflows, upstream drops, serial
+ * bytes/s (uint32 each), TX queue high-water and depth (uint8 each), then
+ * the latency histogram (uint32 per bucket, bounds STATS_LATENCY_BOUNDS_US).
+ */
+void writeStatsFrame()
+{
+  uint8_t frame[4 + 11 * 4 + 2 + STATS_LATENCY_BUCKETS * 4];
+  const uint32_t counters[] = {
+      millis(),
+      gatewayStats.framesIn,
+      txStats.sent,
+      gatewayStats.checksumErrors,
+      gatewayStats.resyncs,
+      gatewayStats.sendFailures,
+      txStats.retries,
+      txStats.expired,
+      txStats.overflows + txInboxOverflows,
+      upstreamDropped,
+      gatewayStats.serialBytesPerSec};
+
+  uint8_t *pos = &frame[3];
+  for (uint32_t value : counters)
+  {
+    pos = writeU32(pos, value);
+  }
+  *pos++ = txStats.highWater;
+  *pos++ = txCount;
+  for (uint8_t i = 0; i < STATS_LATENCY_BUCKETS; i++)
+  {
+    pos = writeU32(pos, gatewayStats.latency[i]);
+  }
+
+  uint8_t length = pos - &frame[3];
+  frame[0] = SERIAL_UPSTREAM_START_BYTE;
+  frame[1] = MSG_TYPE_STATS;
+  frame[2] = length;
+  *pos = calculateChecksum(&frame[1], length + 2);
+
+  Serial.write(frame, length + 4);
+}
+
+/**
+ * @brief Writes all collected status beacons as one frame, upstream task only
+ */
+void writeTelemetryFrame()
+{
+  uint8_t frame[sizeof(telemetryBatch) + 4];
+
+  portENTER_CRITICAL(&telemetryMux);
+  uint8_t length = telemetryCount * TELEMETRY_ENTRY_SIZE;
+  memcpy(&frame[3], telemetryBatch, length);
+  telemetryCount = 0;
+  portEXIT_CRITICAL(&telemetryMux);
+
+  if (length == 0)
+  {
+    return;
+  }
+
+  frame[0] = SERIAL_UPSTREAM_START_BYTE;
+  frame[1] = MSG_TYPE_TELEMETRY;
+  frame[2] = length;
+  frame[length + 3] = calculateChecksum(&frame[1], length + 2);
+
+  Serial.write(frame, length + 4);
+}
+
+/**
+ * @brief Upstream task: the only writer of Serial
+ *
+ * Pairing and config ACKs from the WiFi callback, time reports and logs are
+ * queued here, so neither the callback nor the show path waits on the UART.
+ */
+void upstreamTask(void *)
+{
+  UpstreamMsg msg;
+
+  for (;;)
+  {
+    if (xQueueReceive(upstreamQueue, &msg, portMAX_DELAY) != pdTRUE)
+    {
+      continue;
+    }
+
+    switch (msg.kind)
+    {
+    case UpstreamKind::HUB_FRAME:
+      writeHubFrame(msg);
+      break;
+
+    case UpstreamKind::LOG:
+      writeLog(msg.level, msg.format, msg.args);
+      break;
+
+    case UpstreamKind::BAUD:
+      // Everything queued before went out at the old rate
+      Serial.flush();
+      Serial.updateBaudRate(msg.baud);
+      break;
+
+    case UpstreamKind::STATS:
+      writeStatsFrame();
+      break;
+
+    case UpstreamKind::TELEMETRY:
+      writeTelemetryFrame();
+      break;
+    }
+
+    addStageSample(upstreamStage, esp_timer_get_time() - msg.queuedAtUs);
+  }
+}
+
+/**
+ * @brief Queues a baud rate change behind all pending upstream messages
+ */
+void queueBaudRate(uint32_t baud)
+{
+  UpstreamMsg msg;
+  msg.kind = UpstreamKind::BAUD;
+  msg.baud = baud;
+  pushUpstream(msg);
+}
+
+/**
+ * @brief Reads a 32-bit big-endian value
+ */
+uint32_t readU32(const uint8_t *data)
+{
+  return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+/**
+ * @brief Matches a Nano's echo reply to the probe and reports the stages
+ *
+ * Report data: probe id (uint16), then uint32 microseconds for gateway queue
+ * (serial frame -> esp_now_send), air out (-> Nano receive), Nano processing,
+ * air back (-> gateway receive) and gateway total. The air split needs the
+ * Nano's network time, without it both air values are ECHO_UNSYNCED.
+ */
+void processEchoReply(const uint8_t *macAddr, const uint8_t *data)
+{
+  int64_t rxAtUs = esp_timer_get_time();
+  uint16_t id = (static_cast<uint16_t>(data[1]) << 8) | data[2];
+  EchoProbe probe;
+
+  portENTER_CRITICAL(&echoMux);
+  probe = echoProbe;
+  bool matches = probe.active && probe.sentAtUs != 0 && probe.id == id && memcmp(probe.mac, macAddr, 6) == 0;
+  if (matches)
+  {
+    echoProbe.active = false;
+  }
+  portEXIT_CRITICAL(&echoMux);
+
+  if (!matches)
+  {
+    return;
+  }
+
+  bool synced = data[3] != 0;
+  uint32_t nanoRxUs = readU32(&data[4]);
+  uint32_t processingUs = readU32(&data[8]);
+  uint32_t sentUs = static_cast<uint32_t>(probe.sentAtUs);
+
+  uint8_t report[ECHO_REPORT_SIZE];
+  report[0] = data[1];
+  report[1] = data[2];
+  uint8_t *pos = writeU32(&report[2], static_cast<uint32_t>(probe.sentAtUs - probe.parsedAtUs));
+  pos = writeU32(pos, synced ? nanoRxUs - sentUs : ECHO_UNSYNCED);
+  pos = writeU32(pos, processingUs);
+  pos = writeU32(pos, synced ? static_cast<uint32_t>(rxAtUs) - nanoRxUs - processingUs : ECHO_UNSYNCED);
+  writeU32(pos, static_cast<uint32_t>(rxAtUs - probe.parsedAtUs));
+
+  sendToHub(MSG_TYPE_ECHO, macAddr, report, sizeof(report));
+}
+
+void queueTelemetryFrame()
+{
+  UpstreamMsg msg;
+  msg.kind = UpstreamKind::TELEMETRY;
+  pushUpstream(msg);
+}
+
+/**
+ * @brief Adds a Nano's status beacon to the batch, sends the batch once full
+ */
+void collectStatusBeacon(const uint8_t *macAddr, const uint8_t *data)
+{
+  bool full = false;
+  bool dropped = false;
+
+  portENTER_CRITICAL(&telemetryMux);
+  if (telemetryCount >= TELEMETRY_BATCH_MAX)
+  {
+    dropped = true;
+  }
+  else
+  {
+    uint8_t *entry = &telemetryBatch[telemetryCount * TELEMETRY_ENTRY_SIZE];
+    memcpy(entry, macAddr, 6);
+    memcpy(&entry[6], &data[1], TELEMETRY_BEACON_SIZE - 1);
+    if (telemetryCount == 0)
+    {
+      telemetryFirstAt = millis();
+    }
+    telemetryCount++;
+    full = telemetryCount == TELEMETRY_BATCH_MAX;
+  }
+  portEXIT_CRITICAL(&telemetryMux);
+
+  if (full)
+  {
+    queueTelemetryFrame();
+  }
+  else if (dropped)
+  {
+    logEvent(LogLevel::WARN, "Telemetry batch full, beacon dropped");
+  }
+}
+
+/**
+ * @brief Sends beacons that waited TELEMETRY_FLUSH_MS, serial task only
+ * Asks again after another interval if the request got lost.
+ */
+void checkTelemetryFlush()
+{
+  uint32_t now = millis();
+
+  portENTER_CRITICAL(&telemetryMux);
+  bool due = telemetryCount > 0 && now - telemetryFirstAt >= TELEMETRY_FLUSH_MS;
+  portEXIT_CRITICAL(&telemetryMux);
+
+  if (due && now - lastTelemetryFlush >= TELEMETRY_FLUSH_MS)
+  {
+    lastTelemetryFlush = now;
+    queueTelemetryFrame();
+  }
+}
+
+/**
+ * @brief ESP-NOW receive callback - handles incoming messages from Nanos
+ * @param macAddr Source MAC address
+ * @param data Received data
+ * @param dataLen Length of received data
+ */
+void onDataReceived(const uint8_t *macAddr, const uint8_t *data, int dataLen)
+{
+  if (dataLen < 1)
+  {
+    return;
+  }
+
+  uint8_t command = data[0];
+
+  switch (command)
+  {
+  case 0xA0: // <-- HINZUFÜGEN: Der Nano sendet 0xA0
+    sendToHub(MSG_TYPE_PAIRING, macAddr);
+    break;
+
+  case 0x21: // CMD_CONFIG_ACK
+    if (dataLen >= 2)
+    {
+      sendToHub(MSG_TYPE_CONFIG_ACK, macAddr, &data[1], 1);
+    }
+    break;
+
+  case CMD_DEBUG_ECHO:
+    if (dataLen >= ECHO_REPLY_SIZE)
+    {
+      processEchoReply(macAddr, data);
+    }
+    break;
+
+  case CMD_STATUS_BEACON:
+    if (dataLen >= TELEMETRY_BEACON_SIZE)
+    {
+      collectStatusBeacon(macAddr, data);
+    }
+    break;
+
+  case CMD_DEBUG_STRESS:
+    if (dataLen >= STRESS_REPORT_SIZE)
+    {
+      sendToHub(MSG_TYPE_STRESS, macAddr, &data[1], STRESS_REPORT_SIZE - 1);
+    }
+    break;
+
+  default:
+    logEvent(LogLevel::WARN, "Unknown cmd=0x%02lX from Nano", command);
+    break;
+  }
+}
+
+/**
+ * @brief Token bucket for log lines, errors always pass
+ * @returns Lines suppressed since the last passed one, or -1 to drop this one
+ */
+int32_t takeLogToken(LogLevel level)
+{
+  uint32_t now = millis();
+  int32_t result = -1;
+
+  portENTER_CRITICAL(&logMux);
+
+  uint32_t elapsed = now - logRefillTime;
+  if (elapsed >= LOG_REFILL_MS * LOG_BURST)
+  {
+    logTokens = LOG_BURST;
+    logRefillTime = now;
+  }
+  else
+  {
+    uint32_t refill = elapsed / LOG_REFILL_MS;
+    logTokens = logTokens + refill < LOG_BURST ? logTokens + refill : LOG_BURST;
+    logRefillTime += refill * LOG_REFILL_MS;
+  }
+
+  if (logTokens > 0 || level == LogLevel::ERROR)
+  {
+    if (logTokens > 0)
+    {
+      logTokens--;
+    }
+    result = static_cast<int32_t>(logSuppressed);
+    logSuppressed = 0;
+  }
+  else
+  {
+    logSuppressed++;
+  }
+
+  portEXIT_CRITICAL(&logMux);
+  return result;
+}
+
+/**
+ * @brief Rate-limits a log record and queues it for the upstream task
+ * Safe from any task or callback, nothing is formatted here.
+ */
+void pushLogRecord(LogLevel level, const char *format, const uint32_t *args, uint8_t count)
+{
+  int32_t suppressed = takeLogToken(level);
+  if (suppressed < 0)
+  {
+    return;
+  }
+
+  UpstreamMsg msg;
+  msg.kind = UpstreamKind::LOG;
+  memset(msg.args, 0, sizeof(msg.args));
+
+  if (suppressed > 0)
+  {
+    msg.level = LogLevel::WARN;
+    msg.format = "%lu log lines suppressed";
+    msg.args[0] = static_cast<uint32_t>(suppressed);
+    pushUpstream(msg);
+  }
+
+  msg.level = level;
+  msg.format = format;
+  memset(msg.args, 0, sizeof(msg.args));
+  memcpy(msg.args, args, count * sizeof(uint32_t));
+
+  if (upstreamQueue == nullptr)
+  {
+    writeLog(msg.level, msg.format, msg.args);
+    return;
+  }
+  pushUpstream(msg);
+}
+
+/**
+ * @brief Applies a log level sent by the hub
+ */
+void setLogLevel(uint8_t level)
+{
+  if (level > static_cast<uint8_t>(LogLevel::DEBUG))
+  {
+    logEvent(LogLevel::WARN, "Invalid log level %lu", level);
+    return;
+  }
+
+  logLevel = static_cast<LogLevel>(level);
+  logEvent(LogLevel::INFO, "Log level %lu", level);
+}
+
+/**
+ * @brief Triggers a short LED blink
+ */
+void blinkLed()
+{
+  digitalWrite(LED_PIN, HIGH);
+  ledBlinking = true;
+  ledOffTime = millis() + LED_BLINK_DURATION_MS;
+}
+
+/**
+ * @brief Updates LED state for non-blocking blink
+ */
+void updateLed()
+{
+  if (ledBlinking && millis() >= ledOffTime)
+  {
+    digitalWrite(LED_PIN, LOW);
+    ledBlinking = false;
+  }
+}
+
+/**
+ * @brief Calculates CRC-8 checksum of payload
+ * @param payload Pointer to payload data
+ * @param length Length of payload
+ * @returns CRC-8 checksum byte
+ */
+uint8_t calculateChecksum(const uint8_t *payload, uint8_t length)
+{
+  uint8_t crc = 0x00;
+
+  for (uint8_t i = 0; i < length; i++)
+  {
+    crc = pgm_read_byte(&CRC8_TABLE[crc ^ payload[i]]);
+  }
+
+  return crc;
+}
+
+/**
+ * @brief Extracts sequence number from payload (Big Endian)
+ * @param payload Pointer to payload data
+ * @returns 16-bit sequence number
+ */
+uint16_t extractSequence(const uint8_t *payload)
+{
+  return (static_cast<uint16_t>(payload[0]) << 8) | payload[1];
+}
+
+/**
+ * @brief ESP-NOW send callback
+ * @param macAddr Destination MAC address
+ * @param status Send status
+ */
+void onDataSent(const uint8_t *macAddr, esp_now_send_status_t status)
+{
+  // All sends come from the radio task, which is waiting for this result.
+  // Counting the callbacks lets it tell a late one of a timed-out send apart.
+  txFailed = status != ESP_NOW_SEND_SUCCESS;
+  txDoneAtUs = esp_timer_get_time();
+  txCallbackCount++;
+  if (radioTaskHandle != nullptr)
+  {
+    xTaskNotifyGive(radioTaskHandle);
+  }
+}
+
+/**
+ * @brief Initializes ESP-NOW communication with Long Range mode
+ * @returns true if successful, false otherwise
+ */
+bool initEspNow()
+{
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+
+  if (ESPNOW_LONG_RANGE_ENABLED)
+  {
+    esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_LR);
+    logEvent(LogLevel::INFO, "Long Range mode enabled");
+  }
+
+  esp_wifi_set_max_tx_power(ESPNOW_TX_POWER_DBM * 4);
+
+  esp_wifi_set_channel(ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE);
+
+  if (esp_now_init() != ESP_OK)
+  {
+    logEvent(LogLevel::ERROR, "ESP-NOW init failed");
+    return false;
+  }
+
+  esp_now_register_send_cb(onDataSent);
+  esp_now_register_recv_cb(onDataReceived);
+
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
+  peerInfo.channel = ESPNOW_CHANNEL;
+  peerInfo.encrypt = false;
+
+  if (esp_now_add_peer(&peerInfo) != ESP_OK)
+  {
+    logEvent(LogLevel::ERROR, "Failed to add broadcast peer");
+    return false;
+  }
+
+  int8_t txPower;
+  esp_wifi_get_max_tx_power(&txPower);
+  logEvent(LogLevel::INFO, "TX Power: %lu.%02lu dBm", txPower / 4, (txPower % 4) * 25);
+
+  return true;
+}
+
+/**
+ * @brief Returns the network time base shared with all Nanos
+ * @returns Gateway esp_timer time in microseconds
+ */
+int64_t getNetworkTimeUs()
+{
+  return esp_timer_get_time();
+}
+
+/**
+ * @brief Reports the network time to the Hub so it can schedule timed frames
+ */
+void sendTimeToHub()
+{
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+
+  uint32_t nowMs = static_cast<uint32_t>(getNetworkTimeUs() / 1000);
+  uint8_t data[4] = {
+      static_cast<uint8_t>(nowMs >> 24),
+      static_cast<uint8_t>(nowMs >> 16),
+      static_cast<uint8_t>(nowMs >> 8),
+      static_cast<uint8_t>(nowMs)};
+
+  sendToHub(MSG_TYPE_TIME, mac, data, sizeof(data));
+}
+
+/**
+ * @brief Adds a frame to the radio task's TX queue, radio task only
+ *
+ * A full queue drops its oldest waiting frame, that one is closest to stale.
+ */
+void enqueueTxFrame(const TxFrame &incoming)
+{
+  if (txCount >= TX_QUEUE_SIZE)
+  {
+    uint8_t next = (txHead + 1) % TX_QUEUE_SIZE;
+    if (txInFlight && !txInFlightUnicast)
+    {
+      // Keep the frame on air at the head, drop the one behind it
+      txQueue[next] = txQueue[txHead];
+    }
+    txHead = next;
+    txCount--;
+    txStats.overflows++;
+  }
+
+  txQueue[(txHead + txCount) % TX_QUEUE_SIZE] = incoming;
+  txCount++;
+
+  if (txCount > txStats.highWater)
+  {
+    txStats.highWater = txCount;
+  }
+}
+
+void fillTxFrame(TxFrame &frame, const uint8_t *data, uint8_t length, uint16_t seq, int64_t parsedAtUs)
+{
+  memcpy(frame.data, data, length);
+  frame.length = length;
+  frame.retries = 0;
+  frame.timeBeacon = false;
+  frame.seq = seq;
+  frame.queuedAt = millis();
+  frame.parsedAtUs = parsedAtUs;
+  frame.queuedAtUs = esp_timer_get_time();
+  frame.sentAtUs = 0;
+}
+
+/**
+ * @brief Hands a broadcast frame from the serial task to the radio task
+ * @param seq Sequence number for logging
+ * @param parsedAtUs When its first payload was parsed, for latency stats
+ */
+void queueFrame(const uint8_t *data, uint8_t length, uint16_t seq, int64_t parsedAtUs)
+{
+  TxFrame frame;
+  fillTxFrame(frame, data, length, seq, parsedAtUs);
+
+  if (xQueueSend(txInbox, &frame, 0) != pdTRUE)
+  {
+    txInboxOverflows = txInboxOverflows + 1;
+    return;
+  }
+
+  xTaskNotifyGive(radioTaskHandle);
+}
+
+/**
+ * @brief Hands a unicast frame from the serial task to the radio task
+ * Waits up to UNICAST_INBOX_WAIT_MS when the inbox is full, config frames
+ * must not get lost while a whole band is provisioned.
+ * @returns false if the radio task did not take it in time
+ */
+bool queueUnicast(const uint8_t *mac, const uint8_t *data, uint8_t length)
+{
+  UnicastFrame frame;
+  memcpy(frame.mac, mac, 6);
+  memcpy(frame.data, data, length);
+  frame.length = length;
+  frame.retries = 0;
+  frame.peer = PEER_BUSY;
+
+  if (xQueueSend(unicastInbox, &frame, pdMS_TO_TICKS(UNICAST_INBOX_WAIT_MS)) != pdTRUE)
+  {
+    return false;
+  }
+
+  xTaskNotifyGive(radioTaskHandle);
+  return true;
+}
+
+/**
+ * @brief Finds or registers a unicast peer and takes a reference, radio task only
+ *
+ * A full cache reuses the least recently used slot without pending frames.
+ * @returns Slot index, PEER_BUSY if every slot has frames pending, or PEER_ADD_FAILED
+ */
+int8_t acquirePeer(const uint8_t *mac)
+{
+  uint32_t now = millis();
+  int8_t victim = PEER_BUSY;
+
+  for (int8_t i = 0; i < PEER_CACHE_SIZE; i++)
+  {
+    PeerSlot &slot = peerCache[i];
+    if (slot.used && memcmp(slot.mac, mac, 6) == 0)
+    {
+      slot.refs++;
+      slot.lastUsed = now;
+      return i;
+    }
+  }
+
+  // Prefer a free slot, else the idle peer unused for the longest time
+  for (int8_t i = 0; i < PEER_CACHE_SIZE; i++)
+  {
+    const PeerSlot &slot = peerCache[i];
+    if (!slot.used)
+    {
+      victim = i;
+      break;
+    }
+    if (slot.refs == 0 && (victim == PEER_BUSY || now - slot.lastUsed > now - peerCache[victim].lastUsed))
+    {
+      victim = i;
+    }
+  }
+
+  if (victim == PEER_BUSY)
+  {
+    return PEER_BUSY;
+  }
+
+  PeerSlot &slot = peerCache[victim];
+  if (slot.used)
+  {
+    esp_now_del_peer(slot.mac);
+    slot.used = false;
+  }
+
+  esp_now_peer_info_t peerInfo = {};
+  memcpy(peerInfo.peer_addr, mac, 6);
+  peerInfo.channel = ESPNOW_CHANNEL;
+  peerInfo.encrypt = false;
+
+  esp_err_t result = esp_now_add_peer(&peerInfo);
+  if (result != ESP_OK && result != ESP_ERR_ESPNOW_EXIST)
+  {
+    return PEER_ADD_FAILED;
+  }
+
+  memcpy(slot.mac, mac, 6);
+  slot.used = true;
+  slot.refs = 1;
+  slot.lastUsed = now;
+  return victim;
+}
+
+/**
+ * @brief Drops a frame's reference, the peer stays cached for the next one
+ */
+void releasePeer(int8_t index)
+{
+  if (index >= 0 && peerCache[index].refs > 0)
+  {
+    peerCache[index].refs--;
+    peerCache[index].lastUsed = millis();
+  }
+}
+
+/**
+ * @brief Moves unicast frames from the inbox into the queue, radio task only
+ * Frames wait in the inbox while every peer slot still has pending sends.
+ */
+void drainUnicastInbox()
+{
+  UnicastFrame frame;
+
+  while (unicastCount < UNICAST_QUEUE_SIZE && xQueuePeek(unicastInbox, &frame, 0) == pdTRUE)
+  {
+    int8_t peer = acquirePeer(frame.mac);
+    if (peer == PEER_BUSY)
+    {
+      return;
+    }
+
+    xQueueReceive(unicastInbox, &frame, 0);
+    if (peer == PEER_ADD_FAILED)
+    {
+      txStats.failed++;
+      logEvent(LogLevel::ERROR, "Peer add failed %02lX:%02lX:%02lX:%02lX:%02lX:%02lX",
+               frame.mac[0], frame.mac[1], frame.mac[2], frame.mac[3], frame.mac[4], frame.mac[5]);
+      continue;
+    }
+
+    frame.peer = peer;
+    unicastQueue[(unicastHead + unicastCount) % UNICAST_QUEUE_SIZE] = frame;
+    unicastCount++;
+  }
+}
+
+/**
+ * @brief Finishes or retries the unicast frame at the head of the queue
+ */
+void completeUnicast(bool success)
+{
+  UnicastFrame &frame = unicastQueue[unicastHead];
+
+  if (!success && frame.retries < TX_MAX_RETRIES)
+  {
+    frame.retries++;
+    txStats.retries++;
+    return;
+  }
+
+  if (success)
+  {
+    txStats.sent++;
+    blinkLed();
+  }
+  else
+  {
+    txStats.failed++;
+  }
+
+  logEvent(success ? LogLevel::DEBUG : LogLevel::WARN,
+           success ? "Unicast->%02lX:%02lX:%02lX:%02lX:%02lX:%02lX cmd=0x%02lX OK"
+                   : "Unicast->%02lX:%02lX:%02lX:%02lX:%02lX:%02lX cmd=0x%02lX FAIL",
+           frame.mac[0], frame.mac[1], frame.mac[2], frame.mac[3], frame.mac[4], frame.mac[5],
+           frame.data[3]);
+
+  releasePeer(frame.peer);
+  unicastHead = (unicastHead + 1) % UNICAST_QUEUE_SIZE;
+  unicastCount--;
+}
+
+/**
+ * @brief Sends the unicast frame at the head of the queue
+ */
+void sendUnicast()
+{
+  UnicastFrame &frame = unicastQueue[unicastHead];
+
+  esp_err_t result = esp_now_send(frame.mac, frame.data, frame.length);
+
+  if (result == ESP_OK)
+  {
+    txSendCount++;
+    txInFlight = true;
+    txInFlightUnicast = true;
+    txSentAt = millis();
+    return;
+  }
+
+  if (result != ESP_ERR_ESPNOW_NO_MEM)
+  {
+    gatewayStats.sendFailures++;
+  }
+  completeUnicast(false);
+}
+
+void popTxFrame()
+{
+  txHead = (txHead + 1) % TX_QUEUE_SIZE;
+  txCount--;
+}
+
+/**
+ * @brief Keeps the head frame for another attempt, or drops it after TX_MAX_RETRIES
+ */
+void retryTxFrame()
+{
+  TxFrame &frame = txQueue[txHead];
+  if (frame.retries >= TX_MAX_RETRIES)
+  {
+    popTxFrame();
+    txStats.failed++;
+    return;
+  }
+
+  frame.retries++;
+  txStats.retries++;
+}
+
+/**
+ * @brief Writes the current network time into a queued time beacon
+ */
+void stampTimeBeacon(uint8_t *beacon)
+{
+  int64_t now = getNetworkTimeUs();
+  for (int i = TIME_BEACON_SIZE - 1; i >= 3; i--)
+  {
+    beacon[i] = now & 0xFF;
+    now >>= 8;
+  }
+}
+
+/**
+ * @brief Stamps the probe's send time once its broadcast went out, radio task only
+ * A retried broadcast keeps the time of the attempt that got through.
+ */
+void noteEchoSent(const TxFrame &frame)
+{
+  portENTER_CRITICAL(&echoMux);
+  if (echoProbe.active && echoProbe.seq == frame.seq)
+  {
+    echoProbe.sentAtUs = frame.sentAtUs;
+  }
+  portEXIT_CRITICAL(&echoMux);
+}
+
+/**
+ * @brief True once every frame handed to ESP-NOW had its send callback
+ * Callbacks come in send order, so the latest one belongs to the latest send.
+ */
+bool txSettled()
+{
+  return txCallbackCount == txSendCount;
+}
+
+/**
+ * @brief Drains the TX queue, one frame in flight at a time
+ *
+ * The next frame is only handed to ESP-NOW after the send callback of the
+ * previous one, so the driver queue never overflows. A send without callback
+ * after TX_SEND_TIMEOUT_MS counts as failed, but its frame stays in the driver
+ * until the late callback, so nothing new goes out before that. Failed and
+ * NO_MEM sends are retried, frames that waited longer than TX_MAX_AGE_MS are
+ * dropped. Unicast config frames go out whenever no broadcast is waiting,
+ * and at the latest after TX_BROADCASTS_PER_UNICAST broadcasts.
+ */
+void processTxQueue()
+{
+  uint32_t now = millis();
+  bool txDone = txSettled();
+
+  if (txInFlight && txInFlightUnicast)
+  {
+    if (!txDone && now - txSentAt < TX_SEND_TIMEOUT_MS)
+    {
+      return;
+    }
+
+    txInFlight = false;
+    txInFlightUnicast = false;
+    if (!txDone || txFailed)
+    {
+      gatewayStats.sendFailures++;
+    }
+    completeUnicast(txDone && !txFailed);
+  }
+  else if (txInFlight)
+  {
+    if (txDone)
+    {
+      txInFlight = false;
+      if (txFailed)
+      {
+        gatewayStats.sendFailures++;
+        retryTxFrame();
+      }
+      else
+      {
+        TxFrame &frame = txQueue[txHead];
+        if (!frame.timeBeacon)
+        {
+          addStageSample(batchStage, frame.queuedAtUs - frame.parsedAtUs);
+          addStageSample(queueStage, frame.sentAtUs - frame.queuedAtUs);
+          addStageSample(airStage, txDoneAtUs - frame.sentAtUs);
+          addLatencySample(txDoneAtUs - frame.parsedAtUs);
+          logEvent(LogLevel::DEBUG, "TX SEQ=%lu", frame.seq);
+          blinkLed();
+          if (frame.data[3] == CMD_DEBUG_ECHO && frame.length == ESPNOW_PAYLOAD_SIZE)
+          {
+            noteEchoSent(frame);
+          }
+        }
+        popTxFrame();
+        txStats.sent++;
+      }
+    }
+    else if (now - txSentAt >= TX_SEND_TIMEOUT_MS)
+    {
+      txInFlight = false;
+      gatewayStats.sendFailures++;
+      retryTxFrame();
+    }
+    else
+    {
+      return;
+    }
+  }
+
+  while (txCount > 0 && now - txQueue[txHead].queuedAt > TX_MAX_AGE_MS)
+  {
+    popTxFrame();
+    txStats.expired++;
+  }
+
+  if (!txSettled())
+  {
+    if (now - txSentAt < TX_STALE_CALLBACK_MS)
+    {
+      return;
+    }
+    // The driver lost the callback, stop waiting for it
+    txSendCount = txCallbackCount;
+    logEvent(LogLevel::WARN, "Send callback missing, TX resumed");
+  }
+
+  // A busy broadcast queue (timeline, stress run) must not starve pairing
+  // and config replies
+  if (unicastCount > 0 && (txCount == 0 || broadcastsSinceUnicast >= TX_BROADCASTS_PER_UNICAST))
+  {
+    broadcastsSinceUnicast = 0;
+    sendUnicast();
+    return;
+  }
+
+  if (txCount == 0)
+  {
+    return;
+  }
+
+  TxFrame &frame = txQueue[txHead];
+  if (frame.timeBeacon)
+  {
+    stampTimeBeacon(frame.data);
+  }
+
+  frame.sentAtUs = esp_timer_get_time();
+  esp_err_t result = esp_now_send(broadcastAddress, frame.data, frame.length);
+
+  if (result == ESP_OK)
+  {
+    txSendCount++;
+    txInFlight = true;
+    txSentAt = now;
+    if (broadcastsSinceUnicast < TX_BROADCASTS_PER_UNICAST)
+    {
+      broadcastsSinceUnicast++;
+    }
+  }
+  else if (result == ESP_ERR_ESPNOW_NO_MEM)
+  {
+    retryTxFrame();
+  }
+  else
+  {
+    logEvent(LogLevel::ERROR, "ESP-NOW send error");
+    gatewayStats.sendFailures++;
+    popTxFrame();
+    txStats.failed++;
+  }
+}
+
+/**
+ * @brief Logs TX queue counters for tuning show density
+ */
+void logTxStats()
+{
+  if (millis() - lastTxStatsTime < TX_STATS_INTERVAL_MS)
+  {
+    return;
+  }
+  lastTxStatsTime = millis();
+
+  logEvent(LogLevel::INFO, "TX sent=%lu retries=%lu expired=%lu overflows=%lu failed=%lu depth=%lu high=%lu drop=%lu",
+           txStats.sent, txStats.retries, txStats.expired, txStats.overflows + txInboxOverflows,
+           txStats.failed, txCount, txStats.highWater, upstreamDropped);
+
+  // Per-stage latency avg/max in us: batch window, radio queue, air, upstream
+  const StageStats *stages[] = {&batchStage, &queueStage, &airStage, &upstreamStage};
+  uint32_t avg[4];
+  for (int i = 0; i < 4; i++)
+  {
+    avg[i] = stages[i]->count > 0 ? stages[i]->sumUs / stages[i]->count : 0;
+  }
+  logEvent(LogLevel::INFO, "Latency us batch=%lu/%lu queue=%lu/%lu air=%lu/%lu up=%lu/%lu",
+           avg[0], batchStage.maxUs, avg[1], queueStage.maxUs,
+           avg[2], airStage.maxUs, avg[3], upstreamStage.maxUs);
+}
+
+/**
+ * @brief Broadcasts the gateway clock so Nanos can follow network time
+ */
+void sendTimeBeacon()
+{
+  if (millis() - lastTimeBeaconTime < TIME_BEACON_INTERVAL_MS)
+  {
+    return;
+  }
+  lastTimeBeaconTime = millis();
+
+  uint8_t beacon[TIME_BEACON_SIZE];
+  beacon[0] = TIME_BEACON_MARKER;
+  beacon[1] = timeBeaconId++;
+  beacon[2] = TIME_BEACON_TTL;
+
+  // Timestamp is written when the beacon actually goes on air
+  TxFrame frame;
+  fillTxFrame(frame, beacon, TIME_BEACON_SIZE, 0, esp_timer_get_time());
+  frame.timeBeacon = true;
+  enqueueTxFrame(frame);
+
+  sendTimeToHub();
+}
+
+/**
+ * @brief Writes a network time in ms as 4 bytes big-endian
+ */
+void writeTimeMs(uint8_t *dest, uint32_t timeMs)
+{
+  dest[0] = (timeMs >> 24) & 0xFF;
+  dest[1] = (timeMs >> 16) & 0xFF;
+  dest[2] = (timeMs >> 8) & 0xFF;
+  dest[3] = timeMs & 0xFF;
+}
+
+/**
+ * @brief Queues all collected payloads as one ESP-NOW transmission
+ *
+ * A single payload goes out as a plain 16/20-byte frame. SYNC payloads get a
+ * start time: the execute-at time of timed frames, otherwise the current
+ * network time. Nanos start the effect at that time no matter how late their
+ * copy arrives, and hold it back if the time is still ahead.
+ */
+void flushBatch()
+{
+  if (batchCount == 0)
+  {
+    return;
+  }
+
+  if (!batchTimed)
+  {
+    writeTimeMs(&batchFrame[2], static_cast<uint32_t>(getNetworkTimeUs() / 1000));
+  }
+
+  uint8_t *first = &batchFrame[BATCH_HEADER_SIZE];
+  uint16_t seq = extractSequence(first);
+  uint8_t count = batchCount;
+  batchCount = 0;
+
+  if (count == 1)
+  {
+    uint8_t frame[SYNC_FRAME_SIZE];
+    uint8_t frameSize = ESPNOW_PAYLOAD_SIZE;
+    memcpy(frame, first, ESPNOW_PAYLOAD_SIZE);
+
+    if (frame[2] & FLAG_SYNC)
+    {
+      memcpy(&frame[16], &batchFrame[2], EXECUTE_AT_SIZE);
+      frameSize = SYNC_FRAME_SIZE;
+    }
+
+    queueFrame(frame, frameSize, seq, batchStartUs);
+  }
+  else
+  {
+    batchFrame[0] = BATCH_MARKER;
+    batchFrame[1] = count;
+    queueFrame(batchFrame, BATCH_HEADER_SIZE + count * ESPNOW_PAYLOAD_SIZE, seq, batchStartUs);
+  }
+}
+
+/**
+ * @brief Flushes the batch once its collection window has passed
+ */
+void checkBatchTimeout()
+{
+  if (batchCount > 0 && millis() - batchStartTime >= BATCH_WINDOW_MS)
+  {
+    flushBatch();
+  }
+}
+
+/**
+ * @brief Queues payload for the next ESP-NOW broadcast
+ * @param payload Pointer to 16-byte payload
+ * @param executeAt Optional execute-at time (4 bytes, network time ms, big-endian)
+ *
+ * Payloads arriving within BATCH_WINDOW_MS are sent together. A batch has one
+ * start time, so a payload with a different execute-at time starts a new one.
+ */
+void sendPayload(const uint8_t *payload, const uint8_t *executeAt = nullptr)
+{
+  bool timed = executeAt != nullptr;
+
+  if (batchCount > 0 &&
+      (timed != batchTimed || (timed && memcmp(&batchFrame[2], executeAt, EXECUTE_AT_SIZE) != 0)))
+  {
+    flushBatch();
+  }
+
+  if (batchCount == 0)
+  {
+    batchTimed = timed;
+    batchStartTime = millis();
+    batchStartUs = esp_timer_get_time();
+    if (timed)
+    {
+      memcpy(&batchFrame[2], executeAt, EXECUTE_AT_SIZE);
+    }
+  }
 
-  for (int i = 0; i < 6; i++)
+  uint8_t *entry = &batchFrame[BATCH_HEADER_SIZE + batchCount * ESPNOW_PAYLOAD_SIZE];
+  memcpy(entry, payload, ESPNOW_PAYLOAD_SIZE);
+  if (timed)
   {
-    frame[idx++] = macAddr[i];
+    entry[2] |= FLAG_SYNC;
   }
+  batchCount++;
 
-  for (int i = 0; i < dataLen && idx < 31; i++)
+  if (batchCount >= BATCH_MAX_COMMANDS)
   {
-    frame[idx++] = data[i];
+    flushBatch();
   }
+}
 
-  // Calculate CRC-8 checksum for bytes 1 to idx-1 (excluding start byte)
-  uint8_t checksum = 0;
-  for (int i = 1; i < idx; i++)
+void processConfigFrame(const uint8_t *payload);
+
+/**
+ * @brief Acks the fast link request and switches baud rate
+ * @param baudCode Index into LINK_BAUD_RATES
+ *
+ * The ack still goes out at the old baud rate, the upstream task switches
+ * right after writing it. Afterwards only COBS packets
+ * are accepted until the link is idle for LINK_IDLE_TIMEOUT_MS.
+ */
+void switchToFastLink(uint8_t baudCode)
+{
+  if (baudCode >= LINK_BAUD_RATE_COUNT)
   {
-    checksum = pgm_read_byte(&CRC8_TABLE[checksum ^ frame[i]]);
+    logEvent(LogLevel::WARN, "Invalid baud code %lu", baudCode);
+    return;
   }
-  frame[idx++] = checksum;
 
-  Serial.write(frame, idx);
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  sendToHub(MSG_TYPE_SERIAL_MODE, mac, &baudCode, 1);
+  queueBaudRate(LINK_BAUD_RATES[baudCode]);
 
-  char logBuffer[64];
-  snprintf(
-      logBuffer,
-      sizeof(logBuffer),
-      "RX->Hub type=0x%02X from=%02X:%02X:%02X:%02X:%02X:%02X",
-      msgType,
-      macAddr[0], macAddr[1], macAddr[2], macAddr[3], macAddr[4], macAddr[5]);
-  logMessage(logBuffer);
+  linkMode = LinkMode::COBS;
+  linkIndex = 0;
+  linkOverflow = false;
+  lastLinkPacketTime = millis();
+  frameState = FrameState::WAITING_FOR_START;
+
+  logEvent(LogLevel::INFO, "Fast link @ %lu", LINK_BAUD_RATES[baudCode]);
 }
 
 /**
- * @brief ESP-NOW receive callback - handles incoming messages from Nanos
- * @param macAddr Source MAC address
- * @param data Received data
- * @param dataLen Length of received data
+ * @brief Falls back to legacy frames when the hub went quiet
+ * A restarted hub always starts at SERIAL_BAUD_RATE with legacy frames.
  */
-void onDataReceived(const uint8_t *macAddr, const uint8_t *data, int dataLen)
+void checkLinkTimeout()
 {
-  if (dataLen < 1)
+  if (linkMode != LinkMode::COBS || millis() - lastLinkPacketTime < LINK_IDLE_TIMEOUT_MS)
   {
     return;
   }
 
-  uint8_t command = data[0];
+  queueBaudRate(SERIAL_BAUD_RATE);
+  linkMode = LinkMode::LEGACY;
+  frameState = FrameState::WAITING_FOR_START;
+  logEvent(LogLevel::WARN, "Fast link idle, back to legacy frames");
+}
 
-  switch (command)
+/**
+ * @brief CRC-16/CCITT-FALSE (polynomial 0x1021, init 0xFFFF)
+ */
+uint16_t calculateCrc16(const uint8_t *data, size_t len)
+{
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++)
   {
-  case 0xA0: // <-- HINZUFÜGEN: Der Nano sendet 0xA0
-    sendToHub(MSG_TYPE_PAIRING, macAddr);
-    break;
+    crc ^= static_cast<uint16_t>(data[i]) << 8;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
 
-  case 0x21: // CMD_CONFIG_ACK
-    if (dataLen >= 2)
+/**
+ * @brief Decodes a COBS packet (without the 0x00 delimiter)
+ * @returns Decoded length, 0 if the packet is malformed
+ */
+size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out)
+{
+  size_t o = 0;
+  size_t i = 0;
+
+  while (i < len)
+  {
+    uint8_t code = in[i++];
+    if (code == 0)
     {
-      sendToHub(MSG_TYPE_CONFIG_ACK, macAddr, &data[1], 1);
+      return 0;
     }
-    break;
 
-  default:
-    char logBuffer[48];
-    snprintf(logBuffer, sizeof(logBuffer), "Unknown cmd=0x%02X from Nano", command);
-    logMessage(logBuffer);
-    break;
+    for (uint8_t k = 1; k < code; k++)
+    {
+      if (i >= len)
+      {
+        return 0;
+      }
+      out[o++] = in[i++];
+    }
+
+    if (code != 0xFF && i < len)
+    {
+      out[o++] = 0;
+    }
   }
+
+  return o;
 }
 
 /**
- * @brief Logs a message with gateway prefix
- * @param message The message to log
+ * @brief Queues a stats frame, the upstream task takes the snapshot when writing
  */
-void logMessage(const char *message)
+void queueStatsFrame()
 {
-  Serial.print("[GW] ");
-  Serial.println(message);
+  UpstreamMsg msg;
+  msg.kind = UpstreamKind::STATS;
+  pushUpstream(msg);
 }
 
 /**
- * @brief Logs a message with a numeric value
- * @param message The message prefix
- * @param value The numeric value to append
+ * @brief Updates serial bytes/s once per STATS_RATE_INTERVAL_MS
  */
-void logMessageValue(const char *message, uint32_t value)
+void updateSerialRate()
 {
-  Serial.print("[GW] ");
-  Serial.print(message);
-  Serial.println(value);
+  uint32_t now = millis();
+  if (now - lastSerialRateTime < STATS_RATE_INTERVAL_MS)
+  {
+    return;
+  }
+
+  gatewayStats.serialBytesPerSec = (gatewayStats.serialBytes - lastSerialBytes) * 1000 / (now - lastSerialRateTime);
+  lastSerialBytes = gatewayStats.serialBytes;
+  lastSerialRateTime = now;
 }
 
 /**
- * @brief Triggers a short LED blink
+ * @brief Starts an echo probe and broadcasts it right away, bypassing the batch
+ * A new probe replaces one that never got its reply.
  */
-void blinkLed()
+void startEchoProbe(const uint8_t *payload)
 {
-  digitalWrite(LED_PIN, HIGH);
-  ledBlinking = true;
-  ledOffTime = millis() + LED_BLINK_DURATION_MS;
+  int64_t parsedAtUs = esp_timer_get_time();
+  uint8_t frame[ESPNOW_PAYLOAD_SIZE];
+  memcpy(frame, payload, ESPNOW_PAYLOAD_SIZE);
+  frame[2] |= FLAG_NO_REBROADCAST; // the air stages assume one hop
+
+  portENTER_CRITICAL(&echoMux);
+  echoProbe.active = true;
+  memcpy(echoProbe.mac, &payload[10], 6);
+  echoProbe.id = (static_cast<uint16_t>(payload[6]) << 8) | payload[7];
+  echoProbe.seq = extractSequence(payload);
+  echoProbe.parsedAtUs = parsedAtUs;
+  echoProbe.sentAtUs = 0;
+  portEXIT_CRITICAL(&echoMux);
+
+  flushBatch();
+  queueFrame(frame, ESPNOW_PAYLOAD_SIZE, echoProbe.seq, parsedAtUs);
 }
 
 /**
- * @brief Updates LED state for non-blocking blink
+ * @brief Handles commands meant for the gateway itself, never batched
+ * Pairing ACKs and config frames become unicasts to the Nano they address,
+ * echo probes go out as a single broadcast.
+ * @returns true if the payload was a gateway command
  */
-void updateLed()
+bool processGatewayCommand(const uint8_t *payload)
 {
-  if (ledBlinking && millis() >= ledOffTime)
+  switch (payload[3])
   {
-    digitalWrite(LED_PIN, LOW);
-    ledBlinking = false;
+  case CMD_PAIRING_ACK:
+  case CMD_CONFIG_SET:
+    processConfigFrame(payload);
+    return true;
+
+  case CMD_DEBUG_ECHO:
+    startEchoProbe(payload);
+    return true;
+
+  case CMD_DEBUG_STRESS:
+    // Nanos reset or report on it, the radio task starts or stops the run
+    flushBatch();
+    queueFrame(payload, ESPNOW_PAYLOAD_SIZE, extractSequence(payload), esp_timer_get_time());
+    return true;
+
+  case CMD_SERIAL_MODE:
+    switchToFastLink(payload[8]);
+    return true;
+
+  case CMD_LOG_LEVEL:
+    setLogLevel(payload[8]);
+    return true;
+
+  case CMD_STATS:
+    queueStatsFrame();
+    return true;
+
+  default:
+    return false;
   }
 }
 
 /**
- * @brief Calculates CRC-8 checksum of payload
- * @param payload Pointer to payload data
- * @param length Length of payload
- * @returns CRC-8 checksum byte
+ * @brief Stores a timeline chunk and acks the stored entry count to the hub
  */
-uint8_t calculateChecksum(const uint8_t *payload, uint8_t length)
+void processTimelineChunk(const uint8_t *body, size_t len)
 {
-  uint8_t crc = 0x00;
+  uint16_t count = 0;
+  bool accepted = storeTimelineChunk(body, len, count);
 
-  for (uint8_t i = 0; i < length; i++)
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  uint8_t data[3] = {
+      accepted ? TIMELINE_ACK_OK : TIMELINE_ACK_REJECTED,
+      static_cast<uint8_t>(count >> 8),
+      static_cast<uint8_t>(count)};
+  sendToHub(MSG_TYPE_TIMELINE, mac, data, sizeof(data));
+
+  if (!accepted)
   {
-    crc = pgm_read_byte(&CRC8_TABLE[crc ^ payload[i]]);
+    logEvent(LogLevel::WARN, "Timeline chunk rejected at %lu", count);
   }
-
-  return crc;
 }
 
 /**
- * @brief Extracts sequence number from payload (Big Endian)
- * @param payload Pointer to payload data
- * @returns 16-bit sequence number
+ * @brief Handles a timeline transport packet: [action][a u32][b u32]
  */
-uint16_t extractSequence(const uint8_t *payload)
+void processTimelineTransport(const uint8_t *body, size_t len)
 {
-  return (static_cast<uint16_t>(payload[0]) << 8) | payload[1];
+  if (len < 9)
+  {
+    return;
+  }
+
+  uint32_t a = (static_cast<uint32_t>(body[1]) << 24) | (static_cast<uint32_t>(body[2]) << 16) |
+               (static_cast<uint32_t>(body[3]) << 8) | body[4];
+  uint32_t b = (static_cast<uint32_t>(body[5]) << 24) | (static_cast<uint32_t>(body[6]) << 16) |
+               (static_cast<uint32_t>(body[7]) << 8) | body[8];
+  uint32_t nowMs = static_cast<uint32_t>(getNetworkTimeUs() / 1000);
+
+  if (!applyTimelineAction(static_cast<TimelineAction>(body[0]), a, b, nowMs))
+  {
+    logEvent(LogLevel::WARN, "Timeline action %lu failed", body[0]);
+    return;
+  }
+
+  logEvent(LogLevel::INFO, "Timeline action %lu", body[0]);
 }
 
 /**
- * @brief ESP-NOW send callback
- * @param macAddr Destination MAC address
- * @param status Send status
+ * @brief Broadcasts a scene store or trigger frame built by the hub
+ * Nanos keep the scene table, the gateway only checks the header.
  */
-void onDataSent(const uint8_t *macAddr, esp_now_send_status_t status)
+void processSceneFrame(const uint8_t *frame, size_t len)
 {
-  if (status != ESP_NOW_SEND_SUCCESS)
+  if (len <= SCENE_HEADER_SIZE || len > BATCH_FRAME_MAX_SIZE ||
+      (frame[0] != SCENE_STORE_MARKER && frame[0] != SCENE_TRIGGER_MARKER))
   {
-    logMessage("ESP-NOW send failed");
+    logEvent(LogLevel::WARN, "Invalid scene frame (%lu bytes)", len);
+    return;
   }
+
+  gatewayStats.framesIn++;
+  flushBatch();
+  queueFrame(frame, len, extractSequence(&frame[3]), esp_timer_get_time());
 }
 
 /**
- * @brief Initializes ESP-NOW communication with Long Range mode
- * @returns true if successful, false otherwise
+ * @brief Processes a decoded fast link packet
+ * Commands go through sendPayload and are flushed right after the packet,
+ * the hub already batched them.
  */
-bool initEspNow()
+void processLinkPacket(const uint8_t *packet, size_t len)
 {
-  WiFi.mode(WIFI_STA);
-  WiFi.disconnect();
-
-  if (ESPNOW_LONG_RANGE_ENABLED)
+  if (len < 4)
   {
-    esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_LR);
-    logMessage("Long Range mode enabled");
+    return;
   }
 
-  esp_wifi_set_max_tx_power(ESPNOW_TX_POWER_DBM * 4);
+  uint16_t receivedCrc = (static_cast<uint16_t>(packet[len - 2]) << 8) | packet[len - 1];
+  if (calculateCrc16(packet, len - 2) != receivedCrc)
+  {
+    gatewayStats.checksumErrors++;
+    logEvent(LogLevel::WARN, "Link CRC error");
+    return;
+  }
 
-  esp_wifi_set_channel(ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE);
+  lastLinkPacketTime = millis();
 
-  if (esp_now_init() != ESP_OK)
+  if (packet[0] == LINK_PACKET_TIMELINE)
   {
-    logMessage("ESP-NOW init failed");
-    return false;
+    processTimelineChunk(&packet[1], len - 3);
+    return;
   }
 
-  esp_now_register_send_cb(onDataSent);
-  esp_now_register_recv_cb(onDataReceived);
+  if (packet[0] == LINK_PACKET_TRANSPORT)
+  {
+    processTimelineTransport(&packet[1], len - 3);
+    return;
+  }
 
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
-  peerInfo.channel = ESPNOW_CHANNEL;
-  peerInfo.encrypt = false;
+  if (packet[0] == LINK_PACKET_SCENES)
+  {
+    processSceneFrame(&packet[1], len - 3);
+    return;
+  }
 
-  if (esp_now_add_peer(&peerInfo) != ESP_OK)
+  if (packet[0] != LINK_PACKET_COMMANDS)
   {
-    logMessage("Failed to add broadcast peer");
-    return false;
+    return;
   }
 
-  int8_t txPower;
-  esp_wifi_get_max_tx_power(&txPower);
-  char powerStr[32];
-  snprintf(powerStr, sizeof(powerStr), "TX Power: %.1f dBm", txPower / 4.0);
-  logMessage(powerStr);
+  uint8_t count = packet[1];
+  size_t pos = 2;
+  size_t end = len - 2;
 
-  return true;
+  for (uint8_t n = 0; n < count; n++)
+  {
+    if (pos >= end)
+    {
+      break;
+    }
+
+    uint8_t entryLen = packet[pos++];
+    if (pos + entryLen > end)
+    {
+      gatewayStats.resyncs++;
+      logEvent(LogLevel::WARN, "Link packet truncated");
+      break;
+    }
+
+    const uint8_t *payload = &packet[pos];
+    pos += entryLen;
+    gatewayStats.framesIn++;
+
+    if (entryLen >= ESPNOW_PAYLOAD_SIZE && processGatewayCommand(payload))
+    {
+      continue;
+    }
+
+    if (entryLen == ESPNOW_PAYLOAD_SIZE)
+    {
+      sendPayload(payload);
+    }
+    else if (entryLen == ESPNOW_PAYLOAD_SIZE + EXECUTE_AT_SIZE)
+    {
+      sendPayload(payload, &payload[ESPNOW_PAYLOAD_SIZE]);
+    }
+  }
+
+  flushBatch();
 }
 
 /**
- * @brief Sends payload via ESP-NOW broadcast
- * @param payload Pointer to 16-byte payload
+ * @brief Collects COBS bytes, a 0x00 ends the packet and resyncs instantly
  */
-void sendPayload(const uint8_t *payload)
+void processLinkByte(uint8_t byte)
 {
-  uint16_t seq = extractSequence(payload);
-
-  esp_err_t result = esp_now_send(broadcastAddress, payload, ESPNOW_PAYLOAD_SIZE);
-
-  if (result == ESP_OK)
+  if (byte == 0x00)
   {
-    char logBuffer[32];
-    snprintf(logBuffer, sizeof(logBuffer), "TX SEQ=%u", seq);
-    logMessage(logBuffer);
-    blinkLed();
+    if (linkIndex > 0 && !linkOverflow)
+    {
+      size_t len = cobsDecode(linkBuffer, linkIndex, linkPacket);
+      processLinkPacket(linkPacket, len);
+    }
+    linkIndex = 0;
+    linkOverflow = false;
+    return;
   }
-  else
+
+  if (linkIndex >= LINK_MAX_PACKET_SIZE)
   {
-    logMessage("ESP-NOW send error");
+    if (!linkOverflow)
+    {
+      gatewayStats.resyncs++;
+    }
+    linkOverflow = true;
+    return;
   }
-}
 
-void processConfigFrame(const uint8_t *payload);
+  linkBuffer[linkIndex++] = byte;
+}
 
 /**
  * @brief Processes a complete frame from buffer
  * Frame format: [0]=START, [1-16]=payload, [17]=checksum
- * Payload: [0-1]=groups, [2-3]=duration, [4]=effect, [5]=length, [6]=brightness,
- *          [7-8]=speed, [9-11]=rgb, [12]=intensity, [13-15]=reserved
+ * Timed frame:  [0]=0xAC, [1-16]=payload, [17-20]=execute-at, [21]=checksum
+ * Payload: [0-1]=seq, [2]=flags, [3]=effect, [4-5]=groups, [6-7]=duration,
+ *          [8]=length, [9-15]=effect parameters
  */
 void processFrame()
 {
   uint8_t *payload = &frameBuffer[1];
-  uint8_t effect = payload[4];
+  bool timed = frameBuffer[0] == SERIAL_TIMED_START_BYTE;
+  uint8_t checkedLength = timed ? ESPNOW_PAYLOAD_SIZE + EXECUTE_AT_SIZE : ESPNOW_PAYLOAD_SIZE;
 
-  uint8_t calculatedChecksum = calculateChecksum(payload, ESPNOW_PAYLOAD_SIZE);
-  uint8_t receivedChecksum = frameBuffer[ESPNOW_PAYLOAD_SIZE + 1];
+  uint8_t calculatedChecksum = calculateChecksum(payload, checkedLength);
+  uint8_t receivedChecksum = frameBuffer[checkedLength + 1];
 
   if (calculatedChecksum != receivedChecksum)
   {
-    uint16_t seq = extractSequence(payload);
-    char logBuffer[48];
-    snprintf(
-        logBuffer,
-        sizeof(logBuffer),
-        "Checksum error SEQ=%u (exp=0x%02X got=0x%02X)",
-        seq,
-        calculatedChecksum,
-        receivedChecksum);
-    logMessage(logBuffer);
+    gatewayStats.checksumErrors++;
+    logEvent(LogLevel::WARN, "Checksum error SEQ=%lu (exp=0x%02lX got=0x%02lX)",
+             extractSequence(payload), calculatedChecksum, receivedChecksum);
     frameState = FrameState::WAITING_FOR_START;
     return;
   }
 
-  if (effect == CMD_PAIRING_ACK || effect == CMD_CONFIG_SET)
-  {
-    processConfigFrame(payload);
-  }
-  else
+  gatewayStats.framesIn++;
+
+  if (!processGatewayCommand(payload))
   {
-    sendPayload(payload);
+    sendPayload(payload, timed ? &payload[ESPNOW_PAYLOAD_SIZE] : nullptr);
   }
 
   frameState = FrameState::WAITING_FOR_START;
@@ -315,12 +1964,20 @@ void processSerial()
   while (Serial.available())
   {
     uint8_t byte = Serial.read();
+    gatewayStats.serialBytes++;
+
+    if (linkMode == LinkMode::COBS)
+    {
+      processLinkByte(byte);
+      continue;
+    }
 
     switch (frameState)
     {
     case FrameState::WAITING_FOR_START:
-      if (byte == SERIAL_START_BYTE)
+      if (byte == SERIAL_START_BYTE || byte == SERIAL_TIMED_START_BYTE)
       {
+        expectedFrameSize = byte == SERIAL_TIMED_START_BYTE ? SERIAL_TIMED_FRAME_SIZE : SERIAL_FRAME_SIZE;
         frameState = FrameState::RECEIVING_PAYLOAD;
         bufferIndex = 0;
         frameBuffer[bufferIndex++] = byte;
@@ -331,7 +1988,7 @@ void processSerial()
     case FrameState::RECEIVING_PAYLOAD:
       frameBuffer[bufferIndex++] = byte;
 
-      if (bufferIndex >= ESPNOW_PAYLOAD_SIZE + 2)
+      if (bufferIndex >= expectedFrameSize)
       {
         processFrame();
       }
@@ -349,7 +2006,8 @@ void checkFrameTimeout()
   {
     if (millis() - frameStartTime > FRAME_TIMEOUT_MS)
     {
-      logMessage("Frame timeout, resync");
+      gatewayStats.resyncs++;
+      logEvent(LogLevel::WARN, "Frame timeout, resync");
       frameState = FrameState::WAITING_FOR_START;
     }
   }
@@ -385,13 +2043,13 @@ void sendTestFrame()
         0x00, 0x00,
         0xFF};
 
-    logMessage("Sending test frame (HEARTBEAT)");
+    logEvent(LogLevel::DEBUG, "Sending test frame (HEARTBEAT)");
     sendPayload(testPayload);
   }
 }
 
 /**
- * @brief Processes config frame and sends to specific Nano via ESP-NOW
+ * @brief Processes config frame and queues it as unicast to the addressed Nano
  * @param payload Pointer to 16-byte payload (after start byte)
  *
  * Hub Frame Format (payload indices after start byte):
@@ -446,78 +2104,217 @@ void processConfigFrame(const uint8_t *payload)
   configPayload[14] = 0x00;
   configPayload[15] = 0x00;
 
-  esp_now_peer_info_t peerInfo = {};
-  memcpy(peerInfo.peer_addr, targetMac, 6);
-  peerInfo.channel = ESPNOW_CHANNEL;
-  peerInfo.encrypt = false;
+  bool queued = queueUnicast(targetMac, configPayload, sizeof(configPayload));
+
+  logEvent(queued ? LogLevel::INFO : LogLevel::WARN,
+           queued ? "Config->%02lX:%02lX:%02lX:%02lX:%02lX:%02lX reg=%lu leds=%lu queued"
+                  : "Config->%02lX:%02lX:%02lX:%02lX:%02lX:%02lX reg=%lu leds=%lu dropped",
+           targetMac[0], targetMac[1], targetMac[2], targetMac[3], targetMac[4], targetMac[5],
+           reg, ledCount);
+}
+
+/**
+ * @brief Serial task: parses hub frames and feeds the radio task
+ */
+void serialTask(void *)
+{
+  for (;;)
+  {
+    processSerial();
+    checkFrameTimeout();
+    checkBatchTimeout();
+    checkLinkTimeout();
+    updateSerialRate();
+    checkTelemetryFlush();
+    sendTestFrame();
+    vTaskDelay(1);
+  }
+}
+
+/**
+ * @brief Queues due timeline cues, radio task only
+ * Leaves half of the TX queue free for live commands and time beacons.
+ */
+void playTimeline()
+{
+  uint8_t frame[BATCH_FRAME_MAX_SIZE];
+  uint32_t nowMs = static_cast<uint32_t>(getNetworkTimeUs() / 1000);
+
+  while (txCount < TX_QUEUE_SIZE / 2)
+  {
+    uint8_t length = nextTimelineFrame(nowMs, frame);
+    if (length == 0)
+    {
+      return;
+    }
+
+    const uint8_t *first = length > SYNC_FRAME_SIZE ? &frame[BATCH_HEADER_SIZE] : frame;
+    TxFrame txFrame;
+    fillTxFrame(txFrame, frame, length, extractSequence(first), esp_timer_get_time());
+    enqueueTxFrame(txFrame);
+  }
+}
+
+/**
+ * @brief Starts or stops the stress run on its control frame, radio task only
+ */
+void configureStress(const uint8_t *payload)
+{
+  uint8_t action = payload[8];
+
+  if (action == STRESS_START)
+  {
+    uint16_t rate = (static_cast<uint16_t>(payload[6]) << 8) | payload[7];
+    if (rate == 0 || rate > STRESS_MAX_RATE)
+    {
+      logEvent(LogLevel::WARN, "Stress rate %lu out of range", rate);
+      stressRun.active = false;
+      return;
+    }
+
+    stressRun.active = true;
+    stressRun.flags = (payload[2] & ~SOURCE_MASK) | (SOURCE_GATEWAY << SOURCE_SHIFT);
+    stressRun.groups = (static_cast<uint16_t>(payload[4]) << 8) | payload[5];
+    stressRun.seq = 0;
+    stressRun.remaining = (static_cast<uint16_t>(payload[10]) << 8) | payload[11];
+    stressRun.intervalUs = 1000000 / rate;
+    stressRun.nextAtUs = esp_timer_get_time() + STRESS_START_DELAY_US;
+    logEvent(LogLevel::INFO, "Stress start %lu/s, %lu frames", rate, stressRun.remaining);
+  }
+  else if (action == STRESS_STOP && stressRun.active)
+  {
+    stressRun.active = false;
+    logEvent(LogLevel::INFO, "Stress stopped after %lu frames", stressRun.seq);
+  }
+}
 
-  esp_err_t addResult = esp_now_add_peer(&peerInfo);
+/**
+ * @brief Queues the stress frames that are due, radio task only
+ * Frames are queued even when the TX queue is full, its overflows and
+ * expiries are part of what the test measures.
+ */
+void generateStressFrames()
+{
+  int64_t now = esp_timer_get_time();
+  uint8_t frame[ESPNOW_PAYLOAD_SIZE];
 
-  esp_err_t result = esp_now_send(targetMac, configPayload, 16);
+  for (uint8_t i = 0; stressRun.active && now >= stressRun.nextAtUs && i < TX_QUEUE_SIZE; i++)
+  {
+    stressRun.seq++;
+    memset(frame, 0, sizeof(frame));
+    frame[0] = (stressRun.seq >> 8) & 0xFF;
+    frame[1] = stressRun.seq & 0xFF;
+    frame[2] = stressRun.flags;
+    frame[3] = CMD_DEBUG_STRESS;
+    frame[4] = (stressRun.groups >> 8) & 0xFF;
+    frame[5] = stressRun.groups & 0xFF;
+    frame[8] = STRESS_DATA;
+
+    TxFrame txFrame;
+    fillTxFrame(txFrame, frame, ESPNOW_PAYLOAD_SIZE, stressRun.seq, now);
+    enqueueTxFrame(txFrame);
+
+    stressRun.nextAtUs += stressRun.intervalUs;
+    if (stressRun.remaining > 0 && --stressRun.remaining == 0)
+    {
+      stressRun.active = false;
+      logEvent(LogLevel::INFO, "Stress done after %lu frames", stressRun.seq);
+    }
+  }
+}
 
-  if (addResult == ESP_OK || addResult == ESP_ERR_ESPNOW_EXIST)
+/**
+ * @brief Wakes the radio task, called by the timeline wake-up timer
+ */
+void wakeRadioTask()
+{
+  if (radioTaskHandle != nullptr)
   {
-    esp_now_del_peer(targetMac);
+    xTaskNotifyGive(radioTaskHandle);
   }
+}
+
+/**
+ * @brief Radio task: drains the TX queue, paced by send callbacks
+ * Wakes on every send callback and every new frame, at the latest each tick.
+ */
+void radioTask(void *)
+{
+  TxFrame frame;
 
-  char logBuffer[64];
-  snprintf(
-      logBuffer,
-      sizeof(logBuffer),
-      "Config->%02X:%02X:%02X:%02X:%02X:%02X reg=%d leds=%d %s",
-      targetMac[0], targetMac[1], targetMac[2],
-      targetMac[3], targetMac[4], targetMac[5],
-      reg, ledCount,
-      result == ESP_OK ? "OK" : "FAIL");
-  logMessage(logBuffer);
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, 1);
 
-  blinkLed();
+    while (xQueueReceive(txInbox, &frame, 0) == pdTRUE)
+    {
+      if (frame.length == ESPNOW_PAYLOAD_SIZE && frame.data[3] == CMD_DEBUG_STRESS)
+      {
+        configureStress(frame.data);
+      }
+      enqueueTxFrame(frame);
+    }
+    drainUnicastInbox();
+
+    playTimeline();
+    generateStressFrames();
+    sendTimeBeacon();
+    processTxQueue();
+    logTxStats();
+    updateLed();
+  }
 }
 
 void setup()
 {
+  Serial.setRxBufferSize(SERIAL_RX_BUFFER_SIZE);
   Serial.begin(SERIAL_BAUD_RATE);
   delay(100);
 
+  upstreamQueue = xQueueCreate(UPSTREAM_QUEUE_SIZE, sizeof(UpstreamMsg));
+  txInbox = xQueueCreate(TX_INBOX_SIZE, sizeof(TxFrame));
+  unicastInbox = xQueueCreate(UNICAST_INBOX_SIZE, sizeof(UnicastFrame));
+  initTimeline(wakeRadioTask);
+  xTaskCreatePinnedToCore(upstreamTask, "upstream", UPSTREAM_TASK_STACK_SIZE, nullptr,
+                          UPSTREAM_TASK_PRIORITY, nullptr, UPSTREAM_TASK_CORE);
+
   pinMode(LED_PIN, OUTPUT);
   pinMode(BOOT_BUTTON_PIN, INPUT_PULLUP);
 
   digitalWrite(LED_PIN, LOW);
 
-  logMessage("Gateway starting...");
+  logEvent(LogLevel::INFO, "Gateway starting...");
 
   testMode = (digitalRead(BOOT_BUTTON_PIN) == LOW);
 
   if (testMode)
   {
-    logMessage("TEST MODE enabled (Boot button held)");
+    logEvent(LogLevel::INFO, "TEST MODE enabled (Boot button held)");
   }
 
   if (!initEspNow())
   {
-    logMessage("Init failed, rebooting in 5s...");
+    logEvent(LogLevel::ERROR, "Init failed, rebooting in 5s...");
     delay(INIT_FAIL_REBOOT_MS);
     ESP.restart();
   }
 
+  xTaskCreatePinnedToCore(radioTask, "radio", RADIO_TASK_STACK_SIZE, nullptr,
+                          RADIO_TASK_PRIORITY, &radioTaskHandle, RADIO_TASK_CORE);
+  xTaskCreatePinnedToCore(serialTask, "serial", SERIAL_TASK_STACK_SIZE, nullptr,
+                          SERIAL_TASK_PRIORITY, nullptr, SERIAL_TASK_CORE);
+
   digitalWrite(LED_PIN, HIGH);
-  logMessage("Gateway ready");
+  logEvent(LogLevel::INFO, "Gateway ready");
 
   uint8_t mac[6];
   WiFi.macAddress(mac);
-  char macStr[24];
-  snprintf(
-      macStr,
-      sizeof(macStr),
-      "MAC: %02X:%02X:%02X:%02X:%02X:%02X",
-      mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-  logMessage(macStr);
+  logEvent(LogLevel::INFO, "MAC: %02lX:%02lX:%02lX:%02lX:%02lX:%02lX",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 }
 
 void loop()
 {
-  processSerial();
-  checkFrameTimeout();
-  updateLed();
-  sendTestFrame();
+  // All work happens in the serial, radio and upstream tasks
+  vTaskDelete(nullptr);
 }
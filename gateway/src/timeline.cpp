@@ -0,0 +1,321 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/semphr.h>
+
+#include "constants.h"
+#include "timeline.h"
+
+struct TimelineEntry
+{
+  uint32_t offsetMs;
+  uint8_t payload[ESPNOW_PAYLOAD_SIZE];
+};
+
+static TimelineEntry timeline[TIMELINE_MAX_ENTRIES];
+static uint16_t timelineCount = 0;
+static SemaphoreHandle_t timelineMutex = nullptr;
+
+static bool playing = false;
+static uint16_t nextCue = 0;
+static uint32_t anchorPositionMs = 0; // playback position reached ...
+static uint32_t anchorNetworkMs = 0;  // ... at this network time
+static uint16_t tempo = 1000;
+static uint16_t playerSeq = 0;
+
+static esp_timer_handle_t wakeTimer = nullptr;
+static void (*wakeCallback)() = nullptr;
+static bool wakeArmed = false;
+static uint32_t wakeAtMs = 0;
+
+static uint32_t readU32(const uint8_t *data)
+{
+  return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+/**
+ * @brief Network time at which a timeline offset plays, at the current tempo
+ */
+static uint32_t networkTimeFor(uint32_t offsetMs)
+{
+  int64_t delta = static_cast<int64_t>(offsetMs) - anchorPositionMs;
+  return anchorNetworkMs + static_cast<uint32_t>(delta * 1000 / tempo);
+}
+
+/**
+ * @brief Playback position at a network time, before the anchor it is the anchor
+ */
+static uint32_t positionAt(uint32_t nowMs)
+{
+  int32_t elapsed = static_cast<int32_t>(nowMs - anchorNetworkMs);
+  if (elapsed <= 0)
+  {
+    return anchorPositionMs;
+  }
+  return anchorPositionMs + static_cast<uint32_t>(static_cast<int64_t>(elapsed) * tempo / 1000);
+}
+
+/**
+ * @brief Index of the first entry at or after positionMs
+ */
+static uint16_t findCue(uint32_t positionMs)
+{
+  uint16_t low = 0;
+  uint16_t high = timelineCount;
+  while (low < high)
+  {
+    uint16_t mid = (low + high) / 2;
+    if (timeline[mid].offsetMs < positionMs)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+static void moveTo(uint32_t positionMs, uint32_t atMs)
+{
+  anchorPositionMs = positionMs;
+  anchorNetworkMs = atMs;
+  nextCue = findCue(positionMs);
+}
+
+static void disarmWake()
+{
+  if (wakeArmed)
+  {
+    esp_timer_stop(wakeTimer);
+    wakeArmed = false;
+  }
+}
+
+/**
+ * @brief Wakes the radio task at network time atMs, keeps an already armed timer
+ */
+static void armWake(uint32_t atMs, uint32_t nowMs)
+{
+  if (wakeTimer == nullptr || (wakeArmed && wakeAtMs == atMs))
+  {
+    return;
+  }
+
+  disarmWake();
+  esp_timer_start_once(wakeTimer, static_cast<uint64_t>(atMs - nowMs) * 1000);
+  wakeArmed = true;
+  wakeAtMs = atMs;
+}
+
+static void onWakeTimer(void *)
+{
+  if (wakeCallback != nullptr)
+  {
+    wakeCallback();
+  }
+}
+
+/**
+ * @brief Gives a cue its own SEQ and marks it as a timed gateway command
+ * Nanos keep a dedup window per source, so replaying a song never collides
+ * with SEQs the hub already used.
+ */
+static void stampCue(uint8_t *payload)
+{
+  if (++playerSeq == 0)
+  {
+    playerSeq = 1;
+  }
+  payload[0] = (playerSeq >> 8) & 0xFF;
+  payload[1] = playerSeq & 0xFF;
+  payload[2] = (payload[2] & ~SOURCE_MASK) | (SOURCE_GATEWAY << SOURCE_SHIFT) | FLAG_SYNC;
+}
+
+/**
+ * @brief Builds one frame from the cues at the next offset
+ * A single cue becomes a SYNC frame, several share a batch frame.
+ */
+static uint8_t buildCueFrame(uint32_t startMs, uint8_t *frame)
+{
+  uint32_t offsetMs = timeline[nextCue].offsetMs;
+  uint8_t count = 0;
+
+  while (nextCue < timelineCount && timeline[nextCue].offsetMs == offsetMs && count < BATCH_MAX_COMMANDS)
+  {
+    uint8_t *entry = &frame[BATCH_HEADER_SIZE + count * ESPNOW_PAYLOAD_SIZE];
+    memcpy(entry, timeline[nextCue].payload, ESPNOW_PAYLOAD_SIZE);
+    stampCue(entry);
+    nextCue++;
+    count++;
+  }
+
+  uint8_t start[EXECUTE_AT_SIZE] = {
+      static_cast<uint8_t>(startMs >> 24),
+      static_cast<uint8_t>(startMs >> 16),
+      static_cast<uint8_t>(startMs >> 8),
+      static_cast<uint8_t>(startMs)};
+
+  if (count == 1)
+  {
+    memmove(frame, &frame[BATCH_HEADER_SIZE], ESPNOW_PAYLOAD_SIZE);
+    memcpy(&frame[ESPNOW_PAYLOAD_SIZE], start, EXECUTE_AT_SIZE);
+    return SYNC_FRAME_SIZE;
+  }
+
+  frame[0] = BATCH_MARKER;
+  frame[1] = count;
+  memcpy(&frame[2], start, EXECUTE_AT_SIZE);
+  return BATCH_HEADER_SIZE + count * ESPNOW_PAYLOAD_SIZE;
+}
+
+void initTimeline(void (*wake)())
+{
+  wakeCallback = wake;
+  timelineMutex = xSemaphoreCreateMutex();
+
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = onWakeTimer;
+  timerArgs.name = "timeline";
+  if (esp_timer_create(&timerArgs, &wakeTimer) != ESP_OK)
+  {
+    // The radio task still polls every tick, cues are only less punctual
+    wakeTimer = nullptr;
+  }
+}
+
+bool storeTimelineChunk(const uint8_t *data, size_t len, uint16_t &count)
+{
+  if (len < 3)
+  {
+    return false;
+  }
+
+  uint16_t start = (static_cast<uint16_t>(data[0]) << 8) | data[1];
+  uint8_t n = data[2];
+  bool accepted = true;
+
+  xSemaphoreTake(timelineMutex, portMAX_DELAY);
+
+  if (playing || len < 3 + static_cast<size_t>(n) * TIMELINE_ENTRY_SIZE)
+  {
+    accepted = false;
+  }
+  else
+  {
+    if (start == 0)
+    {
+      timelineCount = 0;
+      nextCue = 0;
+    }
+
+    if (start == timelineCount && start + n > TIMELINE_MAX_ENTRIES)
+    {
+      accepted = false;
+    }
+    else if (start == timelineCount)
+    {
+      const uint8_t *entry = &data[3];
+      for (uint8_t i = 0; i < n; i++, entry += TIMELINE_ENTRY_SIZE)
+      {
+        uint32_t offsetMs = readU32(entry);
+        if (timelineCount > 0 && offsetMs < timeline[timelineCount - 1].offsetMs)
+        {
+          accepted = false;
+          break;
+        }
+
+        timeline[timelineCount].offsetMs = offsetMs;
+        memcpy(timeline[timelineCount].payload, &entry[4], ESPNOW_PAYLOAD_SIZE);
+        timelineCount++;
+      }
+    }
+  }
+
+  count = timelineCount;
+  xSemaphoreGive(timelineMutex);
+  return accepted;
+}
+
+bool applyTimelineAction(TimelineAction action, uint32_t a, uint32_t b, uint32_t nowMs)
+{
+  uint32_t atMs = b != 0 ? b : nowMs + TIMELINE_LEAD_MS;
+  bool ok = true;
+
+  xSemaphoreTake(timelineMutex, portMAX_DELAY);
+
+  switch (action)
+  {
+  case TimelineAction::PLAY:
+    moveTo(a, atMs);
+    playing = timelineCount > 0;
+    ok = playing;
+    break;
+
+  case TimelineAction::STOP:
+    playing = false;
+    disarmWake();
+    break;
+
+  case TimelineAction::SEEK:
+    moveTo(a, atMs);
+    break;
+
+  case TimelineAction::TEMPO:
+    if (a < TIMELINE_TEMPO_MIN || a > TIMELINE_TEMPO_MAX)
+    {
+      ok = false;
+      break;
+    }
+    // Rebase at the current position, cues already sent keep their time
+    anchorPositionMs = positionAt(nowMs);
+    anchorNetworkMs = static_cast<int32_t>(anchorNetworkMs - nowMs) > 0 ? anchorNetworkMs : nowMs;
+    tempo = static_cast<uint16_t>(a);
+    break;
+
+  default:
+    ok = false;
+    break;
+  }
+
+  xSemaphoreGive(timelineMutex);
+
+  if (ok && wakeCallback != nullptr)
+  {
+    wakeCallback();
+  }
+  return ok;
+}
+
+uint8_t nextTimelineFrame(uint32_t nowMs, uint8_t *frame)
+{
+  // Never wait on the serial task, the next tick tries again
+  if (timelineMutex == nullptr || xSemaphoreTake(timelineMutex, 0) != pdTRUE)
+  {
+    return 0;
+  }
+
+  uint8_t length = 0;
+
+  if (playing && nextCue >= timelineCount)
+  {
+    playing = false;
+  }
+
+  if (playing)
+  {
+    uint32_t startMs = networkTimeFor(timeline[nextCue].offsetMs);
+    if (static_cast<int32_t>(startMs - nowMs) <= static_cast<int32_t>(TIMELINE_LEAD_MS))
+    {
+      length = buildCueFrame(startMs, frame);
+    }
+    else
+    {
+      armWake(startMs - TIMELINE_LEAD_MS, nowMs);
+    }
+  }
+
+  xSemaphoreGive(timelineMutex);
+  return length;
+}
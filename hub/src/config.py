@@ -14,7 +14,10 @@ class Settings(BaseSettings):
 
     SERIAL_PORTS: List[str] = ["/dev/ttyUSB0", "/dev/ttyACM0"]
     SERIAL_BAUD: int = 115200
+    SERIAL_FAST_BAUD: int = 921600  # COBS link after negotiation, 0 = legacy frames only
     HEARTBEAT_INTERVAL_MS: int = 5000
+    GATEWAY_STATS_INTERVAL_MS: int = 1000  # Gateway-Statistik abfragen, 0 = aus
+    GATEWAY_LOG_LEVEL: int = 2  # 0=Error, 1=Warn, 2=Info, 3=Debug (jeder TX-Frame)
 
     WIFI_SSID: str = "uzepatscher_lichtshow"
     WIFI_PASSWORD: str = "kWalkingLight"
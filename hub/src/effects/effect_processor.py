@@ -1,5 +1,5 @@
 from dataclasses import dataclass
-from typing import List
+from typing import List, Optional
 from ..nano_network.nano_manager import NanoManager
 from .effect_config import ColorEffectConfig
 from .effect_types import EffectType
@@ -53,7 +53,8 @@ class EffectSettings:
 	speed: int = 0
 	length: int = 0
 	intensity: int = 255
-	duration: int = 0  # Dauer in ms
+	duration: int = 0  # Ueberblendzeit vom vorherigen Effekt in ms, 0 = sofort
+	execute_at: Optional[int] = None  # Netzwerk-Zeit in ms, None = sofort
 
 	def __post_init__(self):
 		if self.rgb is None:
@@ -85,7 +86,7 @@ class EffectProcessor:
 			print(f"Debug: Settings for effect {effect_number}: {settings}")
 			config = self._create_config(effect_number, settings)
 			print(f"Debug: Created config for effect {effect_number}: {config}")
-			await self._create_normal_effect(config)
+			await self._create_normal_effect(config, settings.execute_at)
 
 		except ValueError as e:
 			print(f"Warning: {e}")
@@ -109,11 +110,12 @@ class EffectProcessor:
 			duration_ms=settings.duration
 		)
 
-	async def _create_normal_effect(self, config: ColorEffectConfig) -> None:
+	async def _create_normal_effect(self, config: ColorEffectConfig, execute_at: Optional[int] = None) -> None:
 		"""
 		Create and broadcast a normal effect
 
 		@param {ColorEffectConfig} config - Effect configuration
+		@param {int} execute_at - Network time in ms to execute at (None = immediately)
 		"""
 		command_code = EFFECT_NOTE_TO_COMMAND.get(config.effect_number, config.effect_number)
 		print(f"Debug: Creating effect - Note {config.effect_number} -> Command 0x{command_code:02X} for registers {config.target_registers}")
@@ -134,9 +136,9 @@ class EffectProcessor:
 
 		# Send all registers in ONE command (combined bitmask)
 		if config.target_registers:
-			await self.nano_manager.broadcast_command(command, target_registers=config.target_registers)
+			await self.nano_manager.broadcast_command(command, target_registers=config.target_registers, execute_at=execute_at)
 		else:
-			await self.nano_manager.broadcast_command(command)
+			await self.nano_manager.broadcast_command(command, execute_at=execute_at)
 
 
 effect_processor = EffectProcessor()
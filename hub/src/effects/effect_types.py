@@ -1,10 +1,11 @@
+# Generated by nano/generate_effects.py from nano/effects.json - do not edit
 from enum import Enum
 
 
 class EffectType(Enum):
 	"""
 	Enumeration of all available LED effects.
-	IDs must match nano/include/constants.h and PROTOCOL.md
+	IDs come from nano/effects.json, like the Nano firmware and PROTOCOL.md
 	"""
 	SOLID = 0x20
 	BLINK = 0x21
@@ -64,9 +65,9 @@ class EffectType(Enum):
 		Check if an effect ID is valid.
 
 		@param {int} effect_id - Effect ID to check
-		@returns {bool} True if valid effect ID
+		@returns {bool} True if the Nano knows the effect
 		"""
-		return 0x20 <= effect_id <= 0x3A
+		return effect_id in EFFECT_INFO
 
 
 # Effect ID constants for direct import
@@ -93,3 +94,30 @@ EFFECT_STACKING = 0x37
 EFFECT_MARQUEE = 0x38
 EFFECT_RIPPLE = 0x39
 EFFECT_PLASMA = 0x3A
+
+# Name, default speed (ms per step) and default length of every effect
+EFFECT_INFO = {
+	EFFECT_SOLID: {"name": "Solid", "speed": 50, "length": 0},
+	EFFECT_BLINK: {"name": "Blink", "speed": 50, "length": 0},
+	EFFECT_RAINBOW: {"name": "Rainbow", "speed": 50, "length": 0},
+	EFFECT_RAINBOW_CYCLE: {"name": "Rainbow Cycle", "speed": 50, "length": 0},
+	EFFECT_CHASE: {"name": "Chase", "speed": 50, "length": 3},
+	EFFECT_THEATER_CHASE: {"name": "Theater Chase", "speed": 50, "length": 0},
+	EFFECT_TWINKLE: {"name": "Twinkle", "speed": 50, "length": 10},
+	EFFECT_FIRE: {"name": "Fire", "speed": 50, "length": 0},
+	EFFECT_PULSE: {"name": "Pulse", "speed": 50, "length": 40},
+	EFFECT_GRADIENT: {"name": "Gradient", "speed": 50, "length": 0},
+	EFFECT_WAVE: {"name": "Wave", "speed": 50, "length": 10},
+	EFFECT_METEOR: {"name": "Meteor", "speed": 50, "length": 4},
+	EFFECT_DNA: {"name": "DNA Helix", "speed": 50, "length": 10},
+	EFFECT_BOUNCE: {"name": "Bounce", "speed": 50, "length": 3},
+	EFFECT_COLOR_WIPE: {"name": "Color Wipe", "speed": 50, "length": 0},
+	EFFECT_SCANNER: {"name": "Scanner", "speed": 50, "length": 5},
+	EFFECT_CONFETTI: {"name": "Confetti", "speed": 50, "length": 0},
+	EFFECT_LIGHTNING: {"name": "Lightning", "speed": 50, "length": 8},
+	EFFECT_POLICE: {"name": "Police", "speed": 50, "length": 0},
+	EFFECT_STACKING: {"name": "Stacking", "speed": 50, "length": 0},
+	EFFECT_MARQUEE: {"name": "Marquee", "speed": 50, "length": 5},
+	EFFECT_RIPPLE: {"name": "Ripple", "speed": 50, "length": 3},
+	EFFECT_PLASMA: {"name": "Plasma", "speed": 50, "length": 0},
+}
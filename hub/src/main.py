@@ -6,7 +6,9 @@ from fastapi import FastAPI, HTTPException
 from fastapi.middleware.cors import CORSMiddleware
 from src.hub_api.routes import router as hub_router
 from src.nano_network.api import router as nano_router
-from src.nano_network.serial_gateway import SerialGateway
+from src.nano_network.serial_gateway import (
+	SerialGateway, ECHO_STAGES, GROUP_BROADCAST, SCENE_COUNT, STATS_LATENCY_BOUNDS_MS, STRESS_STOP
+)
 from src.nano_network.nano_manager import NanoManager
 from src.nano_network.hotspot import check_hotspot_status
 from src.config import settings
@@ -54,6 +56,7 @@ async def lifespan(app: FastAPI):
 	if gateway.connect():
 		await gateway.start_heartbeat_loop()
 		await gateway.start_read_loop()
+		await gateway.start_stats_loop()
 		print("Serial gateway initialized and heartbeat started")
 	else:
 		print("Warning: Serial gateway not connected - no device found")
@@ -91,12 +94,101 @@ async def get_gateway_status():
 	}
 
 
+@app.get("/gateway/stats")
+async def get_gateway_stats():
+	"""Get the latest gateway stats snapshot and the recent history for graphs."""
+	return {
+		"latency_bounds_ms": STATS_LATENCY_BOUNDS_MS,
+		"latest": gateway.gateway_stats,
+		"history": list(gateway.stats_history)
+	}
+
+
+@app.post("/gateway/echo/{mac}")
+async def run_echo_benchmark(mac: str, count: int = 20):
+	"""Send echo probes to one Nano, one after another, and return the stage breakdown."""
+	if not gateway.is_connected:
+		raise HTTPException(status_code=503, detail="Gateway not connected")
+
+	count = max(1, min(count, 200))
+	samples = []
+	for _ in range(count):
+		sample = await gateway.echo_probe(mac)
+		if sample:
+			samples.append(sample)
+
+	median = {}
+	for name in ["hub_us", "serial_us", *ECHO_STAGES]:
+		values = sorted(s[name] for s in samples if s[name] is not None)
+		median[name] = values[len(values) // 2] if values else None
+
+	return {
+		"mac": mac,
+		"sent": count,
+		"answered": len(samples),
+		"median": median,
+		"samples": samples
+	}
+
+
+@app.post("/gateway/stress")
+async def run_stress_test(rate: int = 100, seconds: float = 5.0, groups: int = GROUP_BROADCAST):
+	"""Run one stress step at the given frame rate and return what each Nano received."""
+	if not gateway.is_connected:
+		raise HTTPException(status_code=503, detail="Gateway not connected")
+
+	result = await gateway.run_stress_step(rate, seconds, groups)
+	if result is None:
+		raise HTTPException(status_code=503, detail="Stress test could not be started")
+	return result
+
+
+@app.post("/gateway/stress/stop")
+async def stop_stress_test():
+	"""Stop a running stress test."""
+	return {"success": gateway.send_stress(STRESS_STOP)}
+
+
+@app.post("/gateway/scenes/{table_id}")
+async def upload_scene_table(table_id: int, scenes: list):
+	"""
+	Upload a scene table to the Nanos. Each entry is a command with its scene id:
+	{"scene": 3, "effect": 32, "groups": 2, "r": 255, ...}. One scene id may be
+	listed once per group to give every instrument its own look.
+	"""
+	if not gateway.is_connected:
+		raise HTTPException(status_code=503, detail="Gateway not connected")
+
+	entries = []
+	for scene in scenes:
+		scene = dict(scene)
+		scene_id = scene.pop("scene", -1)
+		if not 0 <= scene_id < SCENE_COUNT:
+			raise HTTPException(status_code=400, detail=f"Invalid scene id {scene_id}")
+		entries.append((scene_id, gateway.build_payload(seq=0, flags=scene.pop("flags", 0), **scene)))
+
+	if not await gateway.upload_scenes(table_id, entries):
+		raise HTTPException(status_code=503, detail="Scene upload needs the fast link")
+	return {"table_id": table_id, "entries": len(entries)}
+
+
+@app.post("/gateway/scenes/{table_id}/trigger")
+async def trigger_scene(table_id: int, pairs: list, delay_ms: int = 0):
+	"""Fire stored scenes, pairs are [groups, scene id] or [groups, scene id, intensity]."""
+	execute_at = None
+	if delay_ms > 0 and gateway.has_network_time:
+		execute_at = gateway.network_time_ms() + delay_ms
+
+	return {"success": gateway.trigger_scenes(table_id, pairs, execute_at)}
+
+
 @app.post("/gateway/reconnect")
 async def reconnect_gateway():
 	"""Attempt to reconnect the serial gateway."""
 	if gateway.connect():
 		if not gateway._heartbeat_task:
 			await gateway.start_heartbeat_loop()
+		await gateway.start_stats_loop()
 		return {"status": "connected"}
 
 	raise HTTPException(status_code=503, detail="No serial device found")
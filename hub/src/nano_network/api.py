@@ -5,6 +5,10 @@ from typing import Optional
 from datetime import datetime
 from pathlib import Path
 from .nano_manager import NanoManager
+from .serial_gateway import (
+	BLEND_MAX, BLEND_MULTIPLY, LAYER_MAX, SEGMENT_ALL, SEGMENT_MAX, SEGMENT_MIRROR, SEGMENT_REVERSE,
+	register_to_group_bitmask
+)
 from ..config import settings
 
 router = APIRouter()
@@ -20,6 +24,21 @@ class ConfigureNanoRequest(BaseModel):
 	standby_b: int = 255
 
 
+class SegmentRequest(BaseModel):
+	segment: int
+	start: int = 0
+	count: int = 0
+	reverse: bool = False
+	mirror: bool = False
+
+
+class LayerMixRequest(BaseModel):
+	layer: int
+	blend: int = BLEND_MAX
+	opacity: int = 255
+	segment: int = SEGMENT_ALL
+
+
 @router.get("/nano/status")
 async def get_nano_status():
 	"""Get status of all connected nanos"""
@@ -101,6 +120,48 @@ async def configure_nano(mac: str, config: ConfigureNanoRequest):
 	}
 
 
+@router.post("/nano/segments/{register}")
+async def set_nano_segment(register: int, request: SegmentRequest):
+	"""
+	Define a strip segment on all Nanos of a register. Segment 0 resets them
+	to one segment over the whole strip, a count of 0 removes the segment.
+	"""
+	if not 0 <= request.segment <= SEGMENT_MAX:
+		raise HTTPException(status_code=400, detail=f"Segment must be 0-{SEGMENT_MAX}")
+
+	flags = (SEGMENT_REVERSE if request.reverse else 0) | (SEGMENT_MIRROR if request.mirror else 0)
+	success = nano_manager.gateway.send_segment_config(
+		groups=register_to_group_bitmask(register),
+		segment=request.segment,
+		start=request.start,
+		count=request.count,
+		flags=flags
+	)
+
+	if not success:
+		raise HTTPException(status_code=500, detail="Failed to send segment config")
+	return {"status": "success", "register": register, "segment": request.segment}
+
+
+@router.post("/nano/layers/{register}")
+async def set_nano_layer_mix(register: int, request: LayerMixRequest):
+	"""Set blend mode (0 alpha, 1 add, 2 max, 3 multiply) and opacity of an effect layer."""
+	if not 0 <= request.layer < LAYER_MAX or not 0 <= request.blend <= BLEND_MULTIPLY:
+		raise HTTPException(status_code=400, detail="Invalid layer or blend mode")
+
+	success = nano_manager.gateway.send_layer_mix(
+		groups=register_to_group_bitmask(register),
+		layer=request.layer,
+		blend=request.blend,
+		opacity=max(0, min(request.opacity, 255)),
+		segment=request.segment
+	)
+
+	if not success:
+		raise HTTPException(status_code=500, detail="Failed to send layer mix")
+	return {"status": "success", "register": register, "layer": request.layer}
+
+
 @router.delete("/nano/{mac}")
 async def remove_nano(mac: str):
 	"""Remove a nano from the system"""
@@ -11,6 +11,7 @@ from dataclasses import asdict
 import asyncio
 import json
 import os
+import time
 
 from ..websocket.websocket_manager import websocket_manager
 from .nano_info import NanoInfo, Position, PairingStatus
@@ -25,6 +26,7 @@ from .serial_gateway import (
 	COMMAND_SOLID,
 	MSG_TYPE_PAIRING,
 	MSG_TYPE_CONFIG_ACK,
+	TELEMETRY_INTERVAL_S,
 )
 
 
@@ -237,7 +239,7 @@ class NanoManager:
 						r=rgb[0],
 						g=rgb[1],
 						b=rgb[2],
-						duration=1000
+						duration=0
 					)
 					setattr(info, "gwaendli_color", updates["gwaendli_color"])
 					print(f"Updated gwaendli_color for {mac}: {updates['gwaendli_color']}")
@@ -265,7 +267,7 @@ class NanoManager:
 				self.gateway.send_command(
 					effect=COMMAND_BLINK,
 					groups=groups,
-					duration=1000,
+					duration=0,
 					r=255,
 					g=0,
 					b=0,
@@ -338,6 +340,7 @@ class NanoManager:
 		target_register: Optional[int] = None,
 		target_registers: Optional[List[int]] = None,
 		target_mac: Optional[str] = None,
+		execute_at: Optional[int] = None,
 		**kwargs
 	) -> bool:
 		"""
@@ -359,16 +362,18 @@ class NanoManager:
 		@param {int} target_register - Target register (1=all, 2-15=specific groups)
 		@param {List[int]} target_registers - List of registers (combined into single bitmask)
 		@param {str} target_mac - Ignored (kept for backwards compatibility)
+		@param {int} execute_at - Network time in ms to execute at (None = immediately)
 		@param {dict} kwargs - Additional parameters for new format
 		@returns {bool} True if sent successfully
 		"""
 		if isinstance(command, (bytes, list)):
-			return self._broadcast_legacy_command(command, target_register, target_registers, target_mac)
+			return self._broadcast_legacy_command(command, target_register, target_registers, target_mac, execute_at)
 
 		return self._broadcast_new_command(
 			effect=command,
 			target_register=target_register,
 			target_registers=target_registers,
+			execute_at=execute_at,
 			**kwargs
 		)
 
@@ -377,7 +382,8 @@ class NanoManager:
 		command,
 		target_register: Optional[int] = None,
 		target_registers: Optional[List[int]] = None,
-		target_mac: Optional[str] = None
+		target_mac: Optional[str] = None,
+		execute_at: Optional[int] = None
 	) -> bool:
 		"""
 		Broadcast a legacy 11-byte command.
@@ -386,6 +392,7 @@ class NanoManager:
 		@param {int} target_register - Target register (single)
 		@param {List[int]} target_registers - List of registers (combined into bitmask)
 		@param {str} target_mac - MAC address (used to look up register)
+		@param {int} execute_at - Network time in ms to execute at (None = immediately)
 		@returns {bool} True if sent successfully
 		"""
 		if isinstance(command, list):
@@ -430,7 +437,8 @@ class NanoManager:
 			g=green,
 			b=blue,
 			speed=speed,
-			intensity=intensity
+			intensity=intensity,
+			execute_at=execute_at
 		)
 
 	def _broadcast_new_command(
@@ -446,7 +454,8 @@ class NanoManager:
 		rainbow: int = 0,
 		speed: int = 0,
 		length: int = 0,
-		flags: int = 0
+		flags: int = 0,
+		execute_at: Optional[int] = None
 	) -> bool:
 		"""
 		Broadcast a command using new format.
@@ -454,7 +463,7 @@ class NanoManager:
 		@param {int} effect - Effect/command ID
 		@param {int} target_register - Target register (1=all, 2-15=specific groups)
 		@param {List[int]} target_registers - List of registers (combined into bitmask)
-		@param {int} duration - Effect duration in ms
+		@param {int} duration - Crossfade from the previous effect in ms (0 = switch at once)
 		@param {int} intensity - Brightness (0-255)
 		@param {int} red - Red value (0-255)
 		@param {int} green - Green value (0-255)
@@ -463,6 +472,7 @@ class NanoManager:
 		@param {int} speed - Animation speed in ms
 		@param {int} length - Effect parameter
 		@param {int} flags - Command flags
+		@param {int} execute_at - Network time in ms to execute at (None = immediately)
 		@returns {bool} True if sent successfully
 		"""
 		# Combine multiple registers into one bitmask
@@ -486,7 +496,8 @@ class NanoManager:
 			g=green,
 			b=blue,
 			speed=speed,
-			intensity=intensity
+			intensity=intensity,
+			execute_at=execute_at
 		)
 
 	def broadcast_command_bytes(
@@ -527,17 +538,28 @@ class NanoManager:
 		"""
 		Get all known nanos with their info.
 
-		Note: With ESP-NOW broadcast, we can't know actual connection status.
-		All nanos are assumed to be reachable if within range.
+		Status comes from the Nano's status beacons: online if one arrived
+		within three beacon intervals, offline if not, broadcast for Nanos
+		that never sent one (older firmware).
 
 		@returns {dict} MAC -> nano data mapping
 		"""
 		result = {}
+		now = time.time()
 
 		for mac, info in self.nano_info.items():
+			telemetry = self.gateway.nano_telemetry.get(mac)
+			if telemetry is None:
+				status = "broadcast"
+			elif now - telemetry["time"] < 3 * TELEMETRY_INTERVAL_S:
+				status = "online"
+			else:
+				status = "offline"
+
 			result[mac] = {
 				"mac": mac,
-				"status": "broadcast",
+				"status": status,
+				"telemetry": telemetry,
 				"name": info.name,
 				"color": info.color,
 				"gwaendli_color": info.gwaendli_color,
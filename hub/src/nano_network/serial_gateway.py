@@ -9,20 +9,114 @@ Frame Format (18 Bytes):
 │ START  │                    PAYLOAD (16 Bytes)                        │ CHECKSUM │
 │  0xAA  │                                                              │  (XOR)   │
 └────────┴──────────────────────────────────────────────────────────────┴──────────┘
+
+Timed Frame (22 Bytes): START 0xAC + PAYLOAD + EXECUTE_AT (uint32 ms Netzwerk-Zeit) + CHECKSUM
+
+Fast Link (nach Aushandlung mit COMMAND_SERIAL_MODE): COBS-Pakete mit 0x00 als Trenner,
+dekodiert [TYPE 0x01][COUNT][COUNT x ([LEN][PAYLOAD + optional EXECUTE_AT])][CRC-16]
 """
 
 import asyncio
 import serial
 import os
+import time
+from collections import deque
 from typing import Optional
 from ..config import settings
 
 START_BYTE = 0xAA
 START_BYTE_UPSTREAM = 0xBB
+START_BYTE_TIMED = 0xAC
 FRAME_SIZE = 18
+TIMED_FRAME_SIZE = 22
 UPSTREAM_FRAME_SIZE_PAIRING = 9
 UPSTREAM_FRAME_SIZE_CONFIG_ACK = 10
+UPSTREAM_FRAME_SIZE_TIME = 13
 PAYLOAD_SIZE = 16
+UPSTREAM_FRAME_SIZE_SERIAL_MODE = 10
+UPSTREAM_FRAME_SIZE_TIMELINE = 12
+UPSTREAM_LOG_OVERHEAD = 5  # [0xBB][0x06][level][length] + text + CRC-8
+UPSTREAM_STATS_OVERHEAD = 4  # [0xBB][0x07][length] + counters + CRC-8
+UPSTREAM_FRAME_SIZE_ECHO = 31
+UPSTREAM_FRAME_SIZE_STRESS = 33
+UPSTREAM_TELEMETRY_OVERHEAD = 4  # [0xBB][0x0A][length] + beacons + CRC-8
+
+# Fast link: COBS framed command batches at a negotiated baud rate
+LINK_PACKET_COMMANDS = 0x01
+LINK_PACKET_TIMELINE = 0x02
+LINK_PACKET_TRANSPORT = 0x03
+LINK_PACKET_SCENES = 0x04
+LINK_MAX_COMMANDS = 32
+LINK_BAUD_RATES = [115200, 230400, 460800, 921600]
+LINK_TIMEOUT_S = 5.0  # no time report from the gateway, fall back to legacy frames
+LINK_REQUEST_ATTEMPTS = 3  # older gateways don't answer, stop asking
+
+# Cue timeline, played by the gateway (see PROTOCOL.md)
+TIMELINE_MAX_ENTRIES = 2048
+TIMELINE_CHUNK_ENTRIES = 32
+TIMELINE_ACK_TIMEOUT_S = 0.5
+TIMELINE_ATTEMPTS = 3
+TIMELINE_ACK_OK = 0x00
+TIMELINE_PLAY = 0x01
+TIMELINE_STOP = 0x02
+TIMELINE_SEEK = 0x03
+TIMELINE_TEMPO = 0x04
+
+# Echo benchmark: gateway stages in us, in the order of the echo report
+ECHO_STAGES = ["gateway_queue_us", "air_out_us", "nano_us", "air_back_us", "gateway_us"]
+ECHO_UNSYNCED = 0xFFFFFFFF  # Nano without network time, only the air sum is known
+ECHO_TIMEOUT_S = 1.0
+
+# Stress test: gateway sends numbered frames, Nanos count what arrives
+STRESS_START = 0x01
+STRESS_STOP = 0x02
+STRESS_REPORT = 0x03
+STRESS_MAX_RATE = 1000
+STRESS_MAX_FRAMES = 0xFFFF
+STRESS_COUNTERS = [
+	"received", "duplicates", "out_of_order", "missing", "avg_processing_us", "max_processing_us",
+]
+STRESS_SETTLE_S = 0.5  # TX queue and mesh relays drain before the report request
+STRESS_REPORT_WAIT_S = 1.0  # Nanos answer within 500 ms
+
+# Strip segments: effect commands pick one (1-based, 0 = all) in the upper nibble of [9]
+SEGMENT_ALL = 0
+SEGMENT_MAX = 8
+SEGMENT_REVERSE = 0x01
+SEGMENT_MIRROR = 0x02
+
+# Effect layers per segment (0 = base), picked by bits 3-2 of [9]
+LAYER_MAX = 4
+BLEND_ALPHA = 0
+BLEND_ADD = 1
+BLEND_MAX = 2
+BLEND_MULTIPLY = 3
+
+# Scene memory: tables uploaded to the Nanos, fired by scene id (see PROTOCOL.md)
+SCENE_STORE_MARKER = 0xB7
+SCENE_TRIGGER_MARKER = 0xB6
+SCENE_COUNT = 256
+SCENE_STORE_MAX_ENTRIES = 14
+SCENE_TRIGGER_MAX_PAIRS = 32
+SCENE_KEEP_INTENSITY = 0xFF
+SCENE_UPLOAD_PASSES = 2  # Nanos drop the second copy by SEQ, it only covers lost frames
+SCENE_FRAME_INTERVAL_S = 0.02
+
+# Nano status beacons, batched by the gateway: MAC + 16 beacon bytes each
+TELEMETRY_ENTRY_SIZE = 22
+TELEMETRY_INTERVAL_S = 10.0
+NANO_STATE_NAMES = [
+	"init", "unconfigured", "pairing", "connecting", "standby", "active", "blackout", "disconnected",
+]
+
+# Network time (gateway clock) tracking for timed frames
+TIME_SAMPLE_WINDOW = 16
+TIME_STEP_THRESHOLD_MS = 50
+TIME_SYNC_TIMEOUT_S = 5.0
+
+# Timed frames are sent again until shortly before they are due
+TIMED_RETRANSMITS = 2
+TIMED_RETRANSMIT_INTERVAL_S = 0.04
 
 COMMAND_NOP = 0x00
 COMMAND_HEARTBEAT = 0x01
@@ -34,6 +128,8 @@ COMMAND_SAVE_CONFIG = 0x06
 COMMAND_REBOOT = 0x07
 COMMAND_FACTORY_RESET = 0x0A
 COMMAND_SET_MESH_TTL = 0x0B
+COMMAND_SET_SEGMENT = 0x0C
+COMMAND_SET_LAYER = 0x0D
 
 COMMAND_STATE_OFF = 0x10
 COMMAND_STATE_STANDBY = 0x11
@@ -68,6 +164,9 @@ COMMAND_PLASMA = 0x3A
 COMMAND_DEBUG_ECHO = 0xF0
 COMMAND_DEBUG_INFO = 0xF1
 COMMAND_DEBUG_STRESS = 0xF2
+COMMAND_SERIAL_MODE = 0xF8  # handled by the gateway, never sent over the air
+COMMAND_LOG_LEVEL = 0xF9  # handled by the gateway, never sent over the air
+COMMAND_STATS = 0xFA  # handled by the gateway, never sent over the air
 
 COMMAND_PAIRING_REQUEST = 0xA0
 COMMAND_PAIRING_ACK = 0x81
@@ -76,6 +175,25 @@ COMMAND_CONFIG_ACK = 0x83
 
 MSG_TYPE_PAIRING = 0x01
 MSG_TYPE_CONFIG_ACK = 0x02
+MSG_TYPE_TIME = 0x03
+MSG_TYPE_SERIAL_MODE = 0x04
+MSG_TYPE_TIMELINE = 0x05
+MSG_TYPE_LOG = 0x06
+MSG_TYPE_STATS = 0x07
+MSG_TYPE_ECHO = 0x08
+MSG_TYPE_STRESS = 0x09
+MSG_TYPE_TELEMETRY = 0x0A
+
+LOG_LEVEL_NAMES = ["ERROR", "WARN", "INFO", "DEBUG"]
+
+# Stats frame data: uint32 counters, two uint8 queue values, latency histogram
+STATS_COUNTERS = [
+	"uptime_ms", "frames_in", "frames_sent", "checksum_errors", "resyncs", "send_failures",
+	"tx_retries", "tx_expired", "tx_overflows", "upstream_dropped", "serial_bytes_per_s",
+]
+STATS_LATENCY_BOUNDS_MS = [1, 2, 5, 10, 20, 50, 100]  # serial frame complete -> send callback
+STATS_DATA_SIZE = len(STATS_COUNTERS) * 4 + 2 + (len(STATS_LATENCY_BOUNDS_MS) + 1) * 4
+STATS_HISTORY = 600
 
 GROUP_ALL = 0x0001
 GROUP_BROADCAST = 0xFFFF
@@ -85,15 +203,18 @@ FLAG_FORCE = 0x02
 FLAG_SYNC = 0x04
 FLAG_NO_REBROADCAST = 0x08
 
-# TTL configuration (upper 4 bits of flags byte)
+# Flags byte: source (bits 7-6), TTL (bits 5-4), flags (bits 3-0)
 DEFAULT_TTL = 2  # 2 hops from hub
+SOURCE_HUB = 0  # Nanos keep one dedup window per source
+SOURCE_SHIFT = 6
+SOURCE_MASK = 0xC0
 TTL_SHIFT = 4
-TTL_MASK = 0xF0
+TTL_MASK = 0x30
 FLAGS_MASK = 0x0F
 
-def make_flags_byte(ttl: int, flags: int) -> int:
-    """Combine TTL (upper 4 bits) and flags (lower 4 bits) into flags byte."""
-    return ((ttl << TTL_SHIFT) & TTL_MASK) | (flags & FLAGS_MASK)
+def make_flags_byte(ttl: int, flags: int, source: int = SOURCE_HUB) -> int:
+    """Combine source, TTL and flags into the flags byte."""
+    return ((source << SOURCE_SHIFT) & SOURCE_MASK) | ((ttl << TTL_SHIFT) & TTL_MASK) | (flags & FLAGS_MASK)
 
 # CRC-8 lookup table (polynomial 0x07, init 0x00)
 CRC8_TABLE = [
@@ -122,6 +243,33 @@ def calculate_crc8(data: bytes) -> int:
         crc = CRC8_TABLE[crc ^ byte]
     return crc
 
+def calculate_crc16(data: bytes) -> int:
+    """Calculate CRC-16/CCITT-FALSE (polynomial 0x1021, init 0xFFFF)."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+        crc &= 0xFFFF
+    return crc
+
+def cobs_encode(data: bytes) -> bytes:
+    """COBS-encode data so it contains no 0x00 (delimiter not included)."""
+    out = bytearray([0])
+    code_index = 0
+    code = 1
+    for byte in data:
+        if byte != 0:
+            out.append(byte)
+            code += 1
+        if byte == 0 or code == 0xFF:
+            out[code_index] = code
+            code_index = len(out)
+            out.append(0)
+            code = 1
+    out[code_index] = code
+    return bytes(out)
+
 
 class SerialGateway:
 	"""
@@ -149,6 +297,24 @@ class SerialGateway:
 		self._read_task: Optional[asyncio.Task] = None
 		self._connected = False
 		self._message_callbacks = []
+		self._time_samples = deque(maxlen=TIME_SAMPLE_WINDOW)
+		self._time_offset_ms: Optional[float] = None
+		self._last_time_message = 0.0
+		self._fast_link = False
+		self._fast_link_since = 0.0
+		self._fast_link_attempts = 0
+		self._link_entries = []
+		self._link_flush_pending = False
+		self._capture: Optional[list] = None
+		self._timeline_ack: Optional[asyncio.Future] = None
+		self._gateway_log_level: Optional[int] = None
+		self._stats_task: Optional[asyncio.Task] = None
+		self.gateway_stats: Optional[dict] = None
+		self.stats_history = deque(maxlen=STATS_HISTORY)
+		self._echo_id = 0
+		self._echo_probes = {}
+		self.stress_reports = {}
+		self.nano_telemetry = {}
 
 	@property
 	def is_connected(self) -> bool:
@@ -191,6 +357,8 @@ class SerialGateway:
 				timeout=1.0
 			)
 			self._connected = True
+			self._fast_link = False
+			self._fast_link_attempts = 0
 			print(f"Connected to Gateway on {device} @ {settings.SERIAL_BAUD} baud")
 			return True
 
@@ -210,6 +378,10 @@ class SerialGateway:
 			self._read_task.cancel()
 			self._read_task = None
 
+		if self._stats_task:
+			self._stats_task.cancel()
+			self._stats_task = None
+
 		self._cleanup_connection()
 		print("Serial gateway disconnected")
 
@@ -230,21 +402,340 @@ class SerialGateway:
 		"""
 		return ":".join(f"{b:02X}" for b in data)
 
-	async def _process_incoming_message(self, frame: bytes):
+	@property
+	def has_network_time(self) -> bool:
+		return self._time_offset_ms is not None and time.monotonic() - self._last_time_message < TIME_SYNC_TIMEOUT_S
+
+	def network_time_ms(self, at: Optional[float] = None) -> int:
+		"""
+		Convert a time.monotonic() value to gateway network time.
+
+		@param {float} at - Monotonic time in seconds (default: now)
+		@returns {int} Network time in ms (uint32, wraps)
+		"""
+		if at is None:
+			at = time.monotonic()
+		return int(at * 1000 + (self._time_offset_ms or 0)) & 0xFFFFFFFF
+
+	def _on_time_message(self, gateway_ms: int, rx_time: float):
+		"""
+		Update the network time offset from a gateway time report.
+
+		Each sample is offset minus serial delay, so the largest sample in the
+		window is the best estimate.
+
+		@param {int} gateway_ms - Gateway network time in ms
+		@param {float} rx_time - time.monotonic() when the bytes were read
+		"""
+		sample = gateway_ms - rx_time * 1000
+		if self._time_samples and abs(sample - max(self._time_samples)) > TIME_STEP_THRESHOLD_MS:
+			# Gateway reboot or clock wrap
+			self._time_samples.clear()
+			self._gateway_log_level = None
+
+		self._time_samples.append(sample)
+		self._time_offset_ms = max(self._time_samples)
+		self._last_time_message = rx_time
+
+	def request_fast_link(self):
+		"""
+		Ask the gateway to switch to COBS framing at SERIAL_FAST_BAUD, or fall
+		back to legacy frames if the fast link went silent (gateway reboot or
+		idle timeout). Called periodically from the heartbeat loop.
+		"""
+		if not settings.SERIAL_FAST_BAUD or settings.SERIAL_FAST_BAUD not in LINK_BAUD_RATES:
+			return
+
+		if self._fast_link:
+			last_seen = max(self._last_time_message, self._fast_link_since)
+			if time.monotonic() - last_seen > LINK_TIMEOUT_S:
+				print("Fast link lost, back to legacy frames")
+				self._set_link(False)
+			return
+
+		if self.is_connected and self._fast_link_attempts < LINK_REQUEST_ATTEMPTS:
+			self._fast_link_attempts += 1
+			self.send_command(
+				effect=COMMAND_SERIAL_MODE,
+				length=LINK_BAUD_RATES.index(settings.SERIAL_FAST_BAUD)
+			)
+
+	def sync_gateway_log_level(self):
+		"""
+		Send GATEWAY_LOG_LEVEL to the gateway if it may not have it yet
+		(new connection, link switch or gateway reboot). Called from the
+		heartbeat loop.
+		"""
+		level = settings.GATEWAY_LOG_LEVEL
+		if level == self._gateway_log_level or not self.is_connected:
+			return
+
+		if self.send_command(effect=COMMAND_LOG_LEVEL, length=level):
+			self._gateway_log_level = level
+
+	def _on_stats_message(self, data: bytes):
+		"""
+		Store a gateway stats snapshot for the API.
+
+		@param {bytes} data - Stats frame data (see PROTOCOL.md)
+		"""
+		if len(data) < STATS_DATA_SIZE:
+			return
+
+		stats = {"time": time.time()}
+		pos = 0
+		for name in STATS_COUNTERS:
+			stats[name] = int.from_bytes(data[pos:pos + 4], "big")
+			pos += 4
+		stats["tx_high_water"] = data[pos]
+		stats["tx_depth"] = data[pos + 1]
+		pos += 2
+		stats["latency_histogram"] = [
+			int.from_bytes(data[i:i + 4], "big") for i in range(pos, STATS_DATA_SIZE, 4)
+		]
+
+		self.gateway_stats = stats
+		self.stats_history.append(stats)
+
+	def _on_telemetry_message(self, data: bytes):
+		"""
+		Store the latest status beacon of every Nano in the batch.
+
+		@param {bytes} data - Beacon entries (see PROTOCOL.md)
+		"""
+		now = time.time()
+		for pos in range(0, len(data) - TELEMETRY_ENTRY_SIZE + 1, TELEMETRY_ENTRY_SIZE):
+			mac = self._parse_mac(data[pos:pos + 6])
+			beacon = data[pos + 6:pos + TELEMETRY_ENTRY_SIZE]
+			state = beacon[0]
+			previous = self.nano_telemetry.get(mac)
+			missed = 0
+			if previous:
+				# Beacon number 0 after a reboot of the Nano is not a gap
+				gap = (beacon[14] - previous["beacon"] - 1) & 0xFF if beacon[14] else 0
+				missed = previous["beacons_missed"] + gap
+
+			self.nano_telemetry[mac] = {
+				"time": now,
+				"state": NANO_STATE_NAMES[state] if state < len(NANO_STATE_NAMES) else str(state),
+				"firmware": beacon[1],
+				"register": beacon[2],
+				"last_seq": int.from_bytes(beacon[3:5], "big"),
+				"rx_overflows": int.from_bytes(beacon[5:7], "big"),
+				"relays_dropped": int.from_bytes(beacon[7:9], "big"),
+				"max_loop_us": int.from_bytes(beacon[9:11], "big"),
+				"rssi": int.from_bytes(beacon[11:12], "big", signed=True),
+				"battery_mv": int.from_bytes(beacon[12:14], "big"),
+				"beacon": beacon[14],
+				"beacons_missed": missed,
+				"time_synced": bool(beacon[15] & 0x01),
+				"heartbeat_lost": bool(beacon[15] & 0x02),
+			}
+
+	async def start_stats_loop(self):
+		"""Poll gateway stats every GATEWAY_STATS_INTERVAL_MS."""
+		if self._stats_task or settings.GATEWAY_STATS_INTERVAL_MS <= 0:
+			return
+
+		async def stats_loop():
+			interval = settings.GATEWAY_STATS_INTERVAL_MS / 1000.0
+			while True:
+				try:
+					if self.is_connected:
+						self.send_command(effect=COMMAND_STATS)
+					await asyncio.sleep(interval)
+				except asyncio.CancelledError:
+					break
+				except Exception as e:
+					print(f"Stats poll error: {e}")
+					await asyncio.sleep(interval)
+
+		self._stats_task = asyncio.create_task(stats_loop())
+
+	async def echo_probe(self, mac: str, timeout: float = ECHO_TIMEOUT_S) -> Optional[dict]:
+		"""
+		Measure one hub -> gateway -> Nano -> gateway -> hub round trip.
+		The Nano answers a COMMAND_DEBUG_ECHO addressed to its MAC, the gateway
+		reports its own stages. Serial is what the hub saw minus the gateway total.
+
+		@param {str} mac - Nano MAC address
+		@param {float} timeout - Seconds to wait for the echo report
+		@returns {dict} Stage durations in us, None if the Nano did not answer
+		"""
+		self._echo_id = (self._echo_id + 1) & 0xFFFF
+		probe_id = self._echo_id
+		mac_bytes = self._mac_to_bytes(mac)
+		future = asyncio.get_running_loop().create_future()
+		self._echo_probes[probe_id] = future
+
+		try:
+			sent_at = time.monotonic()
+			if not self.send_command(
+				effect=COMMAND_DEBUG_ECHO,
+				flags=FLAG_NO_REBROADCAST,
+				duration=probe_id,
+				r=mac_bytes[0],
+				g=mac_bytes[1],
+				b=mac_bytes[2],
+				speed=(mac_bytes[3] << 8) | mac_bytes[4],
+				intensity=mac_bytes[5]
+			):
+				return None
+			data, rx_time = await asyncio.wait_for(future, timeout)
+		except asyncio.TimeoutError:
+			return None
+		finally:
+			self._echo_probes.pop(probe_id, None)
+
+		result = {"probe": probe_id, "hub_us": int((rx_time - sent_at) * 1_000_000)}
+		for i, name in enumerate(ECHO_STAGES):
+			value = int.from_bytes(data[i * 4:i * 4 + 4], "big")
+			result[name] = None if value == ECHO_UNSYNCED else value
+		result["serial_us"] = result["hub_us"] - result["gateway_us"]
+		return result
+
+	def send_stress(self, action: int, groups: int = GROUP_BROADCAST, rate: int = 0, count: int = 0) -> bool:
+		"""
+		Send a stress test control frame (START, STOP or REPORT).
+
+		@param {int} action - STRESS_START, STRESS_STOP or STRESS_REPORT
+		@param {int} groups - Nanos that count and report
+		@param {int} rate - Frames per second (START)
+		@param {int} count - Frames to send, 0 = until STOP (START)
+		@returns {bool} True if sent successfully
+		"""
+		return self.send_command(
+			effect=COMMAND_DEBUG_STRESS,
+			groups=groups,
+			duration=rate,
+			length=action,
+			r=(count >> 8) & 0xFF,
+			g=count & 0xFF
+		)
+
+	async def run_stress_step(self, rate: int, seconds: float, groups: int = GROUP_BROADCAST) -> Optional[dict]:
+		"""
+		Send rate frames/s for a while and collect what every Nano received.
+		Run steps with rising rates to find where the mesh starts losing frames.
+
+		@param {int} rate - Frames per second (1-1000)
+		@param {float} seconds - Duration of the step
+		@param {int} groups - Nanos that count and report
+		@returns {dict} Frames sent and the report per MAC, None if not sent
+		"""
+		rate = max(1, min(rate, STRESS_MAX_RATE))
+		count = max(1, min(int(rate * seconds), STRESS_MAX_FRAMES))
+		if not self.send_stress(STRESS_START, groups, rate, count):
+			return None
+
+		await asyncio.sleep(count / rate + STRESS_SETTLE_S)
+		self.stress_reports = {}
+		if not self.send_stress(STRESS_REPORT, groups):
+			return None
+		await asyncio.sleep(STRESS_REPORT_WAIT_S)
+
+		reports = dict(self.stress_reports)
+		for report in reports.values():
+			report["loss_pct"] = round(max(0, count - report["received"]) * 100 / count, 2)
+
+		return {"rate": rate, "sent": count, "nanos": reports}
+
+	def _set_link(self, fast: bool, baud_code: int = 0):
+		"""
+		Switch the local port between legacy frames and the fast link.
+
+		@param {bool} fast - True for the COBS link
+		@param {int} baud_code - Index into LINK_BAUD_RATES
+		"""
+		self._link_entries.clear()
+		self._gateway_log_level = None
+		self._fast_link = fast
+		self._fast_link_since = time.monotonic()
+		self._fast_link_attempts = 0
+		baud = LINK_BAUD_RATES[baud_code] if fast else settings.SERIAL_BAUD
+		if self._serial:
+			try:
+				self._serial.baudrate = baud
+			except (serial.SerialException, OSError, ValueError) as e:
+				print(f"Baud rate switch failed: {e}")
+				self._cleanup_connection()
+				return
+		print(f"Serial link: {'COBS' if fast else 'legacy'} @ {baud} baud")
+
+	async def _process_incoming_message(self, frame: bytes, rx_time: float = 0.0):
 		"""
 		Process incoming frame from Gateway.
 
 		Frame formats:
 		- Pairing (0x01): [0xBB][TYPE][MAC 6 bytes][CHECKSUM] = 9 bytes
 		- Config ACK (0x02): [0xBB][TYPE][MAC 6 bytes][STATUS][CHECKSUM] = 10 bytes
-
-		@param {bytes} frame - Incoming frame (9 or 10 bytes)
+		- Time (0x03): [0xBB][TYPE][GATEWAY MAC 6 bytes][TIME 4 bytes][CHECKSUM] = 13 bytes
+		- Serial mode (0x04): [0xBB][TYPE][GATEWAY MAC 6 bytes][BAUD CODE][CHECKSUM] = 10 bytes
+		- Timeline ack (0x05): [0xBB][TYPE][GATEWAY MAC 6 bytes][STATUS][COUNT 2 bytes][CHECKSUM] = 12 bytes
+		- Log (0x06): [0xBB][TYPE][LEVEL][LENGTH][TEXT][CHECKSUM] = 5 + LENGTH bytes
+		- Stats (0x07): [0xBB][TYPE][LENGTH][COUNTERS][CHECKSUM] = 4 + LENGTH bytes
+		- Echo (0x08): [0xBB][TYPE][NANO MAC 6 bytes][PROBE 2 bytes][5 x STAGE 4 bytes][CHECKSUM] = 31 bytes
+		- Stress (0x09): [0xBB][TYPE][NANO MAC 6 bytes][6 x COUNTER 4 bytes][CHECKSUM] = 33 bytes
+		- Telemetry (0x0A): [0xBB][TYPE][LENGTH][n x (NANO MAC 6 bytes + BEACON 16 bytes)][CHECKSUM]
+
+		@param {bytes} frame - Incoming frame (9, 10, 12 or 13 bytes, logs variable)
+		@param {float} rx_time - time.monotonic() when the frame was read
 		"""
+		if len(frame) >= UPSTREAM_LOG_OVERHEAD and frame[1] == MSG_TYPE_LOG:
+			if calculate_crc8(frame[1:-1]) == frame[-1]:
+				level = LOG_LEVEL_NAMES[frame[2]] if frame[2] < len(LOG_LEVEL_NAMES) else str(frame[2])
+				text = frame[4:-1].decode("utf-8", errors="replace")
+				print(f"[GW] {level}: {text}")
+			return
+
+		if len(frame) >= UPSTREAM_STATS_OVERHEAD and frame[1] == MSG_TYPE_STATS:
+			if calculate_crc8(frame[1:-1]) == frame[-1]:
+				self._on_stats_message(frame[3:-1])
+			return
+
+		if len(frame) >= UPSTREAM_TELEMETRY_OVERHEAD and frame[1] == MSG_TYPE_TELEMETRY:
+			if calculate_crc8(frame[1:-1]) == frame[-1]:
+				self._on_telemetry_message(frame[3:-1])
+			return
+
 		if len(frame) < UPSTREAM_FRAME_SIZE_PAIRING:
 			return
 
 		msg_type = frame[1]
 
+		if msg_type == MSG_TYPE_TIME:
+			if calculate_crc8(frame[1:12]) == frame[12]:
+				self._on_time_message(int.from_bytes(frame[8:12], "big"), rx_time)
+			return
+
+		if msg_type == MSG_TYPE_SERIAL_MODE:
+			baud_code = frame[8]
+			if calculate_crc8(frame[1:9]) == frame[9] and baud_code < len(LINK_BAUD_RATES):
+				self._set_link(True, baud_code)
+			return
+
+		if msg_type == MSG_TYPE_ECHO:
+			if len(frame) == UPSTREAM_FRAME_SIZE_ECHO and calculate_crc8(frame[1:-1]) == frame[-1]:
+				probe = self._echo_probes.get(int.from_bytes(frame[8:10], "big"))
+				if probe and not probe.done():
+					probe.set_result((frame[10:30], rx_time))
+			return
+
+		if msg_type == MSG_TYPE_STRESS:
+			if len(frame) == UPSTREAM_FRAME_SIZE_STRESS and calculate_crc8(frame[1:-1]) == frame[-1]:
+				self.stress_reports[self._parse_mac(frame[2:8])] = {
+					name: int.from_bytes(frame[8 + i * 4:12 + i * 4], "big")
+					for i, name in enumerate(STRESS_COUNTERS)
+				}
+			return
+
+		if msg_type == MSG_TYPE_TIMELINE:
+			if calculate_crc8(frame[1:11]) == frame[11]:
+				ack = self._timeline_ack
+				if ack and not ack.done():
+					ack.set_result((frame[8], int.from_bytes(frame[9:11], "big")))
+			return
+
 		if msg_type == MSG_TYPE_CONFIG_ACK:
 			mac = self._parse_mac(frame[2:8])
 			status = frame[8]
@@ -284,6 +775,7 @@ class SerialGateway:
 
 				if self._serial.in_waiting > 0:
 					chunk = self._serial.read(self._serial.in_waiting)
+					rx_time = time.monotonic()
 					buffer.extend(chunk)
 
 					if settings.DEBUG and len(chunk) > 0:
@@ -299,6 +791,22 @@ class SerialGateway:
 
 						if msg_type == MSG_TYPE_CONFIG_ACK:
 							frame_size = UPSTREAM_FRAME_SIZE_CONFIG_ACK
+						elif msg_type == MSG_TYPE_SERIAL_MODE:
+							frame_size = UPSTREAM_FRAME_SIZE_SERIAL_MODE
+						elif msg_type == MSG_TYPE_TIME:
+							frame_size = UPSTREAM_FRAME_SIZE_TIME
+						elif msg_type == MSG_TYPE_TIMELINE:
+							frame_size = UPSTREAM_FRAME_SIZE_TIMELINE
+						elif msg_type == MSG_TYPE_LOG:
+							frame_size = UPSTREAM_LOG_OVERHEAD + buffer[3]
+						elif msg_type == MSG_TYPE_STATS:
+							frame_size = UPSTREAM_STATS_OVERHEAD + buffer[2]
+						elif msg_type == MSG_TYPE_ECHO:
+							frame_size = UPSTREAM_FRAME_SIZE_ECHO
+						elif msg_type == MSG_TYPE_STRESS:
+							frame_size = UPSTREAM_FRAME_SIZE_STRESS
+						elif msg_type == MSG_TYPE_TELEMETRY:
+							frame_size = UPSTREAM_TELEMETRY_OVERHEAD + buffer[2]
 						else:
 							frame_size = UPSTREAM_FRAME_SIZE_PAIRING
 
@@ -307,7 +815,7 @@ class SerialGateway:
 
 						frame = bytes(buffer[:frame_size])
 						buffer = buffer[frame_size:]
-						await self._process_incoming_message(frame)
+						await self._process_incoming_message(frame, rx_time)
 				else:
 					await asyncio.sleep(0.01)
 
@@ -358,7 +866,9 @@ class SerialGateway:
 		b: int = 0,
 		speed: int = 0,
 		intensity: int = 255,
-		ttl: int = DEFAULT_TTL
+		ttl: int = DEFAULT_TTL,
+		segment: int = SEGMENT_ALL,
+		layer: int = 0
 	) -> bytes:
 		"""
 		Build 16-byte payload for serial transmission.
@@ -367,7 +877,7 @@ class SerialGateway:
 		@param {int} flags - Command flags (lower 4 bits)
 		@param {int} effect - Effect/command ID
 		@param {int} groups - Target groups bitmask
-		@param {int} duration - Effect duration in ms
+		@param {int} duration - Crossfade from the previous effect in ms (0 = switch at once)
 		@param {int} length - Effect parameter (e.g., chase length)
 		@param {int} rainbow - Rainbow mode (0=off, 1=on)
 		@param {int} r - Red value (0-255)
@@ -376,6 +886,8 @@ class SerialGateway:
 		@param {int} speed - Animation speed in ms
 		@param {int} intensity - Brightness (0-255)
 		@param {int} ttl - Time-to-live for mesh rebroadcast (upper 4 bits of flags byte)
+		@param {int} segment - Strip segment (1-8), SEGMENT_ALL for all segments
+		@param {int} layer - Effect layer (0 = base, up to LAYER_MAX - 1)
 		@returns {bytes} 16-byte payload
 		"""
 		payload = bytearray(PAYLOAD_SIZE)
@@ -389,7 +901,7 @@ class SerialGateway:
 		payload[6] = (duration >> 8) & 0xFF
 		payload[7] = duration & 0xFF
 		payload[8] = length & 0xFF
-		payload[9] = rainbow & 0xFF
+		payload[9] = ((segment & 0x0F) << 4) | ((layer & 0x03) << 2) | (rainbow & 0x03)
 		payload[10] = r & 0xFF
 		payload[11] = g & 0xFF
 		payload[12] = b & 0xFF
@@ -416,6 +928,287 @@ class SerialGateway:
 
 		return bytes(frame)
 
+	def build_timed_frame(self, payload: bytes, execute_at: int) -> bytes:
+		"""
+		Build 22-byte timed frame: the gateway forwards it as SYNC frame and
+		the nanos hold it until execute_at.
+
+		@param {bytes} payload - 16-byte payload
+		@param {int} execute_at - Network time in ms (see network_time_ms)
+		@returns {bytes} 22-byte frame ready for transmission
+		"""
+		if len(payload) != PAYLOAD_SIZE:
+			raise ValueError(f"Payload must be {PAYLOAD_SIZE} bytes, got {len(payload)}")
+
+		body = payload + (execute_at & 0xFFFFFFFF).to_bytes(4, "big")
+
+		frame = bytearray(TIMED_FRAME_SIZE)
+		frame[0] = START_BYTE_TIMED
+		frame[1:21] = body
+		frame[21] = calculate_crc8(body)
+
+		return bytes(frame)
+
+	def build_link_packet(self, entries: list) -> bytes:
+		"""
+		Build a COBS packet carrying several commands for the fast link.
+
+		@param {list} entries - 16-byte payloads, or 20 bytes with execute-at appended
+		@returns {bytes} Encoded packet with leading and trailing 0x00 delimiter
+		"""
+		body = bytearray([LINK_PACKET_COMMANDS, len(entries)])
+		for entry in entries:
+			body.append(len(entry))
+			body.extend(entry)
+
+		return self._encode_link_body(body)
+
+	def _encode_link_body(self, body: bytearray) -> bytes:
+		"""
+		Append the CRC-16 and COBS-encode a fast link packet.
+
+		@param {bytearray} body - Packet type and content
+		@returns {bytes} Encoded packet with leading and trailing 0x00 delimiter
+		"""
+		body = body + calculate_crc16(body).to_bytes(2, "big")
+		return b"\x00" + cobs_encode(bytes(body)) + b"\x00"
+
+	def _flush_link(self) -> bool:
+		"""
+		Send all commands queued for the fast link in as few packets as possible.
+
+		@returns {bool} True if sent successfully
+		"""
+		self._link_flush_pending = False
+		success = True
+
+		while self._link_entries:
+			entries = self._link_entries[:LINK_MAX_COMMANDS]
+			del self._link_entries[:LINK_MAX_COMMANDS]
+			packet = self.build_link_packet(entries)
+			success = self.send_frame(packet) and success
+
+			if settings.DEBUG:
+				print(f"TX link: {len(entries)} cmd, {len(packet)} bytes")
+
+		return success
+
+	def _send_entry(self, payload: bytes, execute_at: Optional[int] = None) -> bool:
+		"""
+		Send one payload. On the fast link, commands issued in the same event
+		loop iteration are collected and go out as one packet.
+
+		@param {bytes} payload - 16-byte payload
+		@param {int} execute_at - Network time in ms, sends a timed frame
+		@returns {bool} True if sent (or queued) successfully
+		"""
+		if self._capture is not None:
+			self._capture.append((payload, execute_at))
+			return True
+
+		if not self._fast_link:
+			if execute_at is not None:
+				frame = self.build_timed_frame(payload, execute_at)
+			else:
+				frame = self.build_frame(payload)
+
+			success = self.send_frame(frame)
+			if success and settings.DEBUG:
+				hex_frame = " ".join(f"{b:02X}" for b in frame)
+				print(f"TX: {hex_frame}")
+			return success
+
+		if execute_at is not None:
+			payload = payload + (execute_at & 0xFFFFFFFF).to_bytes(4, "big")
+		self._link_entries.append(payload)
+
+		try:
+			loop = asyncio.get_running_loop()
+		except RuntimeError:
+			return self._flush_link()
+
+		if not self._link_flush_pending:
+			self._link_flush_pending = True
+			loop.call_soon(self._flush_link)
+		return True
+
+	@property
+	def has_timeline(self) -> bool:
+		"""Gateway timeline playback needs the fast link and network time."""
+		return self._fast_link and self.has_network_time
+
+	def begin_capture(self):
+		"""
+		Collect sent commands instead of sending them, to render a timeline.
+		execute_at is then the timeline offset in ms, not network time.
+		The caller must not yield to the event loop until end_capture().
+		"""
+		self._capture = []
+
+	def end_capture(self) -> list:
+		"""
+		Stop collecting commands.
+
+		@returns {list} (payload, execute_at) tuples in send order
+		"""
+		captured = self._capture or []
+		self._capture = None
+		return captured
+
+	async def upload_timeline(self, entries: list) -> bool:
+		"""
+		Upload a cue timeline to the gateway, chunk by chunk with acks.
+		Playback must be stopped, the gateway rejects chunks otherwise.
+
+		@param {list} entries - (offset_ms, 16-byte payload) tuples sorted by offset
+		@returns {bool} True if the gateway stored all entries
+		"""
+		if not self.has_timeline or not entries or len(entries) > TIMELINE_MAX_ENTRIES:
+			return False
+
+		start = 0
+		attempts = 0
+		while start < len(entries):
+			chunk = entries[start:start + TIMELINE_CHUNK_ENTRIES]
+			body = bytearray([LINK_PACKET_TIMELINE])
+			body.extend(start.to_bytes(2, "big"))
+			body.append(len(chunk))
+			for offset_ms, payload in chunk:
+				body.extend(int(offset_ms).to_bytes(4, "big"))
+				body.extend(payload)
+
+			self._timeline_ack = asyncio.get_running_loop().create_future()
+			if not self.send_frame(self._encode_link_body(body)):
+				return False
+
+			try:
+				status, count = await asyncio.wait_for(self._timeline_ack, TIMELINE_ACK_TIMEOUT_S)
+			except asyncio.TimeoutError:
+				attempts += 1
+				if attempts >= TIMELINE_ATTEMPTS:
+					print(f"Timeline upload: no ack at entry {start}")
+					return False
+				continue
+			finally:
+				self._timeline_ack = None
+
+			if status != TIMELINE_ACK_OK:
+				print(f"Timeline upload rejected at entry {count}")
+				return False
+
+			attempts = 0
+			start = count
+
+		return True
+
+	def send_timeline_transport(self, action: int, a: int = 0, b: int = 0) -> bool:
+		"""
+		Send a transport command to the gateway timeline player.
+
+		@param {int} action - TIMELINE_PLAY, TIMELINE_STOP, TIMELINE_SEEK or TIMELINE_TEMPO
+		@param {int} a - Position in ms, or tempo in permille
+		@param {int} b - Network time in ms (0 = as soon as possible)
+		@returns {bool} True if sent successfully
+		"""
+		if not self._fast_link:
+			return False
+
+		body = bytearray([LINK_PACKET_TRANSPORT, action])
+		body.extend((a & 0xFFFFFFFF).to_bytes(4, "big"))
+		body.extend((b & 0xFFFFFFFF).to_bytes(4, "big"))
+		return self.send_frame(self._encode_link_body(body))
+
+	def _send_scene_frame(self, frame: bytearray) -> bool:
+		"""
+		Send a scene frame, the gateway broadcasts it unchanged.
+		Commands still waiting for the link go out first to keep the order.
+
+		@param {bytearray} frame - Scene store or trigger frame
+		@returns {bool} True if sent successfully
+		"""
+		if self._link_entries:
+			self._flush_link()
+		return self.send_frame(self._encode_link_body(bytearray([LINK_PACKET_SCENES]) + frame))
+
+	def _scene_header(self, marker: int, count: int, table_id: int) -> bytearray:
+		frame = bytearray([marker, count, make_flags_byte(DEFAULT_TTL, 0)])
+		frame.extend(self._next_seq().to_bytes(2, "big"))
+		frame.extend((table_id & 0xFFFF).to_bytes(2, "big"))
+		return frame
+
+	async def upload_scenes(self, table_id: int, scenes: list) -> bool:
+		"""
+		Upload a scene table to all Nanos, e.g. one table per song at soundcheck.
+		A new table id replaces the stored table. Every Nano keeps the scenes
+		whose groups match its own, so a scene id can hold one look per group.
+
+		@param {int} table_id - Table id (1-65535)
+		@param {list} scenes - (scene id, 16-byte payload) tuples
+		@returns {bool} True if all frames were sent
+		"""
+		if not self._fast_link or not scenes or not 0 < table_id <= 0xFFFF:
+			return False
+
+		frames = []
+		for start in range(0, len(scenes), SCENE_STORE_MAX_ENTRIES):
+			chunk = scenes[start:start + SCENE_STORE_MAX_ENTRIES]
+			frame = self._scene_header(SCENE_STORE_MARKER, len(chunk), table_id)
+			for scene_id, payload in chunk:
+				frame.append(scene_id & 0xFF)
+				frame.extend(payload)
+			frames.append(frame)
+
+		for _ in range(SCENE_UPLOAD_PASSES):
+			for frame in frames:
+				if not self._send_scene_frame(frame):
+					return False
+				await asyncio.sleep(SCENE_FRAME_INTERVAL_S)
+
+		return True
+
+	def trigger_scenes(self, table_id: int, pairs: list, execute_at: Optional[int] = None) -> bool:
+		"""
+		Fire stored scenes on several groups with one frame.
+		Each Nano runs the scene of the first pair that matches its groups.
+
+		@param {int} table_id - Table the scenes were uploaded with
+		@param {list} pairs - (groups, scene id) or (groups, scene id, intensity) tuples
+		@param {int} execute_at - Network time in ms, None = now
+		@returns {bool} True if sent successfully
+		"""
+		if not self._fast_link or not pairs or len(pairs) > SCENE_TRIGGER_MAX_PAIRS:
+			return False
+
+		frame = self._scene_header(SCENE_TRIGGER_MARKER, len(pairs), table_id)
+		frame.extend(((execute_at or 0) & 0xFFFFFFFF).to_bytes(4, "big"))
+		for pair in pairs:
+			intensity = pair[2] if len(pair) > 2 else SCENE_KEEP_INTENSITY
+			frame.extend((pair[0] & 0xFFFF).to_bytes(2, "big"))
+			frame.append(pair[1] & 0xFF)
+			frame.append(intensity & 0xFF)
+
+		return self._send_scene_frame(frame)
+
+	def _schedule_retransmits(self, payload: bytes, execute_at: int):
+		"""
+		Send a timed frame again a few times while it is still ahead.
+		Nanos drop the copies by SEQ, so this only covers lost frames.
+
+		@param {bytes} payload - 16-byte payload
+		@param {int} execute_at - Network time in ms
+		"""
+		try:
+			loop = asyncio.get_running_loop()
+		except RuntimeError:
+			return
+
+		lead_s = ((execute_at - self.network_time_ms()) & 0xFFFFFFFF) / 1000.0
+		for i in range(1, TIMED_RETRANSMITS + 1):
+			delay = i * TIMED_RETRANSMIT_INTERVAL_S
+			if delay >= lead_s:
+				break
+			loop.call_later(delay, self._send_entry, payload, execute_at)
+
 	def _cleanup_connection(self):
 		"""Clean up serial connection after error."""
 		if self._serial:
@@ -425,6 +1218,9 @@ class SerialGateway:
 				pass
 		self._serial = None
 		self._connected = False
+		self._fast_link = False
+		self._link_entries.clear()
+		self._gateway_log_level = None
 
 	def send_frame(self, frame: bytes) -> bool:
 		"""
@@ -468,7 +1264,10 @@ class SerialGateway:
 		b: int = 0,
 		speed: int = 0,
 		intensity: int = 255,
-		use_new_seq: bool = True
+		use_new_seq: bool = True,
+		execute_at: Optional[int] = None,
+		segment: int = SEGMENT_ALL,
+		layer: int = 0
 	) -> bool:
 		"""
 		Build and send a command to the Gateway.
@@ -476,7 +1275,7 @@ class SerialGateway:
 		@param {int} effect - Effect/command ID
 		@param {int} groups - Target groups bitmask
 		@param {int} flags - Command flags
-		@param {int} duration - Effect duration in ms
+		@param {int} duration - Crossfade from the previous effect in ms (0 = switch at once)
 		@param {int} length - Effect parameter
 		@param {int} rainbow - Rainbow mode
 		@param {int} r - Red value
@@ -485,10 +1284,16 @@ class SerialGateway:
 		@param {int} speed - Animation speed in ms
 		@param {int} intensity - Brightness
 		@param {bool} use_new_seq - Whether to increment sequence counter
+		@param {int} execute_at - Network time in ms to execute at (sent as timed frame)
+		@param {int} segment - Strip segment (1-8), SEGMENT_ALL for all segments
+		@param {int} layer - Effect layer (0 = base, up to LAYER_MAX - 1)
 		@returns {bool} True if sent successfully
 		"""
 		seq = self._next_seq() if use_new_seq else self._seq_counter
 
+		if execute_at is not None:
+			flags |= FLAG_SYNC
+
 		payload = self.build_payload(
 			seq=seq,
 			flags=flags,
@@ -501,18 +1306,69 @@ class SerialGateway:
 			g=g,
 			b=b,
 			speed=speed,
-			intensity=intensity
+			intensity=intensity,
+			segment=segment,
+			layer=layer
 		)
 
-		frame = self.build_frame(payload)
-		success = self.send_frame(frame)
+		success = self._send_entry(payload, execute_at)
 
-		if success and settings.DEBUG:
-			hex_frame = " ".join(f"{b:02X}" for b in frame)
-			print(f"TX: {hex_frame}")
+		if success and execute_at is not None and self._capture is None:
+			self._schedule_retransmits(payload, execute_at)
 
 		return success
 
+	def send_segment_config(self, groups: int, segment: int, start: int = 0, count: int = 0, flags: int = 0) -> bool:
+		"""
+		Define a strip segment on the Nanos of the given groups, they save it in NVS.
+
+		@param {int} groups - Target groups bitmask
+		@param {int} segment - Segment (1-8), SEGMENT_ALL resets to one segment over the whole strip
+		@param {int} start - First LED of the segment
+		@param {int} count - LED count, 0 removes the segment
+		@param {int} flags - SEGMENT_REVERSE and/or SEGMENT_MIRROR
+		@returns {bool} True if sent successfully
+		"""
+		return self.send_command(
+			effect=COMMAND_SET_SEGMENT,
+			groups=groups,
+			duration=start,
+			length=segment,
+			r=flags,
+			speed=count
+		)
+
+	def send_layer_mix(
+		self,
+		groups: int,
+		layer: int,
+		blend: int = BLEND_MAX,
+		opacity: int = 255,
+		segment: int = SEGMENT_ALL,
+		execute_at: Optional[int] = None
+	) -> bool:
+		"""
+		Set how an effect layer is blended onto the layers below it.
+		The layer's effect keeps running, opacity 0 hides it.
+
+		@param {int} groups - Target groups bitmask
+		@param {int} layer - Effect layer (0 = base, up to LAYER_MAX - 1)
+		@param {int} blend - BLEND_ALPHA, BLEND_ADD, BLEND_MAX or BLEND_MULTIPLY
+		@param {int} opacity - 0-255
+		@param {int} segment - Strip segment (1-8), SEGMENT_ALL for all segments
+		@param {int} execute_at - Network time in ms to execute at
+		@returns {bool} True if sent successfully
+		"""
+		return self.send_command(
+			effect=COMMAND_SET_LAYER,
+			groups=groups,
+			r=blend,
+			intensity=opacity,
+			segment=segment,
+			layer=layer,
+			execute_at=execute_at
+		)
+
 	def send_heartbeat(self) -> bool:
 		"""
 		Send heartbeat command to all nanos.
@@ -534,6 +1390,8 @@ class SerialGateway:
 			interval = settings.HEARTBEAT_INTERVAL_MS / 1000.0
 			while True:
 				try:
+					self.request_fast_link()
+					self.sync_gateway_log_level()
 					self.send_heartbeat()
 					await asyncio.sleep(interval)
 				except asyncio.CancelledError:
@@ -1,6 +1,7 @@
 import asyncio
 import logging
 import sys
+import time
 
 from dataclasses import dataclass
 from typing import Dict, List, Optional
@@ -8,12 +9,16 @@ from datetime import datetime
 
 # Externe Services (als Platzhalter importiert):
 from ..nano_network.nano_manager import NanoManager
+from ..nano_network.serial_gateway import TIMELINE_PLAY, TIMELINE_STOP
 from ..websocket.websocket_manager import websocket_manager
 from ..effects.effect_processor import effect_processor, EffectSettings
 # from ..effects.coordinator_instance import coordinator
 from .tsn_parser import TSNParser
 
 PPQ = 96  # Ticks per Quarter Note (fix in TSN)
+CUE_LEAD_S = 0.15  # Cues werden so viel frueher als Timed Frame gesendet (nur mit Netzwerk-Zeit)
+TIMELINE_START_DELAY_S = 0.2  # Vorlauf fuer PLAY, damit das Gateway die ersten Cues rechtzeitig sendet
+TIMELINE_POSITION_INTERVAL_S = 0.05
 
 # =============================================================================
 # MIDI Note to Unified Group Mapping (see PROTOCOL.md)
@@ -105,6 +110,11 @@ class SongPlayer:
 
         self._is_holding = False
 
+        # Timeline im Gateway: (tick, ms, bpm) je Tempo-Abschnitt
+        self._tempo_map: List[tuple] = []
+        self._rendering = False
+        self._timeline_active = False
+
     async def load_song(self, tsn_content: str) -> bool:
         """
         Lädt und parst einen TSN-Song. Baut daraus eine Timeline (Liste) 
@@ -180,6 +190,8 @@ class SongPlayer:
                 else:
                     self._max_tick = 0
 
+                self._build_tempo_map()
+
                 # (7) Log tempo information
                 initial_bpm = self.get_current_tempo(0)
                 secs_per_tick = self.get_seconds_per_tick(0)
@@ -259,6 +271,39 @@ class SongPlayer:
         tempo = self.get_current_tempo(tick)
         return 60.0 / (tempo * PPQ)
 
+    def _build_tempo_map(self):
+        """
+        Baut die Tempo-Abschnitte fuer die Umrechnung Tick <-> ms.
+        """
+        tempo = self.get_current_tempo(0)
+        self._tempo_map = [(0, 0.0, tempo)]
+        changes = self.current_song.get('tempoChanges', []) if self.current_song else []
+
+        for change in sorted(changes, key=lambda x: x['tick']):
+            if change['tick'] <= 0 or change['tempo'] <= 0:
+                continue
+            start_tick, start_ms, bpm = self._tempo_map[-1]
+            ms = start_ms + (change['tick'] - start_tick) * 60000.0 / (bpm * PPQ)
+            self._tempo_map.append((change['tick'], ms, change['tempo']))
+
+    def _tick_to_ms(self, tick: int) -> float:
+        """
+        Zeit eines Ticks ab Song-Anfang in ms, inkl. Tempo-Wechseln.
+        """
+        for start_tick, start_ms, bpm in reversed(self._tempo_map):
+            if tick >= start_tick:
+                return start_ms + (tick - start_tick) * 60000.0 / (bpm * PPQ)
+        return 0.0
+
+    def _ms_to_tick(self, ms: float) -> int:
+        """
+        Tick zu einer Zeit ab Song-Anfang in ms.
+        """
+        for start_tick, start_ms, bpm in reversed(self._tempo_map):
+            if ms >= start_ms:
+                return start_tick + int((ms - start_ms) * bpm * PPQ / 60000.0)
+        return 0
+
     async def play(self, command_manager=None, start_tick: int = None) -> bool:
         """
         Startet die Wiedergabe als asynchronen Task.
@@ -284,8 +329,11 @@ class SongPlayer:
             self.is_playing = True
             self.current_tick = start_tick
 
-            # Haupt-Schleife als Task starten:
-            self._playback_task = asyncio.create_task(self._playback_loop(command_manager))
+            # Haupt-Schleife als Task starten, mit Fast Link spielt das Gateway die Cues
+            if self.nano_manager.gateway.has_timeline and self._tempo_map:
+                self._playback_task = asyncio.create_task(self._timeline_playback_loop(command_manager))
+            else:
+                self._playback_task = asyncio.create_task(self._playback_loop(command_manager))
 
             # Broadcast Task starten (z.B. jede Sekunde)
             self._broadcast_task = asyncio.create_task(self._broadcast_position_loop())
@@ -320,12 +368,7 @@ class SongPlayer:
                     start_time = current_time
                     last_tick_time = current_time
                 
-                # (2) Events verarbeiten
-                if self.current_tick in self.events_by_tick:
-                    events = self.events_by_tick[self.current_tick]
-                    asyncio.create_task(self._process_tick_events(events, command_manager))
-                
-                # (3) Check auf Tempo-Änderung
+                # (2) Check auf Tempo-Änderung
                 new_tempo = self.get_current_tempo(self.current_tick)
                 if new_tempo != current_tempo:
                     logger.info(f"[Tempo Change] at tick {self.current_tick}: {current_tempo} -> {new_tempo} BPM")
@@ -333,14 +376,25 @@ class SongPlayer:
                     elapsed_ticks = 0
                     current_tempo = new_tempo
                 
-                # (4) Berechne Zeit bis zum nächsten Tick
+                # (3) Berechne Zeit bis zum nächsten Tick
                 sec_per_tick = 60.0 / (current_tempo * PPQ)
                 target_time = start_time + (elapsed_ticks * sec_per_tick)
                 
-                # Warte bis zum nächsten Tick-Zeitpunkt
-                sleep_time = target_time - current_time
+                # Mit Netzwerk-Zeit um CUE_LEAD_S zu früh senden, die Nanos
+                # führen den Cue dann genau zum Tick-Zeitpunkt aus
+                gateway = self.nano_manager.gateway
+                lead = CUE_LEAD_S if gateway.has_network_time else 0.0
+
+                # Warte bis zum Sende-Zeitpunkt
+                sleep_time = target_time - lead - current_time
                 if sleep_time > 0:
                     await asyncio.sleep(sleep_time)
+
+                # (4) Events verarbeiten
+                if self.current_tick in self.events_by_tick:
+                    events = self.events_by_tick[self.current_tick]
+                    execute_at = gateway.network_time_ms(target_time) if lead > 0 else None
+                    asyncio.create_task(self._process_tick_events(events, command_manager, execute_at))
                 
                 # Debug output
                 if self.current_tick % PPQ == 0:
@@ -368,6 +422,106 @@ class SongPlayer:
             self.is_playing = False
             await self._on_playback_end()
 
+    async def _upload_timeline(self, command_manager) -> bool:
+        """
+        Rendert den ganzen Song als Cue-Timeline und laedt sie ins Gateway.
+        Die Befehle werden im Gateway abgefangen statt gesendet, execute_at ist
+        dabei der Offset in ms ab Song-Anfang.
+        """
+        gateway = self.nano_manager.gateway
+        gateway.send_timeline_transport(TIMELINE_STOP)
+
+        saved_tick = self.current_tick
+        self.channel_0_active = False
+        self._rendering = True
+        gateway.begin_capture()
+        try:
+            for tick in sorted(self.events_by_tick):
+                self.current_tick = tick
+                await self._process_tick_events(self.events_by_tick[tick], command_manager, int(self._tick_to_ms(tick)))
+        finally:
+            captured = gateway.end_capture()
+            self._rendering = False
+            self.current_tick = saved_tick
+            self.channel_0_active = False
+
+        entries = [(execute_at, payload) for payload, execute_at in captured if execute_at is not None]
+        logger.info(f"[timeline] {len(entries)} Cues, lade ins Gateway")
+        started = time.monotonic()
+
+        if not await gateway.upload_timeline(entries):
+            return False
+
+        logger.info(f"[timeline] Upload fertig in {time.monotonic() - started:.2f} s")
+        return True
+
+    def _start_timeline(self, position_ms: float) -> float:
+        """
+        Startet die Timeline im Gateway an position_ms, kurz in der Zukunft.
+
+        @returns {float} time.monotonic() des Starts
+        """
+        gateway = self.nano_manager.gateway
+        start_at = time.monotonic() + TIMELINE_START_DELAY_S
+        gateway.send_timeline_transport(TIMELINE_PLAY, int(position_ms), gateway.network_time_ms(start_at))
+        return start_at
+
+    async def _timeline_playback_loop(self, command_manager):
+        """
+        Playback ueber die Timeline im Gateway. Der Hub sendet nur Transport-
+        Befehle und rechnet die Position fuer die Anzeige mit. Schlaegt der
+        Upload fehl, wird live abgespielt.
+        """
+        gateway = self.nano_manager.gateway
+        try:
+            if not await self._upload_timeline(command_manager):
+                logger.info("[timeline] Upload fehlgeschlagen, spiele live ab")
+                await self._playback_loop(command_manager)
+                return
+
+            self._timeline_active = True
+            end_ms = self._tick_to_ms(self._max_tick)
+            position_ms = self._tick_to_ms(self.current_tick)
+            start_time = self._start_timeline(position_ms)
+            held = False
+
+            while self.is_playing:
+                if self._jump_requested:
+                    self._jump_requested = False
+                    position_ms = self._tick_to_ms(self._jump_target)
+                    start_time = self._start_timeline(position_ms)
+                    held = False
+                    logger.info(f"[timeline] Jump to tick {self._jump_target} ausgeführt.")
+                elif self._is_holding:
+                    if not held:
+                        gateway.send_timeline_transport(TIMELINE_STOP)
+                        position_ms += max(0.0, time.monotonic() - start_time) * 1000
+                        held = True
+                    await asyncio.sleep(0.1)
+                    continue
+
+                current_ms = position_ms + max(0.0, time.monotonic() - start_time) * 1000
+                self.current_tick = self._ms_to_tick(current_ms)
+                if current_ms > end_ms:
+                    break
+
+                await asyncio.sleep(TIMELINE_POSITION_INTERVAL_S)
+
+            gateway.send_timeline_transport(TIMELINE_STOP)
+            self._timeline_active = False
+            self.is_playing = False
+            logger.info("[timeline] Song zu Ende oder abgebrochen.")
+            await self._on_playback_end()
+
+        except asyncio.CancelledError:
+            logger.info("[timeline] Cancelled.")
+        except Exception as e:
+            logger.error(f"[timeline] Fehler: {e}")
+            gateway.send_timeline_transport(TIMELINE_STOP)
+            self._timeline_active = False
+            self.is_playing = False
+            await self._on_playback_end()
+
     async def _broadcast_position_loop(self):
         """
         Sendet periodisch (z.B. jede Sekunde) den aktuellen Tick an alle WebSockets.
@@ -391,11 +545,13 @@ class SongPlayer:
         except Exception as e:
             logger.error(f"[broadcast_position_loop] Fehler: {e}")
 
-    async def _process_tick_events(self, events: List[MidiEvent], command_manager):
+    async def _process_tick_events(self, events: List[MidiEvent], command_manager, execute_at: Optional[int] = None):
         """
         Verarbeitet die MIDI-Events, die an diesem Tick anliegen. 
         Hier nicht blockierend programmieren, sondern z.B. nur 
         Kommandos versenden und das meiste asynchron erledigen.
+
+        execute_at: Netzwerk-Zeit (ms), zu der die Nanos die Cues ausführen (None = sofort)
         """
 
         note_on_events = [e for e in events if e.type == 144 and e.velocity > 0]
@@ -406,10 +562,10 @@ class SongPlayer:
         
         # 1) Note-Off-Events behandeln
         #    Beispiel: Register (1–15) ausschalten, etc.
-        await self._handle_note_off_events(note_off_events)
+        await self._handle_note_off_events(note_off_events, execute_at)
 
         # 2) Note-On-Events behandeln
-        await self._handle_note_on_events(note_on_events)
+        await self._handle_note_on_events(note_on_events, execute_at)
 
     async def stop(self):
         """
@@ -421,6 +577,10 @@ class SongPlayer:
             
             logger.info("[stop] Stoppe Wiedergabe.")
             self.is_playing = False
+
+            if self._timeline_active:
+                self.nano_manager.gateway.send_timeline_transport(TIMELINE_STOP)
+                self._timeline_active = False
             
             # Tasks abbrechen
             if self._playback_task:
@@ -528,7 +688,7 @@ class SongPlayer:
         self._jump_requested = True
         self._is_holding = False
 
-    async def _handle_note_off_events(self, note_off_events: List[MidiEvent]):
+    async def _handle_note_off_events(self, note_off_events: List[MidiEvent], execute_at: Optional[int] = None):
         # Beispiel: Register 1-15 "ausschalten"
         for event in note_off_events:
             # Optional: channel_0_active abfragen, wenn du Channel 0 als "Master" nutzen willst
@@ -558,7 +718,9 @@ class SongPlayer:
                     0, 0,  # Speed
                     0,    # Length
                 ]
-                await self.nano_manager.broadcast_command(command, target_register=target_reg)
+                await self.nano_manager.broadcast_command(command, target_register=target_reg, execute_at=execute_at)
+                if self._rendering:
+                    continue
                 await asyncio.create_task(websocket_manager.broadcast_message({
                     "type": "midi_event",
                     "tick": self.current_tick,
@@ -574,7 +736,7 @@ class SongPlayer:
                     }
                 }))
 
-    async def _handle_note_on_events(self, note_on_events: List[MidiEvent]):
+    async def _handle_note_on_events(self, note_on_events: List[MidiEvent], execute_at: Optional[int] = None):
         if not note_on_events:
             return
         
@@ -645,7 +807,8 @@ class SongPlayer:
                     rainbow=settings.rainbow,
                     speed=settings.speed,
                     length=settings.length,
-                    intensity=settings.intensity
+                    intensity=settings.intensity,
+                    execute_at=execute_at
                 )
 
                 logger.info(f"[Tick {self.current_tick}] -> Effekt {event.note} für Register {registers}")
@@ -654,6 +817,8 @@ class SongPlayer:
                 await effect_processor.process_effect(event.note, effect_settings)
 
                 # Broadcast an WebSocket (einmal für alle)
+                if self._rendering:
+                    continue
                 await websocket_manager.broadcast_message({
                     "type": "midi_event",
                     "settings": {
@@ -0,0 +1,260 @@
+"""
+Generates the effect tables of all projects from effects.json.
+
+Run from anywhere after changing effects.json:
+
+    python3 nano/generate_effects.py
+
+Writes the effect IDs for the Nano, crowdcontrol and applausmaschine, the
+descriptor list of the Nano's render table, the hub's effect_types.py, the
+simulation's effects.js and the effect table in PROTOCOL.md.
+"""
+
+import json
+import os
+import re
+
+NANO_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(NANO_DIR)
+
+SOURCE = os.path.join(NANO_DIR, "effects.json")
+ID_HEADERS = [
+    os.path.join(REPO_DIR, "nano", "include", "effect_ids.h"),
+    os.path.join(REPO_DIR, "crowdcontrol", "include", "effect_ids.h"),
+    os.path.join(REPO_DIR, "applausmaschine", "include", "effect_ids.h"),
+]
+TABLE_HEADER = os.path.join(NANO_DIR, "include", "effect_table.h")
+HUB_TYPES = os.path.join(REPO_DIR, "hub", "src", "effects", "effect_types.py")
+SIMULATION_JS = os.path.join(REPO_DIR, "simulation", "static", "effects.js")
+PROTOCOL = os.path.join(REPO_DIR, "PROTOCOL.md")
+
+# Effect commands use 0x20-0x3F (IsEffectCommand in constants.h)
+EFFECT_ID_FIRST = 0x20
+EFFECT_SLOTS = 32
+
+REDRAW = {"static": "kStatic", "step": "kStep", "smooth": "kSmooth"}
+
+NOTICE = "Generated by nano/generate_effects.py from nano/effects.json - do not edit"
+
+PROTOCOL_BEGIN = "<!-- effects:begin -->"
+PROTOCOL_END = "<!-- effects:end -->"
+
+
+def load_effects():
+    with open(SOURCE, "r", encoding="utf-8") as f:
+        effects = json.load(f)["effects"]
+
+    seen = set()
+    for effect in effects:
+        effect["id"] = int(effect["id"], 16)
+        if not EFFECT_ID_FIRST <= effect["id"] < EFFECT_ID_FIRST + EFFECT_SLOTS:
+            raise ValueError(f"{effect['key']}: ID 0x{effect['id']:02X} outside of 0x20-0x3F")
+        if effect["id"] in seen:
+            raise ValueError(f"{effect['key']}: ID 0x{effect['id']:02X} used twice")
+        if effect["redraw"] not in REDRAW:
+            raise ValueError(f"{effect['key']}: unknown redraw '{effect['redraw']}'")
+        seen.add(effect["id"])
+
+    return sorted(effects, key=lambda e: e["id"])
+
+
+def upper_snake(key):
+    return re.sub(r"(?<!^)(?=[A-Z])", "_", key).upper()
+
+
+def write(path, text):
+    with open(path, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+    print(f"Wrote {os.path.relpath(path, REPO_DIR)}")
+
+
+def id_header(effects):
+    width = max(len(e["key"]) for e in effects) + len("kEffect")
+    lines = [
+        f"// {NOTICE}",
+        "#pragma once",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "namespace Cmd",
+        "{",
+    ]
+    for e in effects:
+        name = f"kEffect{e['key']}"
+        lines.append(f"   constexpr uint8_t {name:<{width}} = 0x{e['id']:02X};")
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+def table_header(effects):
+    index = [0xFF] * EFFECT_SLOTS
+    for i, e in enumerate(effects):
+        index[e["id"] - EFFECT_ID_FIRST] = i
+
+    rows = []
+    for e in effects:
+        state = f"sizeof({e['state']})" if e.get("state") else "0"
+        rows.append(
+            f"   EFFECT({e['key']}, 0x{e['id']:02X}, \"{e['name']}\", {e['speed']}, {e['length']}, "
+            f"{REDRAW[e['redraw']]}, {state})"
+        )
+
+    index_rows = []
+    for start in range(0, EFFECT_SLOTS, 8):
+        index_rows.append("   " + ", ".join(f"0x{v:02X}" for v in index[start:start + 8]) + ",")
+
+    lines = [
+        f"// {NOTICE}",
+        "#pragma once",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "/*",
+        " * EFFECT(key, id, name, default speed, default length, redraw, state size)",
+        " * Expanded by led_handler.cpp into the descriptor table, sorted by ID.",
+        " */",
+        "#define EFFECT_TABLE(EFFECT) \\",
+        " \\\n".join(rows),
+        "",
+        f"constexpr size_t kEffectCount = {len(effects)};",
+        f"constexpr uint8_t kEffectIdFirst = 0x{EFFECT_ID_FIRST:02X};",
+        f"constexpr size_t kEffectSlots = {EFFECT_SLOTS};",
+        "",
+        "// Table index per effect ID from kEffectIdFirst, 0xFF = no such effect",
+        "constexpr uint8_t kEffectIndex[kEffectSlots] = {",
+        *index_rows,
+        "};",
+    ]
+    return "\n".join(lines) + "\n"
+
+
+HUB_TEMPLATE = '''# {notice}
+from enum import Enum
+
+
+class EffectType(Enum):
+	"""
+	Enumeration of all available LED effects.
+	IDs come from nano/effects.json, like the Nano firmware and PROTOCOL.md
+	"""
+{members}
+
+	@classmethod
+	def from_id(cls, effect_id: int) -> 'EffectType':
+		"""
+		Get EffectType from effect ID.
+
+		@param {{int}} effect_id - Effect ID
+		@returns {{EffectType}} Effect type
+		@raises {{ValueError}} If effect ID is unknown
+		"""
+		for effect in cls:
+			if effect.value == effect_id:
+				return effect
+		raise ValueError(f"Unknown effect ID: 0x{{effect_id:02X}}")
+
+	@classmethod
+	def from_note(cls, note: int) -> 'EffectType':
+		"""
+		Convert MIDI note to effect type.
+		Maps note ranges to specific effects.
+
+		@param {{int}} note - MIDI note number
+		@returns {{EffectType}} Effect type for the note
+		"""
+		if 30 <= note <= 52 or 100 <= note <= 110:
+			return cls.SOLID
+		else:
+			raise ValueError(f"Unknown effect note: {{note}}")
+
+	@classmethod
+	def is_valid_effect_id(cls, effect_id: int) -> bool:
+		"""
+		Check if an effect ID is valid.
+
+		@param {{int}} effect_id - Effect ID to check
+		@returns {{bool}} True if the Nano knows the effect
+		"""
+		return effect_id in EFFECT_INFO
+
+
+# Effect ID constants for direct import
+{constants}
+
+# Name, default speed (ms per step) and default length of every effect
+EFFECT_INFO = {{
+{info}
+}}
+'''
+
+
+def hub_types(effects):
+    members = "\n".join(f"\t{upper_snake(e['key'])} = 0x{e['id']:02X}" for e in effects)
+    constants = "\n".join(f"EFFECT_{upper_snake(e['key'])} = 0x{e['id']:02X}" for e in effects)
+    info = "\n".join(
+        f"\tEFFECT_{upper_snake(e['key'])}: {{\"name\": \"{e['name']}\", \"speed\": {e['speed']}, \"length\": {e['length']}}},"
+        for e in effects
+    )
+    return HUB_TEMPLATE.format(notice=NOTICE, members=members, constants=constants, info=info)
+
+
+def simulation_js(effects):
+    rows = "\n".join(
+        f"   {{ id: 0x{e['id']:02X}, key: '{upper_snake(e['key'])}', name: '{e['name']}', "
+        f"speed: {e['speed']}, length: {e['length']} }},"
+        for e in effects
+    )
+    return (
+        f"// {NOTICE}\n"
+        "export const EFFECTS = [\n"
+        f"{rows}\n"
+        "]\n"
+        "\n"
+        "export const EFFECT_BY_ID = Object.fromEntries(EFFECTS.map(effect => [effect.id, effect]))\n"
+    )
+
+
+def protocol_table(effects):
+    names = [f"kEffect{e['key']}" for e in effects]
+    name_width = max(len("Effect"), *(len(n) for n in names))
+    desc_width = max(len("Beschreibung"), *(len(e["description"]) for e in effects))
+    length_width = len("Length (Standard)")
+
+    def row(a, b, c, d):
+        return f"| {a:<{name_width}} | {b:<4} | {c:<{desc_width}} | {d:<{length_width}} |"
+
+    lines = [
+        PROTOCOL_BEGIN,
+        row("Effect", "ID", "Beschreibung", "Length (Standard)"),
+        f"| {'-' * name_width} | ---- | {'-' * desc_width} | {'-' * length_width} |",
+    ]
+    for name, e in zip(names, effects):
+        lines.append(row(name, f"0x{e['id']:02X}", e["description"], str(e["length"] or "-")))
+    lines.append(PROTOCOL_END)
+    return "\n".join(lines)
+
+
+def update_protocol(effects):
+    with open(PROTOCOL, "r", encoding="utf-8") as f:
+        text = f.read()
+
+    begin = text.find(PROTOCOL_BEGIN)
+    end = text.find(PROTOCOL_END)
+    if begin < 0 or end < begin:
+        raise ValueError("PROTOCOL.md has no effect table markers")
+
+    write(PROTOCOL, text[:begin] + protocol_table(effects) + text[end + len(PROTOCOL_END):])
+
+
+def main():
+    effects = load_effects()
+    for path in ID_HEADERS:
+        write(path, id_header(effects))
+    write(TABLE_HEADER, table_header(effects))
+    write(HUB_TYPES, hub_types(effects))
+    write(SIMULATION_JS, simulation_js(effects))
+    update_protocol(effects)
+
+
+if __name__ == "__main__":
+    main()
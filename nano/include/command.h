@@ -13,19 +13,23 @@ struct Command
   uint16_t duration;
   uint8_t length;
   uint8_t rainbow;
+  uint8_t segment;   // 1-based, kSegmentAll for every segment
+  uint8_t layer;     // 0 = base
   uint8_t r;
   uint8_t g;
   uint8_t b;
   uint16_t speed;
   uint8_t intensity;
+  uint32_t syncTime; // network start time in ms, only set for SYNC frames
 };
 
 /**
- * @brief Parse raw 16-byte frame into Command struct
- * @param buffer Pointer to 16-byte data buffer
+ * @brief Parse raw 16-byte frame (or 20-byte SYNC frame) into Command struct
+ * @param buffer Pointer to data buffer
+ * @param len Frame length, kSyncFrameSize adds the network start time
  * @returns Parsed Command struct with Big-Endian values converted
  */
-Command ParseCommand(const uint8_t *buffer);
+Command ParseCommand(const uint8_t *buffer, size_t len = kFrameSize);
 
 /**
  * @brief Check if command targets this nano based on group membership
@@ -2,6 +2,8 @@
 
 #include <Arduino.h>
 
+#include "effect_ids.h"
+
 constexpr int kOnboardButtonPin = 0;
 constexpr int kOnboardLedPin = 2;
 
@@ -18,20 +20,138 @@ constexpr uint32_t kButtonLongPressMs = 500;
 constexpr uint32_t kPairingTimeoutMs = 30000;
 constexpr uint32_t kPairingRequestIntervalMs = 500;
 
-constexpr size_t kIdempotencyBufferSize = 32;
+// SYNC frames: 16-byte command + network start time (uint32 ms, big-endian).
+// A start time in the future makes it a timed cue, held until it is due.
+constexpr size_t kSyncFrameSize = 20;
+constexpr size_t kCueQueueSize = 8;
+constexpr int32_t kMaxCueLeadMs = 10000;
+
+// Time beacon: [marker][id][ttl][gateway time in us (int64, big-endian)]
+constexpr size_t kTimeBeaconSize = 11;
+constexpr uint8_t kTimeBeaconMarker = 0xB0;
+constexpr size_t kTimeSampleWindow = 8;         // beacons, best (least delayed) one wins
+constexpr int64_t kTimeStepThresholdUs = 20000;  // larger errors are stepped, not slewed
+constexpr int64_t kTimeMaxSlewUs = 500;          // max correction per beacon
+constexpr size_t kTimeOutlierRun = 3;            // low beacons in a row before the clock goes back
+constexpr uint32_t kTimeSyncTimeout = 30000;
+
+// Echo reply to a kDebugEcho probe addressed to this Nano by MAC ([10-15]):
+// [0xF0][probe id u16][synced][rx network time us u32][processing us u32]
+constexpr size_t kEchoReplySize = 12;
+
+// Stress test (kDebugStress), the action is in [8]. DATA frames from the
+// gateway are numbered by their SEQ. A REPORT is answered after a random delay
+// with [0xF2][6 x uint32 StressStats, big-endian].
+namespace StressAction
+{
+   constexpr uint8_t kData = 0x00;
+   constexpr uint8_t kStart = 0x01;
+   constexpr uint8_t kStop = 0x02;
+   constexpr uint8_t kReport = 0x03;
+}
+constexpr size_t kStressReportSize = 25;
+constexpr uint32_t kStressReportJitterMs = 500;
+
+// Status beacon to the gateway, once per interval in a slot of the network
+// time period derived from register and MAC (see telemetry.h)
+constexpr uint32_t kTelemetryIntervalMs = 10000;
+constexpr uint32_t kTelemetrySlots = 64;  // 156 ms per slot, room for 60 Nanos
+constexpr size_t kTelemetryBeaconSize = 17; // never 16, neighbours would parse it as a command
+constexpr int kBatteryAdcPin = -1;        // no battery divider fitted, reported as 0 mV
+constexpr uint32_t kBatteryDividerRatio = 2;
+
+// Batch frame: [marker][count][start time (uint32 ms)][count x 16-byte command]
+// The start time is shared by all SYNC entries of the batch.
+constexpr uint8_t kBatchMarker = 0xB5;
+constexpr size_t kBatchHeaderSize = 6;
+constexpr size_t kBatchMaxCommands = 15;
+constexpr size_t kBatchFrameMaxSize = kBatchHeaderSize + kBatchMaxCommands * kFrameSize;
+
+// Scene memory (see scene_store.h), flags at [2] like commands so dedup and
+// relaying work the same. Neither frame can be 16 or 20 bytes long.
+// Store:   [0xB7][count][flags][seq u16][table u16][count x (scene id + 16-byte command)]
+// Trigger: [0xB6][count][flags][seq u16][table u16][start time u32 ms, 0 = now]
+//          [count x (groups u16 + scene id + intensity)], the first pair for this Nano wins
+constexpr uint8_t kSceneStoreMarker = 0xB7;
+constexpr uint8_t kSceneTriggerMarker = 0xB6;
+constexpr size_t kSceneStoreHeaderSize = 7;
+constexpr size_t kSceneStoreEntrySize = 1 + kFrameSize;
+constexpr size_t kSceneStoreMaxEntries = 14;
+constexpr size_t kSceneTriggerHeaderSize = 11;
+constexpr size_t kSceneTriggerPairSize = 4;
+constexpr size_t kSceneTriggerMaxPairs = 32;
+constexpr size_t kSceneCount = 256;
+constexpr uint8_t kSceneKeepIntensity = 0xFF;
+constexpr uint32_t kScenePersistDelayMs = 3000; // NVS write once the upload went quiet
+
+// Strip segments, each runs its own effect. Effect commands pick one by the
+// upper nibble of [9] (1-based, 0 = all segments), rainbow keeps bits 1-0, layer in bits 3-2.
+// kSetSegment: [8] segment (0 = back to one segment over the whole strip),
+// [6-7] first LED, [13-14] LED count (0 = remove), [10] SegmentFlag bits
+constexpr size_t kMaxSegments = 8;
+constexpr uint8_t kSegmentAll = 0;
+constexpr uint8_t kSegmentShift = 4;
+
+// Every segment stacks up to kMaxLayers effects, picked by bits 3-2 of [9].
+// Layer 0 is the base, higher layers are blended on top of it.
+// kSetLayer: segment and layer in [9] like effects, [10] BlendMode, [15] opacity
+constexpr size_t kMaxLayers = 4;
+constexpr uint8_t kLayerShift = 2;
+constexpr uint8_t kLayerMask = 0x03;
+constexpr uint8_t kRainbowMask = 0x03;
+
+namespace BlendMode
+{
+   constexpr uint8_t kAlpha = 0;    // crossfade by opacity
+   constexpr uint8_t kAdd = 1;      // saturating add
+   constexpr uint8_t kMax = 2;      // brighter channel wins, default for layers above the base
+   constexpr uint8_t kMultiply = 3; // darkens the layers below
+}
+
+namespace SegmentFlag
+{
+   constexpr uint8_t kReverse = 0x01;
+   constexpr uint8_t kMirror = 0x02; // effect drawn on the first half, mirrored onto the second
+}
+
+// 802.11 frame control of an action frame, ESP-NOW frames are vendor-specific actions
+constexpr uint8_t kActionFrameControl = 0xD0;
+
+// Receive ring between the WiFi task and the main loop
+constexpr size_t kRxQueueSize = 16;
+constexpr size_t kRxFrameMaxSize = kBatchFrameMaxSize;
+
 constexpr uint8_t kMaxMeshTTL = 3;
 constexpr uint8_t kDefaultMeshTTL = 1;
 constexpr uint32_t kRebroadcastJitterMax = 50;
-constexpr uint32_t kRebroadcastMinGap = 100;
 
-// TTL is stored in upper 4 bits of flags byte
-constexpr uint8_t kTTLMask = 0xF0;
+// Counter-based flooding: a queued rebroadcast is dropped once the same
+// frame was overheard this many times from neighbours
+constexpr size_t kRebroadcastQueueSize = 8;
+constexpr uint8_t kRebroadcastSuppressCount = 2;
+
+// Flags byte: source in bits 7-6, TTL in bits 5-4, flags in bits 3-0
+constexpr uint8_t kSourceMask = 0xC0;
+constexpr uint8_t kSourceShift = 6;
+constexpr uint8_t kTTLMask = 0x30;
 constexpr uint8_t kTTLShift = 4;
 constexpr uint8_t kFlagsMask = 0x0F;
 
+inline uint8_t GetSource(uint8_t flagsByte) { return (flagsByte & kSourceMask) >> kSourceShift; }
 inline uint8_t GetTTL(uint8_t flagsByte) { return (flagsByte & kTTLMask) >> kTTLShift; }
 inline uint8_t GetFlags(uint8_t flagsByte) { return flagsByte & kFlagsMask; }
 inline uint8_t MakeFlagsByte(uint8_t ttl, uint8_t flags) { return ((ttl << kTTLShift) & kTTLMask) | (flags & kFlagsMask); }
+inline uint8_t SetTTL(uint8_t flagsByte, uint8_t ttl) { return (flagsByte & ~kTTLMask) | ((ttl << kTTLShift) & kTTLMask); }
+
+// Senders with their own sequence counter, each gets its own dedup window
+namespace Source
+{
+   constexpr uint8_t kHub = 0;
+   constexpr uint8_t kCrowdControl = 1;
+   constexpr uint8_t kApplausmaschine = 2;
+   constexpr uint8_t kGateway = 3; // timeline player
+   constexpr uint8_t kCount = 4;
+}
 
 // CRC-8 lookup table (polynomial 0x07, init 0x00)
 static const uint8_t kCRC8Table[256] PROGMEM = {
@@ -114,6 +234,8 @@ namespace Cmd
    constexpr uint8_t kReboot = 0x07;
    constexpr uint8_t kFactoryReset = 0x0A;
    constexpr uint8_t kSetMeshTTL = 0x0B;
+   constexpr uint8_t kSetSegment = 0x0C;
+   constexpr uint8_t kSetLayer = 0x0D;
 
    constexpr uint8_t kStateOff = 0x10;
    constexpr uint8_t kStateStandby = 0x11;
@@ -121,31 +243,10 @@ namespace Cmd
    constexpr uint8_t kStateEmergency = 0x13;
    constexpr uint8_t kStateBlackout = 0x14;
 
-   constexpr uint8_t kEffectSolid = 0x20;
-   constexpr uint8_t kEffectBlink = 0x21;
-   constexpr uint8_t kEffectRainbow = 0x23;
-   constexpr uint8_t kEffectRainbowCycle = 0x24;
-   constexpr uint8_t kEffectChase = 0x25;
-   constexpr uint8_t kEffectTheaterChase = 0x26;
-   constexpr uint8_t kEffectTwinkle = 0x27;
-   constexpr uint8_t kEffectFire = 0x29;
-   constexpr uint8_t kEffectPulse = 0x2A;
-   constexpr uint8_t kEffectGradient = 0x2C;
-   constexpr uint8_t kEffectWave = 0x2D;
-   constexpr uint8_t kEffectMeteor = 0x2E;
-   constexpr uint8_t kEffectDna = 0x30;
-   constexpr uint8_t kEffectBounce = 0x31;
-   constexpr uint8_t kEffectColorWipe = 0x32;
-   constexpr uint8_t kEffectScanner = 0x33;
-   constexpr uint8_t kEffectConfetti = 0x34;
-   constexpr uint8_t kEffectLightning = 0x35;
-   constexpr uint8_t kEffectPolice = 0x36;
-   constexpr uint8_t kEffectStacking = 0x37;
-   constexpr uint8_t kEffectMarquee = 0x38;
-   constexpr uint8_t kEffectRipple = 0x39;
-   constexpr uint8_t kEffectPlasma = 0x3A;
+   // Effect commands 0x20-0x3F: kEffect* in effect_ids.h
 
    constexpr uint8_t kPairingRequest = 0xA0;
+   constexpr uint8_t kStatusBeacon = 0xA1;
    constexpr uint8_t kPairingAckRecv = 0x81;
    constexpr uint8_t kConfigSetRecv = 0x82;
    constexpr uint8_t kConfigAck = 0x83;
@@ -155,6 +256,20 @@ namespace Cmd
    constexpr uint8_t kDebugStress = 0xF2;
 }
 
+// Internal commands from the state machine to the render task (never sent over the air)
+namespace RenderCmd
+{
+   constexpr uint8_t kReinitialize = 0xC0;
+   constexpr uint8_t kStandby = 0xC1;
+   constexpr uint8_t kUnconfigured = 0xC2;
+   constexpr uint8_t kPairing = 0xC3;
+   constexpr uint8_t kDimWhite = 0xC4;
+   constexpr uint8_t kFeedback = 0xC5;
+   constexpr uint8_t kHeartbeatFlash = 0xC6;
+   constexpr uint8_t kSegments = 0xC7;
+   constexpr uint8_t kLayerMix = 0xC8;
+}
+
 inline bool IsSystemCommand(uint8_t cmd) { return cmd <= 0x0F; }
 inline bool IsStateCommand(uint8_t cmd) { return cmd >= 0x10 && cmd <= 0x1F; }
 inline bool IsEffectCommand(uint8_t cmd) { return cmd >= 0x20 && cmd <= 0x3F; }
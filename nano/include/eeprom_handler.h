@@ -17,6 +17,7 @@ constexpr char kNvsKeyConfigured[] = "configured";
 constexpr char kNvsKeyStandbyR[] = "standby_r";
 constexpr char kNvsKeyStandbyG[] = "standby_g";
 constexpr char kNvsKeyStandbyB[] = "standby_b";
+constexpr char kNvsKeySegments[] = "segments";
 
 struct NanoConfig
 {
@@ -35,7 +36,18 @@ struct NanoConfig
    bool configured;
 };
 
+/**
+ * @brief One strip segment, unused while length is 0
+ */
+struct SegmentConfig
+{
+   uint16_t start;
+   uint16_t length;
+   uint8_t flags; // SegmentFlag bits
+};
+
 extern NanoConfig config;
+extern SegmentConfig segmentTable[kMaxSegments];
 
 /**
  * @brief Initialize EEPROM and load config
@@ -97,3 +109,14 @@ void ClearPairingConfig();
  * @returns Group bitmask (always includes kAll for broadcast support)
  */
 uint16_t RegisterToGroupBitmask(uint8_t deviceRegister);
+
+/**
+ * @brief Load the segment table from NVS, all segments unused if none is stored
+ */
+void LoadSegments();
+
+/**
+ * @brief Save the segment table to NVS
+ * @returns true on success
+ */
+bool SaveSegments();
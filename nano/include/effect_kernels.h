@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "fast_math.h"
+
+/*
+ * Per-pixel math of the sine and trail effects, shared by the Draw*()
+ * functions in led_handler.cpp and the benchmark in test/test_fast_math.
+ * Steps are 8.8 fixed point, levels are 0-255.
+ */
+
+/**
+ * @brief One sine along the strip, a full wave every length pixels,
+ * scrolling by one wave every 20 steps (Wave and DNA)
+ */
+class WaveKernel
+{
+public:
+   WaveKernel(uint32_t stepFixed, uint8_t length)
+       : phase((stepFixed * PhaseIncrement(2000)) >> 8), pixelInc(65536UL / length)
+   {
+   }
+
+   /**
+    * @brief Level of the next pixel
+    */
+   uint8_t Next()
+   {
+      uint8_t level = Sin8Phase(phase);
+      phase += pixelInc;
+      return level;
+   }
+
+private:
+   uint16_t phase;
+   uint16_t pixelInc;
+};
+
+/**
+ * @brief Average of three sines of i/3 + step/7, i/5 - step/11 and
+ * (i + step)/9 radians, as 8.8 angles: 1 radian = 40.74 table steps
+ */
+class PlasmaKernel
+{
+public:
+   explicit PlasmaKernel(uint32_t stepFixed)
+       : phase1((stepFixed * 1490) >> 8), phase2(-((stepFixed * 948) >> 8)), phase3((stepFixed * 1159) >> 8)
+   {
+   }
+
+   /**
+    * @brief Level of the next pixel
+    */
+   uint8_t Next()
+   {
+      uint16_t sum = Sin8Phase(phase1) + Sin8Phase(phase2) + Sin8Phase(phase3);
+      phase1 += 3477;
+      phase2 += 2086;
+      phase3 += 1159;
+      return sum / 3;
+   }
+
+private:
+   uint16_t phase1;
+   uint16_t phase2;
+   uint16_t phase3;
+};
+
+/**
+ * @brief Pixel of trail LED i behind the meteor that starts at pixel j
+ */
+inline uint16_t MeteorPixel(uint32_t step, uint16_t j, uint8_t i, uint16_t pixels)
+{
+   int pos = (int)((step + j) % pixels) - (int)(i % pixels);
+   if (pos < 0)
+      pos += pixels;
+   return pos;
+}
+
+/**
+ * @brief Level of trail LED i, 0 is the head of the meteor
+ */
+inline uint8_t MeteorTrail(uint8_t i) { return FadeCurve(kFadeCurve80, i); }
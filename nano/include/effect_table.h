@@ -0,0 +1,45 @@
+// Generated by nano/generate_effects.py from nano/effects.json - do not edit
+#pragma once
+
+#include <Arduino.h>
+
+/*
+ * EFFECT(key, id, name, default speed, default length, redraw, state size)
+ * Expanded by led_handler.cpp into the descriptor table, sorted by ID.
+ */
+#define EFFECT_TABLE(EFFECT) \
+   EFFECT(Solid, 0x20, "Solid", 50, 0, kStatic, 0) \
+   EFFECT(Blink, 0x21, "Blink", 50, 0, kStep, 0) \
+   EFFECT(Rainbow, 0x23, "Rainbow", 50, 0, kStep, 0) \
+   EFFECT(RainbowCycle, 0x24, "Rainbow Cycle", 50, 0, kStep, 0) \
+   EFFECT(Chase, 0x25, "Chase", 50, 3, kStep, 0) \
+   EFFECT(TheaterChase, 0x26, "Theater Chase", 50, 0, kStep, 0) \
+   EFFECT(Twinkle, 0x27, "Twinkle", 50, 10, kStep, 0) \
+   EFFECT(Fire, 0x29, "Fire", 50, 0, kStep, 0) \
+   EFFECT(Pulse, 0x2A, "Pulse", 50, 40, kSmooth, 0) \
+   EFFECT(Gradient, 0x2C, "Gradient", 50, 0, kStep, 0) \
+   EFFECT(Wave, 0x2D, "Wave", 50, 10, kSmooth, 0) \
+   EFFECT(Meteor, 0x2E, "Meteor", 50, 4, kStep, 0) \
+   EFFECT(Dna, 0x30, "DNA Helix", 50, 10, kSmooth, 0) \
+   EFFECT(Bounce, 0x31, "Bounce", 50, 3, kStep, 0) \
+   EFFECT(ColorWipe, 0x32, "Color Wipe", 50, 0, kStep, 0) \
+   EFFECT(Scanner, 0x33, "Scanner", 50, 5, kStep, 0) \
+   EFFECT(Confetti, 0x34, "Confetti", 50, 0, kStep, 0) \
+   EFFECT(Lightning, 0x35, "Lightning", 50, 8, kStep, 0) \
+   EFFECT(Police, 0x36, "Police", 50, 0, kStep, 0) \
+   EFFECT(Stacking, 0x37, "Stacking", 50, 0, kStep, 0) \
+   EFFECT(Marquee, 0x38, "Marquee", 50, 5, kStep, 0) \
+   EFFECT(Ripple, 0x39, "Ripple", 50, 3, kStep, 0) \
+   EFFECT(Plasma, 0x3A, "Plasma", 50, 0, kSmooth, 0)
+
+constexpr size_t kEffectCount = 23;
+constexpr uint8_t kEffectIdFirst = 0x20;
+constexpr size_t kEffectSlots = 32;
+
+// Table index per effect ID from kEffectIdFirst, 0xFF = no such effect
+constexpr uint8_t kEffectIndex[kEffectSlots] = {
+   0x00, 0x01, 0xFF, 0x02, 0x03, 0x04, 0x05, 0x06,
+   0xFF, 0x07, 0x08, 0xFF, 0x09, 0x0A, 0x0B, 0xFF,
+   0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13,
+   0x14, 0x15, 0x16, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
@@ -4,6 +4,39 @@
 
 #include "command.h"
 
+/**
+ * @brief Receive ring statistics
+ */
+struct RxStats
+{
+   uint32_t queued;    // frames currently waiting
+   uint32_t highWater; // deepest the ring has been since boot
+   uint32_t overflows; // frames dropped because the ring was full
+};
+
+/**
+ * @brief Rebroadcast statistics since boot
+ */
+struct MeshStats
+{
+   uint32_t sent;       // frames rebroadcast
+   uint32_t suppressed; // cancelled because neighbours already relayed them
+   uint32_t dropped;    // not queued because all slots were busy
+};
+
+/**
+ * @brief Stress test counters since the last kDebugStress START
+ */
+struct StressStats
+{
+   uint32_t received;        // unique DATA frames
+   uint32_t duplicates;      // further copies, e.g. from mesh relays
+   uint32_t outOfOrder;      // unique frames older than the newest one seen
+   uint32_t missing;         // SEQs between the first and newest never received
+   uint32_t avgProcessingUs; // receive callback until counted
+   uint32_t maxProcessingUs;
+};
+
 /**
  * @brief Initialize ESP-NOW communication
  * @returns true on success
@@ -26,19 +59,21 @@ bool SendBroadcast(const uint8_t *data, size_t len);
 
 /**
  * @brief Check if a command with given SEQ was already processed
+ * @param source Sender id from the flags byte (see Source)
  * @param seq Sequence number to check
  * @returns true if SEQ is known (duplicate)
  */
-bool IsKnownSeq(uint16_t seq);
+bool IsKnownSeq(uint8_t source, uint16_t seq);
 
 /**
- * @brief Add SEQ to known sequences buffer
+ * @brief Mark SEQ as seen in the sender's dedup window
+ * @param source Sender id from the flags byte (see Source)
  * @param seq Sequence number to add
  */
-void AddKnownSeq(uint16_t seq);
+void AddKnownSeq(uint8_t source, uint16_t seq);
 
 /**
- * @brief Clear all known sequences
+ * @brief Clear the dedup windows of all senders
  */
 void ClearKnownSeqs();
 
@@ -53,6 +88,31 @@ Command *GetPendingCommand();
  */
 void ClearPendingCommand();
 
+/**
+ * @brief Get receive ring statistics
+ */
+RxStats GetRxStats();
+
+/**
+ * @brief Get rebroadcast statistics
+ */
+MeshStats GetMeshStats();
+
+/**
+ * @brief Get stress test counters
+ */
+StressStats GetStressStats();
+
+/**
+ * @brief SEQ of the last new command from the hub
+ */
+uint16_t GetLastHubSeq();
+
+/**
+ * @brief RSSI of the last ESP-NOW frame heard, in dBm (0 before the first one)
+ */
+int8_t GetLastRssi();
+
 /**
  * @brief Get timestamp of last received heartbeat
  * @returns millis() value of last heartbeat
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+
+/*
+ * Integer math for the LED effects. Angles are 8-bit (256 = one full turn),
+ * phases are 8.8 fixed point accumulators (upper byte indexes the tables),
+ * brightness and fade factors are 0-255.
+ */
+
+// sin8(theta) = 127.5 + 127.5 * sin(2 * PI * theta / 256), rounded
+static const uint8_t kSin8Table[256] PROGMEM = {
+    128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+    176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+    218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+    245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+    255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+    245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+    218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+    176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+    128, 124, 121, 118, 115, 112, 109, 106, 103, 100,  97,  93,  90,  88,  85,  82,
+     79,  76,  73,  70,  67,  65,  62,  59,  57,  54,  52,  49,  47,  44,  42,  40,
+     37,  35,  33,  31,  29,  27,  25,  23,  21,  20,  18,  17,  15,  14,  12,  11,
+     10,   9,   7,   6,   5,   5,   4,   3,   2,   2,   1,   1,   1,   0,   0,   0,
+      0,   0,   0,   0,   1,   1,   1,   2,   2,   3,   4,   5,   5,   6,   7,   9,
+     10,  11,  12,  14,  15,  17,  18,  20,  21,  23,  25,  27,  29,  31,  33,  35,
+     37,  40,  42,  44,  47,  49,  52,  54,  57,  59,  62,  65,  67,  70,  73,  76,
+     79,  82,  85,  88,  90,  93,  97, 100, 103, 106, 109, 112, 115, 118, 121, 124
+};
+
+// Geometric fade curves: round(255 * rate^i) for rate 0.8 / 0.7 / 0.6
+constexpr size_t kFadeCurveSize = 32;
+
+static const uint8_t kFadeCurve80[kFadeCurveSize] PROGMEM = {
+    255, 204, 163, 131, 104,  84,  67,  53,  43,  34,  27,  22,  18,  14,  11,   9,
+      7,   6,   5,   4,   3,   2,   2,   2,   1,   1,   1,   1,   0,   0,   0,   0
+};
+
+static const uint8_t kFadeCurve70[kFadeCurveSize] PROGMEM = {
+    255, 178, 125,  87,  61,  43,  30,  21,  15,  10,   7,   5,   4,   2,   2,   1,
+      1,   1,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
+};
+
+static const uint8_t kFadeCurve60[kFadeCurveSize] PROGMEM = {
+    255, 153,  92,  55,  33,  20,  12,   7,   4,   3,   2,   1,   1,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
+};
+
+/**
+ * @brief Sine of an 8-bit angle, scaled to 0-255
+ */
+inline uint8_t Sin8(uint8_t theta) { return pgm_read_byte(&kSin8Table[theta]); }
+
+/**
+ * @brief Cosine of an 8-bit angle, scaled to 0-255
+ */
+inline uint8_t Cos8(uint8_t theta) { return Sin8(theta + 64); }
+
+/**
+ * @brief Sine of an 8.8 phase accumulator, scaled to 0-255
+ */
+inline uint8_t Sin8Phase(uint16_t phase) { return Sin8(phase >> 8); }
+
+/**
+ * @brief Scale a value by a 0-255 factor (255 keeps the value unchanged)
+ */
+inline uint8_t Scale8(uint8_t value, uint8_t scale)
+{
+   return (static_cast<uint16_t>(value) * (static_cast<uint16_t>(scale) + 1)) >> 8;
+}
+
+/**
+ * @brief Mix two values, amount 0 gives from and 255 gives to
+ */
+inline uint8_t Blend8(uint8_t from, uint8_t to, uint8_t amount)
+{
+   return Scale8(from, 255 - amount) + Scale8(to, amount);
+}
+
+/**
+ * @brief Look up step i of a fade curve, 0 once the curve has run out
+ */
+inline uint8_t FadeCurve(const uint8_t *curve, uint8_t i)
+{
+   return i < kFadeCurveSize ? pgm_read_byte(&curve[i]) : 0;
+}
+
+/**
+ * @brief 8.8 phase increment for one full turn every periodCenti / 100 steps
+ */
+constexpr uint16_t PhaseIncrement(uint32_t periodCenti)
+{
+   return static_cast<uint16_t>((65536UL * 100 + periodCenti / 2) / periodCenti);
+}
@@ -1,24 +1,44 @@
 #pragma once
 
-#include <Adafruit_NeoPixel.h>
-
 #include "command.h"
 #include "eeprom_handler.h"
+#include "pixel_output.h"
+
+// Render task runs on the APP core, WiFi/ESP-NOW stay on the PRO core
+constexpr BaseType_t kRenderTaskCore = APP_CPU_NUM;
+constexpr UBaseType_t kRenderTaskPriority = 2;
+constexpr uint32_t kRenderTaskStackSize = 4096;
+constexpr uint32_t kRenderFps = 60;
+constexpr uint32_t kRenderIntervalMs = 1000 / kRenderFps;
+constexpr size_t kRenderQueueSize = 16;
 
-extern Adafruit_NeoPixel *strip;
-extern uint16_t numLeds;
+/**
+ * @brief CPU cost of the active effect, measured on the render core
+ * Cycles cover drawing only; Show() hands the frame to the RMT and returns.
+ */
+struct RenderStats
+{
+	uint8_t effect;
+	uint16_t numLeds;
+	uint32_t lastFrameCycles;
+	uint32_t maxFrameCycles;
+	uint32_t frames;
+};
 
-constexpr int kLedType = NEO_GRB + NEO_KHZ800;
+/*
+ * All functions below are called from the state machine. They only queue a
+ * Command for the render task, which owns the strip and does the drawing.
+ */
 
 /**
- * @brief Initialize LED strip from config
+ * @brief Initialize LED strip from config and start the render task
  */
 void InitializeLeds();
 
 /**
- * @brief Set all LEDs to a single color
+ * @brief Re-read LED count and pin from config and recreate the strip
  */
-void SetLedColor(uint8_t r, uint8_t g, uint8_t b);
+void ReinitializeLeds();
 
 /**
  * @brief Turn off all LEDs (with current fade behavior)
@@ -41,45 +61,48 @@ void SetLedCount(uint8_t count);
 void SetLedEffect(const Command &cmd);
 
 /**
- * @brief Update current running effect (call in loop)
+ * @brief Define one strip segment and save the segment table
+ * @param segment 1-based segment number, kSegmentAll goes back to one segment over the whole strip
+ * @param length LED count, 0 removes the segment
+ * @param flags SegmentFlag bits
  */
-void UpdateLedEffect();
+void SetLedSegment(uint8_t segment, uint16_t start, uint16_t length, uint8_t flags);
 
 /**
- * @brief Update standby animation
+ * @brief Set blend mode ([10]) and opacity ([15]) of the layer a kSetLayer command picks
  */
-void UpdateStandbyAnimation();
+void SetLedLayerMix(const Command &cmd);
 
 /**
- * @brief Set identify blink effect
- * @param durationMs Duration in milliseconds
+ * @brief Show standby animation (random dim pixels in standby color)
  */
-void SetIdentifyEffect(uint16_t durationMs);
+void ShowStandbyAnimation();
 
 /**
- * @brief Set emergency red blink effect
+ * @brief Show unconfigured animation (slow red pulse)
  */
-void SetEmergencyEffect();
+void ShowUnconfiguredAnimation();
 
 /**
- * @brief Apply intensity to a color
+ * @brief Show pairing animation (blue blink)
  */
-uint32_t ApplyIntensity(uint32_t color, uint8_t intensity);
+void ShowPairingAnimation();
 
 /**
- * @brief Get color wheel value (0-255)
+ * @brief Show dim white standby color
  */
-uint32_t WheelColor(uint8_t pos);
+void ShowDimWhiteStandby();
 
 /**
- * @brief Update unconfigured animation (slow red pulse)
+ * @brief Set identify blink effect
+ * @param durationMs Duration in milliseconds
  */
-void UpdateUnconfiguredAnimation();
+void SetIdentifyEffect(uint16_t durationMs);
 
 /**
- * @brief Update pairing animation (blue blink)
+ * @brief Set emergency red blink effect
  */
-void UpdatePairingAnimation();
+void SetEmergencyEffect();
 
 /**
  * @brief Show pairing success feedback (green flash)
@@ -107,12 +130,16 @@ void SetConfigFailedFeedback();
 void TriggerHeartbeatFlash();
 
 /**
- * @brief Update heartbeat flash animation (call in loop)
- * @returns true if flash is active
+ * @brief Apply intensity to a color
  */
-bool UpdateHeartbeatFlash();
+uint32_t ApplyIntensity(uint32_t color, uint8_t intensity);
 
 /**
- * @brief Show dim white standby color
+ * @brief Get color wheel value (0-255)
  */
-void ShowDimWhiteStandby();
+uint32_t WheelColor(uint8_t pos);
+
+/**
+ * @brief Frame cycle counts of the active effect (reset on every new effect)
+ */
+RenderStats GetRenderStats();
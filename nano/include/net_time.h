@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+/*
+ * Network time base shared by all Nanos. The gateway broadcasts its clock in
+ * time beacons; every Nano keeps a filtered offset to it. Network time is the
+ * gateway's esp_timer clock.
+ */
+
+/**
+ * @brief Feed a received time beacon into the clock filter
+ * @param gatewayTimeUs Gateway time from the beacon
+ * @param localRxTimeUs Local esp_timer time taken in the receive callback
+ */
+void OnTimeBeacon(int64_t gatewayTimeUs, int64_t localRxTimeUs);
+
+/**
+ * @brief Check if the offset to the gateway clock is known and recent
+ */
+bool IsNetworkTimeSynced();
+
+/**
+ * @brief Current network time in microseconds (local time if not synced)
+ */
+int64_t GetNetworkTimeUs();
+
+/**
+ * @brief Current network time in milliseconds, wraps like millis()
+ */
+uint32_t GetNetworkTimeMs();
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+
+constexpr rmt_channel_t kPixelRmtChannel = RMT_CHANNEL_0;
+constexpr uint8_t kPixelRmtClockDivider = 2; // 80 MHz APB / 2 = 25 ns per tick
+
+// WS2812B bit timings in nanoseconds
+constexpr uint32_t kPixelT0HighNs = 400;
+constexpr uint32_t kPixelT0LowNs = 850;
+constexpr uint32_t kPixelT1HighNs = 800;
+constexpr uint32_t kPixelT1LowNs = 450;
+
+// Low time after a frame before the strip latches it (WS2812B needs >280 us)
+constexpr int64_t kPixelLatchUs = 300;
+
+/**
+ * @brief Double-buffered WS2812 (GRB) output driven by the RMT peripheral
+ *
+ * Effects draw into the back buffer. Show() swaps buffers and starts a
+ * non-blocking RMT transmission of the finished frame, so the CPU is free
+ * and interrupts stay enabled while the bits are clocked out. The new back
+ * buffer starts as a copy of the frame on the wire, so effects that fade
+ * the previous frame keep working.
+ */
+class PixelOutput
+{
+public:
+   PixelOutput(uint16_t numPixels, uint8_t pin);
+   ~PixelOutput();
+
+   /**
+    * @brief Configure the RMT channel and blank the strip
+    * @returns true on success
+    */
+   bool Begin();
+
+   /**
+    * @brief Pack RGB into the 0x00RRGGBB format used by all effects
+    */
+   static uint32_t Color(uint8_t r, uint8_t g, uint8_t b)
+   {
+      return (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+   }
+
+   void SetPixelColor(uint16_t index, uint32_t color);
+   uint32_t GetPixelColor(uint16_t index) const;
+   void Fill(uint32_t color, uint16_t first, uint16_t count);
+   void Clear();
+
+   /**
+    * @brief Hand the back buffer to the RMT peripheral and return immediately
+    * Only waits if the previous frame is still being transmitted or the
+    * strip has not had kPixelLatchUs to latch it yet.
+    */
+   void Show();
+
+   uint16_t NumPixels() const { return numPixels; }
+
+private:
+   uint16_t numPixels;
+   uint8_t pin;
+   size_t numBytes;
+   uint8_t *frontBuffer = nullptr;
+   uint8_t *backBuffer = nullptr;
+   bool started = false;
+   bool transmitting = false;
+   int64_t txStartUs = 0;
+};
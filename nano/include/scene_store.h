@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "command.h"
+
+/*
+ * Scene table, uploaded by the hub at soundcheck and fired during the show by
+ * compact trigger frames (see constants.h and PROTOCOL.md).
+ *
+ * Every scene is a full 16-byte command. The hub may upload several commands
+ * under the same scene id for different groups; each Nano keeps the one that
+ * matches its own groups, so one trigger gives every instrument its own look.
+ * The table lives in RAM and is written to NVS once the upload went quiet, so
+ * it survives a reboot during the show.
+ *
+ * A trigger carries (groups, scene id) pairs. The first pair that matches this
+ * Nano's groups and names a scene it has stored wins; pairs for scenes it does
+ * not have are skipped.
+ */
+
+/**
+ * @brief Load the scene table from NVS
+ */
+void InitializeScenes();
+
+/**
+ * @brief Switch to a table, a different id drops all stored scenes
+ */
+void BeginSceneTable(uint16_t tableId);
+
+/**
+ * @brief Store one scene of the current table
+ * @param command 16-byte command, ignored unless it is an LED effect for this Nano
+ * @returns true if stored
+ */
+bool StoreScene(uint8_t sceneId, const uint8_t *command);
+
+/**
+ * @brief Look up a scene of the given table
+ * @returns false if the table is not loaded or the scene is unknown
+ */
+bool LoadScene(uint16_t tableId, uint8_t sceneId, Command &cmd);
+
+/**
+ * @brief Write a changed table to NVS after kScenePersistDelayMs without uploads
+ * Call once per loop.
+ */
+void ProcessScenes();
+
+uint16_t GetSceneTableId();
+uint16_t GetSceneCount();
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Sliding-window sequence deduplication for one sender
+ *
+ * Anti-replay style: a bitmap anchored at the highest sequence seen so far,
+ * bit i set means (highest - i) was seen. Comparisons are wrap-aware, so the
+ * 16-bit counter can roll over freely. A sequence far behind the window, or
+ * one arriving after the sender was quiet for a while, means the sender
+ * restarted and re-anchors the window instead of being dropped forever.
+ */
+class SeqWindow
+{
+public:
+   static constexpr uint16_t kSize = 64;
+   static constexpr uint16_t kRestartGap = 1024;
+   static constexpr uint32_t kReanchorMs = 1000;
+
+   /**
+    * @brief Check if seq was already seen
+    */
+   bool IsKnown(uint16_t seq, uint32_t now) const
+   {
+      if (!anchored)
+         return false;
+
+      int16_t diff = static_cast<int16_t>(seq - highest);
+      if (diff > 0)
+         return false;
+
+      uint16_t behind = -diff;
+      if (behind < kSize)
+         return (bitmap >> behind) & 1;
+
+      // Older than the window: a late copy, unless the sender restarted
+      return !IsRestart(behind, now);
+   }
+
+   /**
+    * @brief Record seq as seen
+    */
+   void Add(uint16_t seq, uint32_t now)
+   {
+      int16_t diff = static_cast<int16_t>(seq - highest);
+      uint16_t behind = -diff;
+
+      if (!anchored || (diff < 0 && behind >= kSize && IsRestart(behind, now)))
+      {
+         anchored = true;
+         highest = seq;
+         bitmap = 1;
+      }
+      else if (diff > 0)
+      {
+         bitmap = diff < kSize ? (bitmap << diff) | 1 : 1;
+         highest = seq;
+      }
+      else if (behind < kSize)
+      {
+         bitmap |= 1ULL << behind;
+      }
+
+      lastSeen = now;
+   }
+
+   void Clear()
+   {
+      anchored = false;
+      bitmap = 0;
+   }
+
+private:
+   bool IsRestart(uint16_t behind, uint32_t now) const
+   {
+      return behind >= kRestartGap || now - lastSeen >= kReanchorMs;
+   }
+
+   bool anchored = false;
+   uint16_t highest = 0;
+   uint64_t bitmap = 0;
+   uint32_t lastSeen = 0;
+};
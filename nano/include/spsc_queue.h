@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring buffer
+ *
+ * Push() must only ever be called from one task (or callback) and Pop() from
+ * exactly one other. Indices run freely and are masked on access, so all N
+ * slots are usable. N must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscQueue
+{
+   static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+   /**
+    * @brief Append an item (producer side)
+    * @returns false if the queue is full, the item is dropped
+    */
+   bool Push(const T &item)
+   {
+      size_t t = tail.load(std::memory_order_relaxed);
+      if (t - head.load(std::memory_order_acquire) >= N)
+         return false;
+
+      items[t & (N - 1)] = item;
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+   }
+
+   /**
+    * @brief Take the oldest item (consumer side)
+    * @returns false if the queue is empty
+    */
+   bool Pop(T &item)
+   {
+      size_t h = head.load(std::memory_order_relaxed);
+      if (h == tail.load(std::memory_order_acquire))
+         return false;
+
+      item = items[h & (N - 1)];
+      head.store(h + 1, std::memory_order_release);
+      return true;
+   }
+
+   /**
+    * @brief Number of queued items (approximate when called concurrently)
+    */
+   size_t Size() const
+   {
+      return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+   }
+
+   static constexpr size_t Capacity() { return N; }
+
+private:
+   T items[N];
+   std::atomic<size_t> head{0};
+   std::atomic<size_t> tail{0};
+};
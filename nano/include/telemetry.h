@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "states.h"
+
+/*
+ * Status beacon, sent to the gateway once per kTelemetryIntervalMs:
+ *   [0xA1][state][firmware][register][last hub SEQ u16][RX overflows u16]
+ *   [relays dropped u16][max loop time us u16][RSSI i8][battery mV u16][beacon no.]
+ *   [status: bit 0 network time synced, bit 1 heartbeat timed out]
+ * Multi-byte values are big-endian, counters saturate at 0xFFFF.
+ *
+ * The interval is split into kTelemetrySlots slots of network time. Each Nano
+ * sends in the slot picked by its register and MAC, at a random point in the
+ * first half of it, so a full band does not collide at the gateway.
+ */
+
+/**
+ * @brief Track the loop time and send the status beacon when its slot is due
+ * Call once per loop.
+ */
+void ProcessTelemetry(State state);
@@ -2,7 +2,7 @@
 
 #include "logging.h"
 
-Command ParseCommand(const uint8_t *buffer)
+Command ParseCommand(const uint8_t *buffer, size_t len)
 {
   Command cmd;
 
@@ -12,12 +12,21 @@ Command ParseCommand(const uint8_t *buffer)
   cmd.groups = (static_cast<uint16_t>(buffer[4]) << 8) | buffer[5];
   cmd.duration = (static_cast<uint16_t>(buffer[6]) << 8) | buffer[7];
   cmd.length = buffer[8];
-  cmd.rainbow = buffer[9];
+  cmd.rainbow = buffer[9] & kRainbowMask;
+  cmd.segment = buffer[9] >> kSegmentShift;
+  cmd.layer = (buffer[9] >> kLayerShift) & kLayerMask;
   cmd.r = buffer[10];
   cmd.g = buffer[11];
   cmd.b = buffer[12];
   cmd.speed = (static_cast<uint16_t>(buffer[13]) << 8) | buffer[14];
   cmd.intensity = buffer[15];
+  cmd.syncTime = 0;
+
+  if (len >= kSyncFrameSize)
+  {
+    cmd.syncTime = (static_cast<uint32_t>(buffer[16]) << 24) | (static_cast<uint32_t>(buffer[17]) << 16) |
+                   (static_cast<uint32_t>(buffer[18]) << 8) | buffer[19];
+  }
 
   LOGF("CMD seq=%u fx=0x%02X grp=0x%04X dur=%u rgb=%u,%u,%u spd=%u int=%u\n",
        cmd.seq, cmd.effect, cmd.groups, cmd.duration,
@@ -3,6 +3,7 @@
 #include "logging.h"
 
 NanoConfig config;
+SegmentConfig segmentTable[kMaxSegments] = {};
 Preferences preferences;
 
 NanoConfig GetDefaultConfig()
@@ -34,6 +35,7 @@ void InitializeEEPROM()
 	LOG("EEPROM initialized");
 	LoadConfig();
 	LoadPairingConfig();
+	LoadSegments();
 }
 
 void LoadConfig()
@@ -163,6 +165,35 @@ void ClearPairingConfig()
 	LOG("Pairing config cleared");
 }
 
+void LoadSegments()
+{
+	memset(segmentTable, 0, sizeof(segmentTable));
+
+	if (!preferences.begin(kNvsNamespace, true))
+		return;
+
+	if (preferences.getBytesLength(kNvsKeySegments) == sizeof(segmentTable))
+	{
+		preferences.getBytes(kNvsKeySegments, segmentTable, sizeof(segmentTable));
+		LOG("Segment table loaded");
+	}
+	preferences.end();
+}
+
+bool SaveSegments()
+{
+	if (!preferences.begin(kNvsNamespace, false))
+	{
+		LOG("Failed to open NVS for writing");
+		return false;
+	}
+
+	preferences.putBytes(kNvsKeySegments, segmentTable, sizeof(segmentTable));
+	preferences.end();
+	LOG("Segment table saved");
+	return true;
+}
+
 uint16_t RegisterToGroupBitmask(uint8_t deviceRegister)
 {
 	// Register 0 means unconfigured - only respond to kAll (broadcast)
@@ -1,38 +1,85 @@
 #include "espnow_handler.h"
 
 #include <esp_now.h>
+#include <esp_timer.h>
 #include <esp_wifi.h>
 #include <WiFi.h>
 
 #include "constants.h"
 #include "eeprom_handler.h"
 #include "logging.h"
+#include "net_time.h"
+#include "scene_store.h"
+#include "seq_window.h"
+#include "spsc_queue.h"
 #include "states.h"
 
 namespace
 {
-   uint16_t seqBuffer[kIdempotencyBufferSize];
-   uint8_t seqBufferIndex = 0;
-   bool seqBufferFull = false;
+   SeqWindow seqWindows[Source::kCount];
+
+   struct RxFrame
+   {
+      int64_t rxTimeUs;
+      uint8_t length;
+      uint8_t data[kRxFrameMaxSize];
+   };
+
+   // Written by the WiFi task in OnDataReceived, drained by ProcessEspNow
+   SpscQueue<RxFrame, kRxQueueSize> rxQueue;
+   volatile uint32_t rxOverflows = 0;
+   volatile uint32_t rxHighWater = 0;
 
-   volatile bool commandPending = false;
-   uint8_t receiveBuffer[kFrameSize];
    Command pendingCommand;
 
+   // Batch being worked through, one command per loop
+   RxFrame batchFrame;
+   uint8_t batchNext = 0;
+   uint8_t batchCount = 0;
+
+   // Timed cues waiting for their network start time
+   Command cueQueue[kCueQueueSize];
+   bool cueUsed[kCueQueueSize] = {};
+
    uint32_t lastHeartbeat = 0;
-   uint32_t lastRebroadcast = 0;
+   uint16_t lastHubSeq = 0;
+   volatile int8_t lastRssi = 0;
 
    uint8_t broadcastMac[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
    bool peerAdded = false;
 
-   volatile bool pairingMessagePending = false;
-   uint8_t pairingBuffer[8];
-   int pairingBufferLen = 0;
-
-   // Non-blocking rebroadcast state
-   bool rebroadcastPending = false;
-   uint8_t rebroadcastData[kFrameSize];
-   uint32_t rebroadcastTime = 0;
+   // Pending rebroadcasts, each with its own random timer
+   struct RebroadcastSlot
+   {
+      bool used;
+      uint8_t source;
+      uint16_t seq;
+      uint8_t overheard;
+      uint32_t dueTime;
+      size_t length;
+      uint8_t data[kRxFrameMaxSize];
+   };
+
+   RebroadcastSlot rebroadcastQueue[kRebroadcastQueueSize] = {};
+   uint32_t rebroadcastsSent = 0;
+   uint32_t rebroadcastsSuppressed = 0;
+   uint32_t rebroadcastsDropped = 0;
+
+   // Time beacons are relayed once per beacon id, re-stamped when sent
+   bool beaconRelayPending = false;
+   uint8_t beaconRelayId = 0;
+   uint8_t beaconRelayTTL = 0;
+   uint32_t beaconRelayStart = 0;
+   uint32_t beaconRelayDelay = 0;
+   int16_t lastBeaconId = -1;
+
+   // Stress test, counted since the last START
+   StressStats stress = {};
+   uint16_t stressFirstSeq = 0;
+   uint16_t stressNewestSeq = 0;
+   uint64_t stressProcessingSumUs = 0;
+   bool stressReportPending = false;
+   uint32_t stressReportTime = 0;
 
    bool MatchesMac(const Command &cmd)
    {
@@ -50,27 +97,46 @@ namespace
       return memcmp(myMac, cmdMac, 6) == 0;
    }
 
+   /**
+    * @brief ESP-NOW receive callback (WiFi task)
+    * Only timestamps and queues the frame, all parsing happens in ProcessEspNow.
+    */
    void OnDataReceived(const uint8_t *mac, const uint8_t *data, int len)
    {
-      if (len >= 1 && IsPairingCommand(data[0]))
+      if (len <= 0 || len > static_cast<int>(kRxFrameMaxSize))
       {
-         if (len <= 8)
-         {
-            memcpy(pairingBuffer, data, len);
-            pairingBufferLen = len;
-            pairingMessagePending = true;
-         }
+         LOGF("Invalid frame size: %d\n", len);
          return;
       }
 
-      if (len != kFrameSize)
+      RxFrame frame;
+      frame.rxTimeUs = esp_timer_get_time();
+      frame.length = len;
+      memcpy(frame.data, data, len);
+
+      if (!rxQueue.Push(frame))
       {
-         LOGF("Invalid frame size: %d\n", len);
+         rxOverflows = rxOverflows + 1;
          return;
       }
 
-      memcpy(receiveBuffer, data, kFrameSize);
-      commandPending = true;
+      uint32_t depth = rxQueue.Size();
+      if (depth > rxHighWater)
+         rxHighWater = depth;
+   }
+
+   /**
+    * @brief Promiscuous receive callback (WiFi task), only keeps the RSSI
+    * The ESP-NOW receive callback has no RSSI, every ESP-NOW frame is a
+    * vendor-specific action frame and passes through here first.
+    */
+   void OnPromiscuousReceived(void *buffer, wifi_promiscuous_pkt_type_t type)
+   {
+      const wifi_promiscuous_pkt_t *packet = static_cast<const wifi_promiscuous_pkt_t *>(buffer);
+      if (type == WIFI_PKT_MGMT && packet->payload[0] == kActionFrameControl)
+      {
+         lastRssi = packet->rx_ctrl.rssi;
+      }
    }
 
    void OnDataSent(const uint8_t *mac, esp_now_send_status_t status)
@@ -101,175 +167,725 @@ namespace
       return true;
    }
 
-   void ScheduleRebroadcast(const uint8_t *data, uint8_t ttl)
+   RebroadcastSlot *FindRebroadcast(uint8_t source, uint16_t seq)
+   {
+      for (size_t i = 0; i < kRebroadcastQueueSize; i++)
+      {
+         RebroadcastSlot &slot = rebroadcastQueue[i];
+         if (slot.used && slot.source == source && slot.seq == seq)
+            return &slot;
+      }
+      return nullptr;
+   }
+
+   /**
+    * @brief Count a copy of a frame overheard from a neighbour
+    * Cancels our own pending rebroadcast once enough neighbours already sent it.
+    */
+   void NoteOverheard(uint8_t source, uint16_t seq)
+   {
+      RebroadcastSlot *slot = FindRebroadcast(source, seq);
+      if (slot == nullptr)
+         return;
+
+      slot->overheard++;
+      if (slot->overheard >= kRebroadcastSuppressCount)
+      {
+         slot->used = false;
+         rebroadcastsSuppressed++;
+      }
+   }
+
+   bool IsBatchFrame(const uint8_t *data, size_t len)
+   {
+      return len > kBatchHeaderSize && data[0] == kBatchMarker && data[1] > 0 &&
+             data[1] <= kBatchMaxCommands && len == kBatchHeaderSize + data[1] * kFrameSize;
+   }
+
+   /**
+    * @brief Queue a frame for relaying with its TTL decremented
+    * @param source, seq Identity of the frame, for a batch its first command
+    */
+   void ScheduleRebroadcast(const uint8_t *data, size_t len, uint8_t source, uint16_t seq, uint8_t ttl)
    {
       // Don't rebroadcast if TTL is 0 or mesh is disabled
       if (ttl == 0 || config.meshTTL == 0)
          return;
 
-      // Don't schedule if another rebroadcast is pending
-      if (rebroadcastPending)
+      // Forced frames bypass dedup, a second copy only counts as overheard
+      if (FindRebroadcast(source, seq) != nullptr)
+      {
+         NoteOverheard(source, seq);
          return;
+      }
 
-      uint32_t now = millis();
-      if (now - lastRebroadcast < kRebroadcastMinGap)
+      for (size_t i = 0; i < kRebroadcastQueueSize; i++)
+      {
+         RebroadcastSlot &slot = rebroadcastQueue[i];
+         if (slot.used)
+            continue;
+
+         memcpy(slot.data, data, len);
+         if (IsBatchFrame(data, len))
+         {
+            for (size_t n = 0; n < data[1]; n++)
+            {
+               uint8_t &flagsByte = slot.data[kBatchHeaderSize + n * kFrameSize + 2];
+               flagsByte = SetTTL(flagsByte, ttl - 1);
+            }
+         }
+         else
+         {
+            slot.data[2] = SetTTL(slot.data[2], ttl - 1);
+         }
+         slot.length = len;
+         slot.source = source;
+         slot.seq = seq;
+         slot.overheard = 0;
+         slot.dueTime = millis() + random(kRebroadcastJitterMax);
+         slot.used = true;
          return;
+      }
+
+      rebroadcastsDropped++;
+   }
+
+   void ProcessPendingRebroadcasts()
+   {
+      uint32_t now = millis();
+
+      for (size_t i = 0; i < kRebroadcastQueueSize; i++)
+      {
+         RebroadcastSlot &slot = rebroadcastQueue[i];
+         if (!slot.used || static_cast<int32_t>(now - slot.dueTime) < 0)
+            continue;
+
+         SendBroadcast(slot.data, slot.length);
+         slot.used = false;
+         rebroadcastsSent++;
+      }
+   }
+
+   /**
+    * @brief Hold a SYNC command until its start time if that is still ahead
+    * @returns true if queued, false if it should run right away
+    */
+   bool QueueCue(const Command &cmd)
+   {
+      if (cmd.syncTime == 0 || !IsNetworkTimeSynced())
+         return false;
+
+      int32_t lead = cmd.syncTime - GetNetworkTimeMs();
+      if (lead <= 0 || lead > kMaxCueLeadMs)
+         return false;
+
+      for (size_t i = 0; i < kCueQueueSize; i++)
+      {
+         if (!cueUsed[i])
+         {
+            cueQueue[i] = cmd;
+            cueUsed[i] = true;
+            LOGF("Cue seq=%u queued, due in %ld ms\n", cmd.seq, (long)lead);
+            return true;
+         }
+      }
 
-      // Copy data and decrement TTL
-      memcpy(rebroadcastData, data, kFrameSize);
-      uint8_t newTTL = ttl - 1;
-      uint8_t flags = GetFlags(rebroadcastData[2]);
-      rebroadcastData[2] = MakeFlagsByte(newTTL, flags);
+      LOG("Cue queue full, executing now");
+      return false;
+   }
+
+   /**
+    * @brief Move the earliest due cue into pendingCommand
+    * @returns true if a cue was released
+    */
+   bool ReleaseDueCue()
+   {
+      uint32_t now = GetNetworkTimeMs();
+      int best = -1;
+      int32_t bestLead = 0;
+
+      for (size_t i = 0; i < kCueQueueSize; i++)
+      {
+         if (!cueUsed[i])
+            continue;
 
-      // Schedule for later (non-blocking)
-      uint32_t jitter = random(kRebroadcastJitterMax);
-      rebroadcastTime = now + jitter;
-      rebroadcastPending = true;
+         int32_t lead = cueQueue[i].syncTime - now;
+         if (lead <= 0 && (best < 0 || lead < bestLead))
+         {
+            best = i;
+            bestLead = lead;
+         }
+      }
+
+      if (best < 0)
+         return false;
+
+      pendingCommand = cueQueue[best];
+      cueUsed[best] = false;
+      return true;
    }
 
-   void ProcessPendingRebroadcast()
+   void ProcessTimeBeacon(const RxFrame &frame)
    {
-      if (!rebroadcastPending)
+      uint8_t id = frame.data[1];
+      uint8_t ttl = frame.data[2];
+      int64_t gatewayTime = 0;
+      for (int i = 3; i < 11; i++)
+      {
+         gatewayTime = (gatewayTime << 8) | frame.data[i];
+      }
+
+      OnTimeBeacon(gatewayTime, frame.rxTimeUs);
+
+      if (id == lastBeaconId || ttl == 0 || config.meshTTL == 0)
          return;
 
-      if (millis() < rebroadcastTime)
+      lastBeaconId = id;
+      beaconRelayId = id;
+      beaconRelayTTL = ttl - 1;
+      beaconRelayStart = millis();
+      beaconRelayDelay = random(kRebroadcastJitterMax);
+      beaconRelayPending = true;
+   }
+
+   void ProcessPendingBeaconRelay()
+   {
+      if (!beaconRelayPending || millis() - beaconRelayStart < beaconRelayDelay)
          return;
 
-      SendBroadcast(rebroadcastData, kFrameSize);
-      lastRebroadcast = millis();
-      rebroadcastPending = false;
+      beaconRelayPending = false;
+
+      uint8_t frame[kTimeBeaconSize];
+      frame[0] = kTimeBeaconMarker;
+      frame[1] = beaconRelayId;
+      frame[2] = beaconRelayTTL;
+      int64_t now = GetNetworkTimeUs();
+      for (int i = 10; i >= 3; i--)
+      {
+         frame[i] = now & 0xFF;
+         now >>= 8;
+      }
+
+      SendBroadcast(frame, sizeof(frame));
    }
-}
 
-bool InitializeEspNow()
-{
-   WiFi.mode(WIFI_STA);
-   WiFi.disconnect();
-   esp_wifi_set_channel(config.channel, WIFI_SECOND_CHAN_NONE);
+   /**
+    * @brief Parse and filter one 16/20-byte command into pendingCommand
+    * pendingCommand stays kNop if the command is not for the state machine.
+    * @returns true if the command was new, i.e. a candidate for relaying
+    */
+   bool FilterCommand(const uint8_t *data, size_t len)
+   {
+      pendingCommand = ParseCommand(data, len);
 
-   esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_LR);
-   LOG("ESP-NOW Pure Long Range mode enabled");
+      // Pairing replies are addressed by MAC and always carry SEQ 0
+      bool isPairingReply = pendingCommand.effect == Cmd::kPairingAckRecv || pendingCommand.effect == Cmd::kConfigSetRecv;
 
-   LOGF("WiFi STA mode on channel %u\n", config.channel);
-   LOGF("MAC: %s\n", WiFi.macAddress().c_str());
+      if (!isPairingReply)
+      {
+         uint8_t source = GetSource(data[2]);
+         bool forceFlag = HasForceFlag(pendingCommand);
+         bool isDuplicate = IsKnownSeq(source, pendingCommand.seq);
 
-   if (esp_now_init() != ESP_OK)
+         if (isDuplicate && !forceFlag)
+         {
+            NoteOverheard(source, pendingCommand.seq);
+            LOGF("Duplicate SEQ %u (src=%u) ignored\n", pendingCommand.seq, source);
+            pendingCommand.effect = Cmd::kNop;
+            return false;
+         }
+
+         AddKnownSeq(source, pendingCommand.seq);
+         if (source == Source::kHub)
+            lastHubSeq = pendingCommand.seq;
+      }
+
+      if (isPairingReply)
+      {
+         if (MatchesMac(pendingCommand))
+         {
+            LOGF("Pairing message for this device (fx=0x%02X)\n", pendingCommand.effect);
+
+            if (pendingCommand.effect == Cmd::kPairingAckRecv)
+            {
+               if (!IsPairingActive())
+               {
+                  LOG("Received PAIRING_ACK but not in pairing mode");
+               }
+               else
+               {
+                  OnPairingAckReceived();
+               }
+            }
+            else if (pendingCommand.effect == Cmd::kConfigSetRecv)
+            {
+               uint8_t deviceRegister = pendingCommand.length;
+               uint16_t ledCount = pendingCommand.duration;
+               // Standby color is encoded in: flags = B, groups = (R << 8) | G
+               uint8_t standbyR = (pendingCommand.groups >> 8) & 0xFF;
+               uint8_t standbyG = pendingCommand.groups & 0xFF;
+               uint8_t standbyB = pendingCommand.flags;
+
+               LOGF("CONFIG_SET: register=%u, ledCount=%u, standby=(%u,%u,%u)\n",
+                    deviceRegister, ledCount, standbyR, standbyG, standbyB);
+               bool success = OnConfigSetReceived(deviceRegister, ledCount, standbyR, standbyG, standbyB);
+               SendConfigAck(success);
+            }
+         }
+         else
+         {
+            LOGF("Pairing message for different MAC (fx=0x%02X)\n", pendingCommand.effect);
+         }
+
+         pendingCommand.effect = Cmd::kNop;
+         return false;
+      }
+
+      if (!MatchesGroup(pendingCommand, config.groups))
+      {
+         LOGF("Group mismatch: cmd=0x%04X my=0x%04X\n", pendingCommand.groups, config.groups);
+         pendingCommand.effect = Cmd::kNop;
+         return true;
+      }
+
+      if (pendingCommand.effect == Cmd::kHeartbeat)
+      {
+         lastHeartbeat = millis();
+         LOGF("Heartbeat received (seq=%u)\n", pendingCommand.seq);
+      }
+
+      if (HasSyncFlag(pendingCommand) && QueueCue(pendingCommand))
+      {
+         pendingCommand.effect = Cmd::kNop;
+      }
+
+      return true;
+   }
+
+   void ProcessCommandFrame(const RxFrame &frame)
    {
-      LOG("ESP-NOW init failed");
+      if (FilterCommand(frame.data, frame.length) && !HasNoRebroadcastFlag(pendingCommand))
+      {
+         ScheduleRebroadcast(frame.data, frame.length, GetSource(frame.data[2]), pendingCommand.seq,
+                             GetTTL(frame.data[2]));
+      }
+   }
+
+   /**
+    * @brief Filter the remaining commands of the current batch
+    * @returns true as soon as one is for this Nano, the rest wait for the next loop
+    */
+   bool NextBatchCommand()
+   {
+      while (batchNext < batchCount)
+      {
+         // Entry plus the shared start time forms a regular SYNC frame
+         uint8_t entry[kSyncFrameSize];
+         memcpy(entry, &batchFrame.data[kBatchHeaderSize + batchNext * kFrameSize], kFrameSize);
+         memcpy(&entry[kFrameSize], &batchFrame.data[2], kSyncFrameSize - kFrameSize);
+         batchNext++;
+
+         FilterCommand(entry, kSyncFrameSize);
+         if (pendingCommand.effect != Cmd::kNop)
+            return true;
+      }
+
       return false;
    }
 
-   esp_now_register_recv_cb(OnDataReceived);
-   esp_now_register_send_cb(OnDataSent);
+   /**
+    * @brief Relay a batch as a whole and start working through its commands
+    * All commands of a batch come from one sender, the first one identifies it.
+    */
+   bool ProcessBatchFrame(const RxFrame &frame)
+   {
+      const uint8_t *first = &frame.data[kBatchHeaderSize];
+      uint8_t source = GetSource(first[2]);
+      uint16_t seq = (first[0] << 8) | first[1];
 
-   if (!AddBroadcastPeer())
+      if (IsKnownSeq(source, seq) && !(GetFlags(first[2]) & Flag::kForce))
+      {
+         NoteOverheard(source, seq);
+         return false;
+      }
+
+      if (!(GetFlags(first[2]) & Flag::kNoRebroadcast))
+      {
+         ScheduleRebroadcast(frame.data, frame.length, source, seq, GetTTL(first[2]));
+      }
+
+      batchFrame = frame;
+      batchNext = 0;
+      batchCount = frame.data[1];
+      return NextBatchCommand();
+   }
+
+   bool IsSceneFrame(const uint8_t *data, size_t len)
    {
-      return false;
+      if (len <= kSceneStoreHeaderSize || data[1] == 0)
+         return false;
+
+      if (data[0] == kSceneStoreMarker)
+         return data[1] <= kSceneStoreMaxEntries && len == kSceneStoreHeaderSize + data[1] * kSceneStoreEntrySize;
+
+      return data[0] == kSceneTriggerMarker && data[1] <= kSceneTriggerMaxPairs &&
+             len == kSceneTriggerHeaderSize + data[1] * kSceneTriggerPairSize;
    }
 
-   ClearKnownSeqs();
-   lastHeartbeat = millis();
+   /**
+    * @brief Deduplicate a scene frame by its SEQ and relay it like a command
+    * @returns true if the frame is new
+    */
+   bool AcceptSceneFrame(const RxFrame &frame)
+   {
+      uint8_t flagsByte = frame.data[2];
+      uint8_t source = GetSource(flagsByte);
+      uint16_t seq = (frame.data[3] << 8) | frame.data[4];
 
-   LOG("ESP-NOW initialized");
-   return true;
-}
+      if (IsKnownSeq(source, seq) && !(GetFlags(flagsByte) & Flag::kForce))
+      {
+         NoteOverheard(source, seq);
+         return false;
+      }
 
-void ProcessEspNow()
-{
-   // Process any pending rebroadcast (non-blocking)
-   ProcessPendingRebroadcast();
+      AddKnownSeq(source, seq);
+      if (source == Source::kHub)
+         lastHubSeq = seq;
+
+      if (!(GetFlags(flagsByte) & Flag::kNoRebroadcast))
+      {
+         ScheduleRebroadcast(frame.data, frame.length, source, seq, GetTTL(flagsByte));
+      }
+      return true;
+   }
 
-   if (pairingMessagePending)
+   void ProcessSceneStore(const RxFrame &frame)
    {
-      pairingMessagePending = false;
-      ProcessPairingMessage(pairingBuffer, pairingBufferLen);
+      if (!AcceptSceneFrame(frame))
+         return;
+
+      BeginSceneTable((frame.data[5] << 8) | frame.data[6]);
+
+      const uint8_t *entry = &frame.data[kSceneStoreHeaderSize];
+      for (uint8_t n = 0; n < frame.data[1]; n++, entry += kSceneStoreEntrySize)
+      {
+         StoreScene(entry[0], &entry[1]);
+      }
    }
 
-   if (!commandPending)
-      return;
+   /**
+    * @brief Fire the scene of the first pair addressed to this Nano
+    * The scene runs as a SYNC command with the trigger's SEQ and start time.
+    * @returns true if it produced a command for the state machine
+    */
+   bool ProcessSceneTrigger(const RxFrame &frame)
+   {
+      if (!AcceptSceneFrame(frame))
+         return false;
 
-   commandPending = false;
+      uint16_t table = (frame.data[5] << 8) | frame.data[6];
+      uint32_t startTime = (static_cast<uint32_t>(frame.data[7]) << 24) | (static_cast<uint32_t>(frame.data[8]) << 16) |
+                           (static_cast<uint32_t>(frame.data[9]) << 8) | frame.data[10];
 
-   pendingCommand = ParseCommand(receiveBuffer);
+      // The first pair for our groups whose scene we have wins, so a kAll
+      // pair does not shadow register pairs whose scene only those registers stored
+      bool matched = false;
+      const uint8_t *pair = &frame.data[kSceneTriggerHeaderSize];
+      for (uint8_t n = 0; n < frame.data[1]; n++, pair += kSceneTriggerPairSize)
+      {
+         uint16_t groups = (pair[0] << 8) | pair[1];
+         if ((groups & config.groups) == 0)
+            continue;
+
+         matched = true;
+         Command cmd;
+         if (!LoadScene(table, pair[2], cmd))
+            continue;
+
+         cmd.seq = (frame.data[3] << 8) | frame.data[4];
+         cmd.flags = frame.data[2];
+         if (pair[3] != kSceneKeepIntensity)
+            cmd.intensity = pair[3];
+         if (startTime != 0)
+         {
+            cmd.flags |= Flag::kSync;
+            cmd.syncTime = startTime;
+         }
 
-   bool forceFlag = HasForceFlag(pendingCommand);
-   bool isDuplicate = IsKnownSeq(pendingCommand.seq);
+         pendingCommand = cmd;
+         if (HasSyncFlag(cmd) && QueueCue(cmd))
+            pendingCommand.effect = Cmd::kNop;
+         return pendingCommand.effect != Cmd::kNop;
+      }
 
-   if (isDuplicate && !forceFlag)
+      if (matched)
+         LOGF("No scene of table %u loaded for this trigger\n", table);
+      return false;
+   }
+
+   /**
+    * @brief Answer an echo probe for this Nano, part of the latency benchmark
+    * Processing covers receive ring and main loop, up to this reply. Probes
+    * are neither deduplicated nor relayed, the gateway ignores stale replies.
+    */
+   void ProcessEchoProbe(const RxFrame &frame)
    {
-      LOGF("Duplicate SEQ %u ignored\n", pendingCommand.seq);
-      pendingCommand.effect = Cmd::kNop;
-      return;
+      Command probe = ParseCommand(frame.data, frame.length);
+      if (!MatchesMac(probe))
+         return;
+
+      uint32_t processingUs = static_cast<uint32_t>(esp_timer_get_time() - frame.rxTimeUs);
+      uint32_t rxNetworkUs = static_cast<uint32_t>(GetNetworkTimeUs()) - processingUs;
+
+      uint8_t reply[kEchoReplySize];
+      reply[0] = Cmd::kDebugEcho;
+      reply[1] = frame.data[6];
+      reply[2] = frame.data[7];
+      reply[3] = IsNetworkTimeSynced() ? 1 : 0;
+      for (int i = 0; i < 4; i++)
+      {
+         reply[4 + i] = (rxNetworkUs >> (24 - i * 8)) & 0xFF;
+         reply[8 + i] = (processingUs >> (24 - i * 8)) & 0xFF;
+      }
+
+      SendBroadcast(reply, sizeof(reply));
    }
 
-   AddKnownSeq(pendingCommand.seq);
+   void ResetStressStats()
+   {
+      stress = {};
+      stressProcessingSumUs = 0;
+      LOG("Stress test started, counters reset");
+   }
 
-   if (pendingCommand.effect == Cmd::kPairingAckRecv || pendingCommand.effect == Cmd::kConfigSetRecv)
+   void CountStressFrame(uint16_t seq, bool isNew, int64_t rxTimeUs)
    {
-      if (MatchesMac(pendingCommand))
+      if (!isNew)
       {
-         LOGF("Pairing message for this device (fx=0x%02X)\n", pendingCommand.effect);
+         stress.duplicates++;
+         return;
+      }
 
-         if (pendingCommand.effect == Cmd::kPairingAckRecv)
+      if (stress.received == 0)
+      {
+         stressFirstSeq = seq;
+         stressNewestSeq = seq;
+      }
+      else if (static_cast<int16_t>(seq - stressNewestSeq) > 0)
+      {
+         stressNewestSeq = seq;
+      }
+      else
+      {
+         stress.outOfOrder++;
+         if (static_cast<int16_t>(seq - stressFirstSeq) < 0)
+            stressFirstSeq = seq;
+      }
+      stress.received++;
+
+      uint32_t processingUs = static_cast<uint32_t>(esp_timer_get_time() - rxTimeUs);
+      stressProcessingSumUs += processingUs;
+      if (processingUs > stress.maxProcessingUs)
+         stress.maxProcessingUs = processingUs;
+   }
+
+   /**
+    * @brief Count, reset or report on a stress test frame
+    * Frames are relayed like commands, but counted before dedup so mesh
+    * copies show up as duplicates.
+    */
+   void ProcessStressFrame(const RxFrame &frame)
+   {
+      const uint8_t *data = frame.data;
+      uint8_t source = GetSource(data[2]);
+      uint16_t seq = (data[0] << 8) | data[1];
+      bool isNew = !IsKnownSeq(source, seq);
+
+      if (isNew)
+      {
+         AddKnownSeq(source, seq);
+         if (!(GetFlags(data[2]) & Flag::kNoRebroadcast))
+            ScheduleRebroadcast(data, frame.length, source, seq, GetTTL(data[2]));
+      }
+      else
+      {
+         NoteOverheard(source, seq);
+      }
+
+      uint16_t groups = (data[4] << 8) | data[5];
+      if ((groups & config.groups) == 0)
+         return;
+
+      switch (data[8])
+      {
+      case StressAction::kData:
+         CountStressFrame(seq, isNew, frame.rxTimeUs);
+         break;
+      case StressAction::kStart:
+         if (isNew)
+            ResetStressStats();
+         break;
+      case StressAction::kReport:
+         if (isNew)
          {
-            if (!IsPairingActive())
-            {
-               LOG("Received PAIRING_ACK but not in pairing mode");
-            }
-            else
-            {
-               OnPairingAckReceived();
-            }
+            // Spread the replies of all Nanos so they don't collide
+            stressReportPending = true;
+            stressReportTime = millis() + random(kStressReportJitterMs);
          }
-         else if (pendingCommand.effect == Cmd::kConfigSetRecv)
+         break;
+      }
+   }
+
+   void ProcessPendingStressReport()
+   {
+      if (!stressReportPending || static_cast<int32_t>(millis() - stressReportTime) < 0)
+         return;
+
+      stressReportPending = false;
+
+      StressStats stats = GetStressStats();
+      const uint32_t values[] = {stats.received, stats.duplicates, stats.outOfOrder,
+                                 stats.missing, stats.avgProcessingUs, stats.maxProcessingUs};
+
+      uint8_t report[kStressReportSize];
+      report[0] = Cmd::kDebugStress;
+      for (size_t i = 0; i < 6; i++)
+      {
+         for (size_t b = 0; b < 4; b++)
          {
-            uint8_t deviceRegister = pendingCommand.length;
-            uint16_t ledCount = pendingCommand.duration;
-            // Standby color is encoded in: flags = B, groups = (R << 8) | G
-            uint8_t standbyR = (pendingCommand.groups >> 8) & 0xFF;
-            uint8_t standbyG = pendingCommand.groups & 0xFF;
-            uint8_t standbyB = pendingCommand.flags;
-
-            LOGF("CONFIG_SET: register=%u, ledCount=%u, standby=(%u,%u,%u)\n",
-                 deviceRegister, ledCount, standbyR, standbyG, standbyB);
-            bool success = OnConfigSetReceived(deviceRegister, ledCount, standbyR, standbyG, standbyB);
-            SendConfigAck(success);
+            report[1 + i * 4 + b] = (values[i] >> (24 - b * 8)) & 0xFF;
          }
       }
-      else
+
+      SendBroadcast(report, sizeof(report));
+      LOGF("Stress report sent: received=%lu missing=%lu\n",
+           (unsigned long)stats.received, (unsigned long)stats.missing);
+   }
+
+   /**
+    * @brief Dispatch one received frame by type
+    * @returns true if it produced a command for the state machine
+    */
+   bool ProcessFrame(const RxFrame &frame)
+   {
+      if (frame.length == kTimeBeaconSize && frame.data[0] == kTimeBeaconMarker)
       {
-         LOGF("Pairing message for different MAC (fx=0x%02X)\n", pendingCommand.effect);
+         ProcessTimeBeacon(frame);
+         return false;
       }
 
-      pendingCommand.effect = Cmd::kNop;
-      return;
-   }
+      if (frame.length <= 8 && IsPairingCommand(frame.data[0]))
+      {
+         ProcessPairingMessage(frame.data, frame.length);
+         return false;
+      }
 
-   // Extract TTL from flags byte
-   uint8_t ttl = GetTTL(receiveBuffer[2]);
+      if ((frame.length == kEchoReplySize && frame.data[0] == Cmd::kDebugEcho) ||
+          (frame.length == kStressReportSize && frame.data[0] == Cmd::kDebugStress) ||
+          (frame.length == kTelemetryBeaconSize && frame.data[0] == Cmd::kStatusBeacon))
+      {
+         // Another Nano talking to the gateway
+         return false;
+      }
 
-   if (!MatchesGroup(pendingCommand, config.groups))
-   {
-      LOGF("Group mismatch: cmd=0x%04X my=0x%04X\n", pendingCommand.groups, config.groups);
+      if (frame.length == kFrameSize && frame.data[3] == Cmd::kDebugStress)
+      {
+         ProcessStressFrame(frame);
+         return false;
+      }
 
-      if (!HasNoRebroadcastFlag(pendingCommand))
+      if (frame.length == kFrameSize && frame.data[3] == Cmd::kDebugEcho)
       {
-         ScheduleRebroadcast(receiveBuffer, ttl);
+         ProcessEchoProbe(frame);
+         return false;
       }
 
-      pendingCommand.effect = Cmd::kNop;
-      return;
+      if (IsBatchFrame(frame.data, frame.length))
+      {
+         return ProcessBatchFrame(frame);
+      }
+
+      if (IsSceneFrame(frame.data, frame.length))
+      {
+         if (frame.data[0] == kSceneStoreMarker)
+         {
+            ProcessSceneStore(frame);
+            return false;
+         }
+         return ProcessSceneTrigger(frame);
+      }
+
+      if (frame.length != kFrameSize && frame.length != kSyncFrameSize)
+      {
+         LOGF("Invalid frame size: %u\n", frame.length);
+         return false;
+      }
+
+      ProcessCommandFrame(frame);
+      return pendingCommand.effect != Cmd::kNop;
+   }
+}
+
+bool InitializeEspNow()
+{
+   WiFi.mode(WIFI_STA);
+   WiFi.disconnect();
+   esp_wifi_set_channel(config.channel, WIFI_SECOND_CHAN_NONE);
+
+   esp_wifi_set_protocol(WIFI_IF_STA, WIFI_PROTOCOL_LR);
+   LOG("ESP-NOW Pure Long Range mode enabled");
+
+   LOGF("WiFi STA mode on channel %u\n", config.channel);
+   LOGF("MAC: %s\n", WiFi.macAddress().c_str());
+
+   if (esp_now_init() != ESP_OK)
+   {
+      LOG("ESP-NOW init failed");
+      return false;
    }
 
-   if (pendingCommand.effect == Cmd::kHeartbeat)
+   esp_now_register_recv_cb(OnDataReceived);
+   esp_now_register_send_cb(OnDataSent);
+
+   wifi_promiscuous_filter_t filter = {};
+   filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+   esp_wifi_set_promiscuous_filter(&filter);
+   esp_wifi_set_promiscuous_rx_cb(OnPromiscuousReceived);
+   esp_wifi_set_promiscuous(true);
+
+   if (!AddBroadcastPeer())
    {
-      lastHeartbeat = millis();
-      LOGF("Heartbeat received (seq=%u)\n", pendingCommand.seq);
+      return false;
    }
 
-   if (!HasNoRebroadcastFlag(pendingCommand))
+   ClearKnownSeqs();
+   lastHeartbeat = millis();
+
+   LOG("ESP-NOW initialized");
+   return true;
+}
+
+void ProcessEspNow()
+{
+   // Process any pending rebroadcast (non-blocking)
+   ProcessPendingRebroadcasts();
+   ProcessPendingBeaconRelay();
+   ProcessPendingStressReport();
+
+   // A due cue takes this loop, received frames wait for the next one
+   if (ReleaseDueCue())
+      return;
+
+   if (NextBatchCommand())
+      return;
+
+   // Drain until one frame yields a command, the rest stay queued for the
+   // next loop so no cue is overwritten
+   RxFrame frame;
+   while (rxQueue.Pop(frame))
    {
-      ScheduleRebroadcast(receiveBuffer, ttl);
+      if (ProcessFrame(frame))
+         return;
    }
 }
 
@@ -284,36 +900,22 @@ bool SendBroadcast(const uint8_t *data, size_t len)
    return result == ESP_OK;
 }
 
-bool IsKnownSeq(uint16_t seq)
+bool IsKnownSeq(uint8_t source, uint16_t seq)
 {
-   size_t count = seqBufferFull ? kIdempotencyBufferSize : seqBufferIndex;
-
-   for (size_t i = 0; i < count; i++)
-   {
-      if (seqBuffer[i] == seq)
-      {
-         return true;
-      }
-   }
-
-   return false;
+   return seqWindows[source % Source::kCount].IsKnown(seq, millis());
 }
 
-void AddKnownSeq(uint16_t seq)
+void AddKnownSeq(uint8_t source, uint16_t seq)
 {
-   seqBuffer[seqBufferIndex] = seq;
-   seqBufferIndex = (seqBufferIndex + 1) % kIdempotencyBufferSize;
-
-   if (seqBufferIndex == 0)
-   {
-      seqBufferFull = true;
-   }
+   seqWindows[source % Source::kCount].Add(seq, millis());
 }
 
 void ClearKnownSeqs()
 {
-   seqBufferIndex = 0;
-   seqBufferFull = false;
+   for (size_t i = 0; i < Source::kCount; i++)
+   {
+      seqWindows[i].Clear();
+   }
 }
 
 Command *GetPendingCommand()
@@ -326,6 +928,46 @@ void ClearPendingCommand()
    pendingCommand.effect = Cmd::kNop;
 }
 
+RxStats GetRxStats()
+{
+   RxStats stats;
+   stats.queued = rxQueue.Size();
+   stats.highWater = rxHighWater;
+   stats.overflows = rxOverflows;
+   return stats;
+}
+
+MeshStats GetMeshStats()
+{
+   MeshStats stats;
+   stats.sent = rebroadcastsSent;
+   stats.suppressed = rebroadcastsSuppressed;
+   stats.dropped = rebroadcastsDropped;
+   return stats;
+}
+
+StressStats GetStressStats()
+{
+   StressStats stats = stress;
+   if (stats.received > 0)
+   {
+      uint32_t span = static_cast<uint16_t>(stressNewestSeq - stressFirstSeq) + 1;
+      stats.missing = span > stats.received ? span - stats.received : 0;
+      stats.avgProcessingUs = static_cast<uint32_t>(stressProcessingSumUs / stats.received);
+   }
+   return stats;
+}
+
+uint16_t GetLastHubSeq()
+{
+   return lastHubSeq;
+}
+
+int8_t GetLastRssi()
+{
+   return lastRssi;
+}
+
 uint32_t GetLastHeartbeatTime()
 {
    return lastHeartbeat;
@@ -4,99 +4,180 @@
 #include <math.h>
 
 #include "constants.h"
+#include "effect_table.h"
+#include "effect_kernels.h"
+#include "fast_math.h"
 #include "logging.h"
-
-Adafruit_NeoPixel *strip = nullptr;
-uint16_t numLeds = 0;
+#include "net_time.h"
+#include "spsc_queue.h"
 
 namespace
 {
-	bool initialized = false;
-	Command activeCmd;
-	uint32_t step = 0;
-	uint32_t lastUpdate = 0;
+	enum class RenderMode : uint8_t
+	{
+		kOff,
+		kEffect,
+		kEmergency,
+		kStandby,
+		kUnconfigured,
+		kPairing,
+		kDimWhite
+	};
+
+	// State-machine side
+	SpscQueue<Command, kRenderQueueSize> renderQueue;
+	// segmentTable is written by the state machine and read by the render task
+	portMUX_TYPE segmentTableMux = portMUX_INITIALIZER_UNLOCKED;
+	TaskHandle_t renderTaskHandle = nullptr;
+	uint8_t lastModeCmd = Cmd::kNop;
+
+	// Render task side - only touched from RenderTask() after startup
+	PixelOutput *strip = nullptr;
+	uint16_t numLeds = 0;
+
+	// Per layer, for effects that keep state between frames (see effects.json)
+	constexpr size_t kEffectStateSize = 16;
+
+	struct EffectDescriptor;
+
+	/**
+	 * @brief One effect with its own clock, blended onto the layers below it
+	 */
+	struct Layer
+	{
+		bool active;
+		uint8_t blend; // BlendMode
+		uint8_t opacity;
+		Command cmd;
+		const EffectDescriptor *effect; // nullptr for unknown effect IDs
+		alignas(uint32_t) uint8_t state[kEffectStateSize];
+		uint32_t effectStart;
+		uint32_t step; // whole animation steps since effectStart
+		bool forceRedraw;
+		bool fading; // crossfading from the transition buffer over cmd.duration
+	};
+
+	/**
+	 * @brief Part of the strip with its own stack of layers
+	 */
+	struct Segment
+	{
+		uint16_t start;
+		uint16_t length; // 0 = unused
+		uint8_t flags;   // SegmentFlag bits
+		Layer layers[kMaxLayers];
+	};
+
+	RenderMode mode = RenderMode::kOff;
+	Segment segments[kMaxSegments] = {};
+	bool forceRedraw = false; // all segments
+
+	// One RGB buffer per layer over the whole strip, each segment draws into
+	// its own part. Effects that fade their last frame read it back from here.
+	uint8_t *layerBuffers[kMaxLayers] = {};
+	// Last frame of the outgoing effect per layer, faded out while the new one fades in
+	uint8_t *transitionBuffers[kMaxLayers] = {};
+	uint32_t nextFrame = 0;
 
 	bool identifyActive = false;
-	uint32_t identifyEnd = 0;
+	uint32_t identifyStart = 0;
+	uint32_t identifyDuration = 0;
 
-	bool emergencyActive = false;
+	bool feedbackActive = false;
+	bool feedbackOn = false;
+	uint32_t feedbackColor = 0;
+	uint16_t feedbackOnMs = 0;
+	uint16_t feedbackOffMs = 0;
+	uint8_t feedbackRemaining = 0;
+	uint32_t feedbackPhaseStart = 0;
 
 	bool heartbeatFlashActive = false;
-	uint32_t heartbeatFlashEnd = 0;
+	uint32_t heartbeatFlashStart = 0;
 	constexpr uint32_t kHeartbeatFlashDuration = 80;
 
 	bool standbyNeedsInit = true;
 
-	const char *GetEffectName(uint8_t effect)
+	// Written by the render task, read from the state machine for debug output
+	volatile RenderStats renderStats = {};
+
+	/**
+	 * @brief Queue a command for the render task and wake it up
+	 * @return false if the queue was full and the command was dropped
+	 */
+	bool PostRenderCommand(const Command &cmd)
 	{
-		switch (effect)
-		{
-		case Cmd::kEffectSolid:
-			return "Solid";
-		case Cmd::kEffectBlink:
-			return "Blink";
-		case Cmd::kEffectRainbow:
-			return "Rainbow";
-		case Cmd::kEffectRainbowCycle:
-			return "Rainbow Cycle";
-		case Cmd::kEffectChase:
-			return "Chase";
-		case Cmd::kEffectTheaterChase:
-			return "Theater Chase";
-		case Cmd::kEffectTwinkle:
-			return "Twinkle";
-		case Cmd::kEffectFire:
-			return "Fire";
-		case Cmd::kEffectPulse:
-			return "Pulse";
-		case Cmd::kEffectGradient:
-			return "Gradient";
-		case Cmd::kEffectWave:
-			return "Wave";
-		case Cmd::kEffectMeteor:
-			return "Meteor";
-		case Cmd::kEffectDna:
-			return "DNA Helix";
-		case Cmd::kEffectBounce:
-			return "Bounce";
-		case Cmd::kEffectColorWipe:
-			return "Color Wipe";
-		case Cmd::kEffectScanner:
-			return "Scanner";
-		case Cmd::kEffectConfetti:
-			return "Confetti";
-		case Cmd::kEffectLightning:
-			return "Lightning";
-		case Cmd::kEffectPolice:
-			return "Police";
-		case Cmd::kEffectStacking:
-			return "Stacking";
-		case Cmd::kEffectMarquee:
-			return "Marquee";
-		case Cmd::kEffectRipple:
-			return "Ripple";
-		case Cmd::kEffectPlasma:
-			return "Plasma";
-		default:
-			return "Unknown";
+		if (!renderQueue.Push(cmd))
+		{
+			LOGF("Render queue full, dropped fx=0x%02X\n", cmd.effect);
+			return false;
 		}
+
+		if (renderTaskHandle != nullptr)
+		{
+			xTaskNotifyGive(renderTaskHandle);
+		}
+		return true;
+	}
+
+	bool PostRenderCommand(uint8_t effect)
+	{
+		Command cmd = {};
+		cmd.effect = effect;
+		return PostRenderCommand(cmd);
+	}
+
+	/**
+	 * @brief Queue a mode change, skipping it if that mode is already requested
+	 * Lets the state handlers call Show*() every loop without flooding the queue.
+	 * A dropped command is not remembered, so the next call tries again.
+	 */
+	void PostModeCommand(uint8_t effect)
+	{
+		if (effect == lastModeCmd)
+			return;
+		if (PostRenderCommand(effect))
+			lastModeCmd = effect;
+	}
+
+	void PostFeedback(uint8_t r, uint8_t g, uint8_t b, uint16_t onMs, uint16_t offMs, uint8_t count)
+	{
+		Command cmd = {};
+		cmd.effect = RenderCmd::kFeedback;
+		cmd.r = r;
+		cmd.g = g;
+		cmd.b = b;
+		cmd.speed = onMs;
+		cmd.duration = offMs;
+		cmd.length = count;
+		PostRenderCommand(cmd);
 	}
 }
 
+RenderStats GetRenderStats()
+{
+	RenderStats stats;
+	stats.effect = renderStats.effect;
+	stats.numLeds = numLeds;
+	stats.lastFrameCycles = renderStats.lastFrameCycles;
+	stats.maxFrameCycles = renderStats.maxFrameCycles;
+	stats.frames = renderStats.frames;
+	return stats;
+}
+
 uint32_t WheelColor(uint8_t pos)
 {
 	pos = 255 - pos;
 	if (pos < 85)
 	{
-		return strip->Color(255 - pos * 3, 0, pos * 3);
+		return PixelOutput::Color(255 - pos * 3, 0, pos * 3);
 	}
 	if (pos < 170)
 	{
 		pos -= 85;
-		return strip->Color(0, pos * 3, 255 - pos * 3);
+		return PixelOutput::Color(0, pos * 3, 255 - pos * 3);
 	}
 	pos -= 170;
-	return strip->Color(pos * 3, 255 - pos * 3, 0);
+	return PixelOutput::Color(pos * 3, 255 - pos * 3, 0);
 }
 
 uint32_t ApplyIntensity(uint32_t color, uint8_t intensity)
@@ -104,464 +185,490 @@ uint32_t ApplyIntensity(uint32_t color, uint8_t intensity)
 	uint8_t r = ((color >> 16) & 0xFF) * intensity / 255;
 	uint8_t g = ((color >> 8) & 0xFF) * intensity / 255;
 	uint8_t b = (color & 0xFF) * intensity / 255;
-	return strip->Color(r, g, b);
+	return PixelOutput::Color(r, g, b);
 }
 
-void InitializeLeds()
+namespace
 {
-	LOG("Initializing LEDs");
-
-	numLeds = config.ledCount;
-	LOGF("LED count: %u on pin %u\n", numLeds, config.ledPin);
-
-	if (strip != nullptr)
+	/**
+	 * @brief Take the segment table from config, clipped to the strip
+	 * Without a table the whole strip is one segment. All effects stop.
+	 */
+	void LoadSegmentLayout()
 	{
-		delete strip;
-	}
-
-	strip = new Adafruit_NeoPixel(numLeds, config.ledPin, kLedType);
-	strip->begin();
-	strip->clear();
-	strip->show();
+		SegmentConfig table[kMaxSegments];
+		portENTER_CRITICAL(&segmentTableMux);
+		memcpy(table, segmentTable, sizeof(table));
+		portEXIT_CRITICAL(&segmentTableMux);
 
-	initialized = true;
-	step = 0;
-	lastUpdate = millis();
-	activeCmd.effect = Cmd::kNop;
-}
-
-void SetLedColor(uint8_t r, uint8_t g, uint8_t b)
-{
-	if (!initialized)
-		return;
-
-	uint32_t color = strip->Color(r, g, b);
-	strip->fill(color, 0, numLeds);
-	strip->show();
-}
+		bool any = false;
+		for (size_t i = 0; i < kMaxSegments; i++)
+		{
+			const SegmentConfig &entry = table[i];
+			Segment &seg = segments[i];
+			seg = Segment();
 
-void TurnOffLeds()
-{
-	if (!initialized)
-		return;
-	strip->clear();
-	strip->show();
-	standbyNeedsInit = true;
-}
+			for (size_t l = 0; l < kMaxLayers; l++)
+			{
+				seg.layers[l].blend = l == 0 ? BlendMode::kAlpha : BlendMode::kMax;
+				seg.layers[l].opacity = 255;
+			}
 
-void TurnOffLedsImmediate()
-{
-	TurnOffLeds();
-}
+			if (entry.start < numLeds)
+			{
+				seg.start = entry.start;
+				seg.length = min<uint16_t>(entry.length, numLeds - entry.start);
+				seg.flags = entry.flags;
+			}
+			any = any || seg.length > 0;
+		}
 
-void SetLedCount(uint8_t count)
-{
-	config.ledCount = count;
-	SaveConfig();
+		if (!any)
+			segments[0].length = numLeds;
 
-	SetLedColor(255, 0, 0);
-	delay(500);
-	TurnOffLeds();
+		for (size_t l = 0; l < kMaxLayers; l++)
+		{
+			if (layerBuffers[l] != nullptr)
+				memset(layerBuffers[l], 0, numLeds * 3);
+			if (transitionBuffers[l] != nullptr)
+				memset(transitionBuffers[l], 0, numLeds * 3);
+		}
+	}
 
-	InitializeLeds();
-	LOGF("LED count set to %u\n", count);
-}
+	void CreateStrip()
+	{
+		numLeds = config.ledCount;
+		LOGF("LED count: %u on pin %u\n", numLeds, config.ledPin);
 
-void SetLedEffect(const Command &cmd)
-{
-	if (!initialized)
-		return;
+		if (strip != nullptr)
+		{
+			delete strip;
+		}
 
-	LOGF("Effect: %s | RGB(%u,%u,%u) | Brightness: %u%% | Speed: %u | Duration: %u | Length: %u | Rainbow: %u\n",
-		  GetEffectName(cmd.effect), cmd.r, cmd.g, cmd.b, (cmd.intensity * 100) / 255, cmd.speed, cmd.duration, cmd.length, cmd.rainbow);
+		strip = new PixelOutput(numLeds, config.ledPin);
+		for (size_t l = 0; l < kMaxLayers; l++)
+		{
+			delete[] layerBuffers[l];
+			delete[] transitionBuffers[l];
+			layerBuffers[l] = new uint8_t[numLeds * 3]();
+			transitionBuffers[l] = new uint8_t[numLeds * 3]();
+		}
+		if (!strip->Begin())
+		{
+			LOG("Pixel output init failed");
+		}
 
-	step = 0;
-	lastUpdate = millis();
+		LoadSegmentLayout();
+		standbyNeedsInit = true;
+	}
 
-	activeCmd = cmd;
-	identifyActive = false;
-	emergencyActive = false;
-	standbyNeedsInit = true;
+	void SetLedColor(uint8_t r, uint8_t g, uint8_t b)
+	{
+		uint32_t color = PixelOutput::Color(r, g, b);
+		strip->Fill(color, 0, numLeds);
+		strip->Show();
+	}
 
-	if (cmd.effect == Cmd::kEffectSolid)
+	void ClearLeds()
 	{
-		uint32_t color = strip->Color(cmd.r, cmd.g, cmd.b);
-		color = ApplyIntensity(color, cmd.intensity);
-		strip->fill(color, 0, numLeds);
-		strip->show();
+		strip->Clear();
+		strip->Show();
+		standbyNeedsInit = true;
 	}
-}
 
-void UpdateLedEffect()
-{
-	if (!initialized)
-		return;
+	bool IsTargetSegment(const Command &cmd, size_t index)
+	{
+		return segments[index].length > 0 && (cmd.segment == kSegmentAll || cmd.segment == index + 1);
+	}
 
-	if (identifyActive)
+	/**
+	 * @brief Maps effect pixel indices onto one segment of a layer buffer
+	 * Reverse runs the effect from the segment's last LED, mirror draws it on
+	 * the first half and copies every pixel onto the second.
+	 */
+	class SegmentView
 	{
-		if (millis() >= identifyEnd)
+	public:
+		SegmentView(uint8_t *buffer, const Segment &seg)
+			 : buffer(buffer), start(seg.start), length(seg.length), flags(seg.flags)
 		{
-			identifyActive = false;
-			TurnOffLeds();
-			return;
 		}
-		bool on = ((millis() / 200) % 2) == 0;
-		if (on)
+
+		uint16_t NumPixels() const
 		{
-			SetLedColor(255, 255, 255);
+			return (flags & SegmentFlag::kMirror) ? (length + 1) / 2 : length;
 		}
-		else
+
+		void SetPixelColor(uint16_t index, uint32_t color)
 		{
-			TurnOffLeds();
+			if (index >= NumPixels())
+				return;
+
+			Store(Map(index), color);
+			if (flags & SegmentFlag::kMirror)
+				Store(Map(length - 1 - index), color);
 		}
-		return;
-	}
 
-	if (emergencyActive)
-	{
-		bool on = ((millis() / 100) % 2) == 0;
-		if (on)
+		uint32_t GetPixelColor(uint16_t index) const
 		{
-			SetLedColor(255, 0, 0);
+			if (index >= NumPixels())
+				return 0;
+
+			const uint8_t *p = &buffer[Map(index) * 3];
+			return PixelOutput::Color(p[0], p[1], p[2]);
 		}
-		else
+
+		void Fill(uint32_t color, uint16_t first, uint16_t count)
 		{
-			TurnOffLeds();
+			uint16_t end = (count == 0 || first + count > NumPixels()) ? NumPixels() : first + count;
+			for (uint16_t i = first; i < end; i++)
+			{
+				SetPixelColor(i, color);
+			}
 		}
-		return;
-	}
 
-	uint32_t now = millis();
-	uint16_t speed = activeCmd.speed > 0 ? activeCmd.speed : 50;
+		void Clear()
+		{
+			Fill(0, 0, 0);
+		}
 
-	if (now - lastUpdate < speed)
-		return;
-	lastUpdate = now;
-	step++;
+	private:
+		uint16_t Map(uint16_t index) const
+		{
+			return start + ((flags & SegmentFlag::kReverse) ? length - 1 - index : index);
+		}
+
+		void Store(uint16_t pixel, uint32_t color)
+		{
+			uint8_t *p = &buffer[pixel * 3];
+			p[0] = (color >> 16) & 0xFF;
+			p[1] = (color >> 8) & 0xFF;
+			p[2] = color & 0xFF;
+		}
+
+		uint8_t *buffer;
+		uint16_t start;
+		uint16_t length;
+		uint8_t flags;
+	};
+
+	/**
+	 * @brief Everything an effect needs to draw one frame
+	 */
+	struct EffectFrame
+	{
+		const Command &cmd;
+		uint16_t pixels;
+		uint8_t length; // cmd.length or the effect's default
+		uint32_t step;
+		uint32_t stepFixed; // step in 8.8 fixed point, wraps
+		uint8_t *state;     // zeroed when the effect starts
+	};
+
+	enum class EffectRedraw : uint8_t
+	{
+		kStatic, // only when forced
+		kStep,   // when the step advances
+		kSmooth  // every frame
+	};
+
+	using DrawFunction = void (*)(const EffectFrame &f, SegmentView &out);
 
-	switch (activeCmd.effect)
+	struct EffectDescriptor
 	{
-	case Cmd::kEffectSolid:
-		break;
+		uint8_t id;
+		const char *name;
+		uint16_t speed; // ms per step if the command has none
+		uint8_t length; // if the command has none
+		EffectRedraw redraw;
+		DrawFunction draw;
+		size_t stateSize;
+	};
+
+	void DrawSolid(const EffectFrame &f, SegmentView &out)
+	{
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+		color = ApplyIntensity(color, f.cmd.intensity);
+		out.Fill(color, 0, f.pixels);
+	}
 
-	case Cmd::kEffectBlink:
+	void DrawBlink(const EffectFrame &f, SegmentView &out)
 	{
-		bool on = (step % 2) == 0;
+		bool on = (f.step % 2) == 0;
 		if (on)
 		{
-			uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-			color = ApplyIntensity(color, activeCmd.intensity);
-			strip->fill(color, 0, numLeds);
+			uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+			color = ApplyIntensity(color, f.cmd.intensity);
+			out.Fill(color, 0, f.pixels);
 		}
 		else
 		{
-			strip->clear();
+			out.Clear();
 		}
-		strip->show();
-		break;
 	}
 
-
-	case Cmd::kEffectRainbow:
+	void DrawRainbow(const EffectFrame &f, SegmentView &out)
 	{
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			uint32_t color = WheelColor(((i * 256 / numLeds) + step) & 255);
-			color = ApplyIntensity(color, activeCmd.intensity);
-			strip->setPixelColor(i, color);
+			uint32_t color = WheelColor(((i * 256 / f.pixels) + f.step) & 255);
+			color = ApplyIntensity(color, f.cmd.intensity);
+			out.SetPixelColor(i, color);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectRainbowCycle:
+	void DrawRainbowCycle(const EffectFrame &f, SegmentView &out)
 	{
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			uint32_t color = WheelColor((step + i) & 255);
-			color = ApplyIntensity(color, activeCmd.intensity);
-			strip->setPixelColor(i, color);
+			uint32_t color = WheelColor((f.step + i) & 255);
+			color = ApplyIntensity(color, f.cmd.intensity);
+			out.SetPixelColor(i, color);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectChase:
+	void DrawChase(const EffectFrame &f, SegmentView &out)
 	{
-		strip->clear();
-		uint8_t len = activeCmd.length > 0 ? activeCmd.length : 3;
-		uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-		color = ApplyIntensity(color, activeCmd.intensity);
+		out.Clear();
+		uint8_t len = f.length;
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+		color = ApplyIntensity(color, f.cmd.intensity);
 
 		for (uint8_t j = 0; j < len; j++)
 		{
-			int pos = (step + j) % numLeds;
-			strip->setPixelColor(pos, color);
+			int pos = (f.step + j) % f.pixels;
+			out.SetPixelColor(pos, color);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectTheaterChase:
+	void DrawTheaterChase(const EffectFrame &f, SegmentView &out)
 	{
-		strip->clear();
-		uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-		color = ApplyIntensity(color, activeCmd.intensity);
+		out.Clear();
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+		color = ApplyIntensity(color, f.cmd.intensity);
 
-		for (uint16_t i = 0; i < numLeds; i += 3)
+		for (uint16_t i = 0; i < f.pixels; i += 3)
 		{
-			int pos = i + (step % 3);
-			if (pos < numLeds)
+			int pos = i + (f.step % 3);
+			if (pos < f.pixels)
 			{
-				strip->setPixelColor(pos, color);
+				out.SetPixelColor(pos, color);
 			}
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectTwinkle:
+	void DrawTwinkle(const EffectFrame &f, SegmentView &out)
 	{
-		uint8_t probability = activeCmd.length > 0 ? activeCmd.length : 10;
-		for (uint16_t i = 0; i < numLeds; i++)
+		uint8_t probability = f.length;
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
 			if (random(100) < probability)
 			{
 				float randInt = 0.6f + (random(40) / 100.0f);
-				uint8_t intensity = activeCmd.intensity * randInt;
-				uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
+				uint8_t intensity = f.cmd.intensity * randInt;
+				uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
 				color = ApplyIntensity(color, intensity);
-				strip->setPixelColor(i, color);
+				out.SetPixelColor(i, color);
 			}
 			else
 			{
-				strip->setPixelColor(i, 0);
+				out.SetPixelColor(i, 0);
 			}
 		}
-		strip->show();
-		break;
 	}
 
-
-	case Cmd::kEffectFire:
+	void DrawFire(const EffectFrame &f, SegmentView &out)
 	{
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
 			uint8_t flickerBrightness = random(40, 100);
-			uint8_t pixelIntensity = (activeCmd.intensity * flickerBrightness) / 100;
-			uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
+			uint8_t pixelIntensity = (f.cmd.intensity * flickerBrightness) / 100;
+			uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
 			color = ApplyIntensity(color, pixelIntensity);
-			strip->setPixelColor(i, color);
+			out.SetPixelColor(i, color);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectPulse:
+	void DrawPulse(const EffectFrame &f, SegmentView &out)
 	{
-		float phase = ((float)step / 12.75f) * 2.0f * PI;
-		float minBrightness = (activeCmd.length > 0 ? activeCmd.length / 100.0f : 0.4f);
-		float pulse = minBrightness + (1.0f - minBrightness) * ((sin(phase) + 1.0f) / 2.0f);
-		uint8_t intensity = pulse * activeCmd.intensity;
-		uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
+		// One breath every 12.75 steps
+		uint16_t phase = (f.stepFixed * PhaseIncrement(1275)) >> 8;
+		uint8_t minBrightness = min<uint16_t>(f.length, 100) * 255 / 100;
+		uint8_t pulse = minBrightness + Scale8(255 - minBrightness, Sin8Phase(phase));
+		uint8_t intensity = Scale8(f.cmd.intensity, pulse);
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
 		color = ApplyIntensity(color, intensity);
-		strip->fill(color, 0, numLeds);
-		strip->show();
-		break;
+		out.Fill(color, 0, f.pixels);
 	}
 
-
-	case Cmd::kEffectGradient:
+	void DrawGradient(const EffectFrame &f, SegmentView &out)
 	{
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			float ratio = (float)i / (float)numLeds;
+			float ratio = (float)i / (float)f.pixels;
 			uint8_t r, g, b;
 
-			if (activeCmd.rainbow)
+			if (f.cmd.rainbow)
 			{
-				uint32_t endColor = WheelColor((step + 128) & 255);
+				uint32_t endColor = WheelColor((f.step + 128) & 255);
 				uint8_t er = (endColor >> 16) & 0xFF;
 				uint8_t eg = (endColor >> 8) & 0xFF;
 				uint8_t eb = endColor & 0xFF;
-				r = activeCmd.r + ratio * (er - activeCmd.r);
-				g = activeCmd.g + ratio * (eg - activeCmd.g);
-				b = activeCmd.b + ratio * (eb - activeCmd.b);
+				r = f.cmd.r + ratio * (er - f.cmd.r);
+				g = f.cmd.g + ratio * (eg - f.cmd.g);
+				b = f.cmd.b + ratio * (eb - f.cmd.b);
 			}
 			else
 			{
-				r = activeCmd.r * (1.0f - ratio);
-				g = activeCmd.g * (1.0f - ratio);
-				b = activeCmd.b * (1.0f - ratio);
+				r = f.cmd.r * (1.0f - ratio);
+				g = f.cmd.g * (1.0f - ratio);
+				b = f.cmd.b * (1.0f - ratio);
 			}
 
-			uint32_t color = strip->Color(r, g, b);
-			color = ApplyIntensity(color, activeCmd.intensity);
-			strip->setPixelColor(i, color);
+			uint32_t color = PixelOutput::Color(r, g, b);
+			color = ApplyIntensity(color, f.cmd.intensity);
+			out.SetPixelColor(i, color);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectWave:
+	void DrawWave(const EffectFrame &f, SegmentView &out)
 	{
-		uint8_t len = activeCmd.length > 0 ? activeCmd.length : 10;
-		for (uint16_t i = 0; i < numLeds; i++)
+		WaveKernel wave(f.stepFixed, f.length);
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			float wave = sin(2.0f * PI * ((float)i / len + (float)step / 20.0f));
-			float brightness = (wave + 1.0f) / 2.0f;
-			uint8_t intensity = brightness * activeCmd.intensity;
-			uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-			color = ApplyIntensity(color, intensity);
-			strip->setPixelColor(i, color);
+			uint8_t intensity = Scale8(f.cmd.intensity, wave.Next());
+			out.SetPixelColor(i, ApplyIntensity(color, intensity));
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectMeteor:
+	void DrawMeteor(const EffectFrame &f, SegmentView &out)
 	{
-		strip->clear();
-		uint8_t meteorLength = activeCmd.length > 0 ? activeCmd.length : 4;
+		out.Clear();
+		uint8_t meteorLength = f.length;
 		uint8_t gapLength = meteorLength;
-		float fadeRate = 0.8f;
 
-		for (uint16_t j = 0; j < numLeds; j += (meteorLength + gapLength))
+		for (uint16_t j = 0; j < f.pixels; j += (meteorLength + gapLength))
 		{
 			for (uint8_t i = 0; i < meteorLength; i++)
 			{
-				int pos = (step - i + j + numLeds) % numLeds;
-				float fade = pow(fadeRate, i);
-				uint8_t intensity = activeCmd.intensity * fade;
-				uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
+				uint8_t intensity = Scale8(f.cmd.intensity, MeteorTrail(i));
+				uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
 				color = ApplyIntensity(color, intensity);
-				strip->setPixelColor(pos, color);
+				out.SetPixelColor(MeteorPixel(f.step, j, i, f.pixels), color);
 			}
 		}
 
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
 			if (random(10) == 0)
 			{
-				uint32_t curCol = strip->getPixelColor(i);
-				uint8_t r = ((curCol >> 16) & 0xFF) * 0.7f;
-				uint8_t g = ((curCol >> 8) & 0xFF) * 0.7f;
-				uint8_t b = (curCol & 0xFF) * 0.7f;
-				strip->setPixelColor(i, strip->Color(r, g, b));
+				uint32_t curCol = out.GetPixelColor(i);
+				uint8_t r = Scale8((curCol >> 16) & 0xFF, 178);
+				uint8_t g = Scale8((curCol >> 8) & 0xFF, 178);
+				uint8_t b = Scale8(curCol & 0xFF, 178);
+				out.SetPixelColor(i, PixelOutput::Color(r, g, b));
 			}
 		}
-		strip->show();
-		break;
 	}
 
-
-	case Cmd::kEffectDna:
+	void DrawDna(const EffectFrame &f, SegmentView &out)
 	{
-		uint8_t waveLen = activeCmd.length > 0 ? activeCmd.length : 10;
-		for (uint16_t i = 0; i < numLeds; i++)
+		WaveKernel wave(f.stepFixed, f.length);
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			float phase = 2.0f * PI * ((float)i / waveLen + (float)step / 20.0f);
-			float mix = (sin(phase) + 1.0f) / 2.0f;
+			uint8_t white = 255 - wave.Next();
 
-			uint8_t r = activeCmd.r + (uint8_t)((255 - activeCmd.r) * (1.0f - mix));
-			uint8_t g = activeCmd.g + (uint8_t)((255 - activeCmd.g) * (1.0f - mix));
-			uint8_t b = activeCmd.b + (uint8_t)((255 - activeCmd.b) * (1.0f - mix));
+			uint8_t r = f.cmd.r + Scale8(255 - f.cmd.r, white);
+			uint8_t g = f.cmd.g + Scale8(255 - f.cmd.g, white);
+			uint8_t b = f.cmd.b + Scale8(255 - f.cmd.b, white);
 
-			uint32_t color = strip->Color(r, g, b);
-			color = ApplyIntensity(color, activeCmd.intensity);
-			strip->setPixelColor(i, color);
+			uint32_t color = PixelOutput::Color(r, g, b);
+			color = ApplyIntensity(color, f.cmd.intensity);
+			out.SetPixelColor(i, color);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectBounce:
+	void DrawBounce(const EffectFrame &f, SegmentView &out)
 	{
-		strip->clear();
-		uint8_t len = activeCmd.length > 0 ? activeCmd.length : 3;
-		uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-		color = ApplyIntensity(color, activeCmd.intensity);
+		out.Clear();
+		uint8_t len = f.length;
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+		color = ApplyIntensity(color, f.cmd.intensity);
 
-		uint16_t maxPos = (numLeds > len) ? (numLeds - len) : 0;
+		uint16_t maxPos = (f.pixels > len) ? (f.pixels - len) : 0;
 		uint16_t bouncePos = 0;
 		if (maxPos > 0)
 		{
 			uint16_t cycleLen = maxPos * 2;
-			uint16_t phase = step % cycleLen;
+			uint16_t phase = f.step % cycleLen;
 			bouncePos = (phase <= maxPos) ? phase : cycleLen - phase;
 		}
 
-		for (uint8_t j = 0; j < len && (bouncePos + j) < numLeds; j++)
+		for (uint8_t j = 0; j < len && (bouncePos + j) < f.pixels; j++)
 		{
-			strip->setPixelColor(bouncePos + j, color);
+			out.SetPixelColor(bouncePos + j, color);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectColorWipe:
+	void DrawColorWipe(const EffectFrame &f, SegmentView &out)
 	{
-		if (numLeds == 0)
-			break;
-		uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-		color = ApplyIntensity(color, activeCmd.intensity);
+		if (f.pixels == 0)
+			return;
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+		color = ApplyIntensity(color, f.cmd.intensity);
 
-		uint16_t cycleLen = numLeds * 2;
-		uint16_t phase = step % cycleLen;
+		// Wipe on during the first pixels steps, wipe off during the next
+		uint16_t cycleLen = f.pixels * 2;
+		uint16_t phase = f.step % cycleLen;
+		bool wipingOn = phase < f.pixels;
+		uint16_t edge = wipingOn ? phase : phase - f.pixels;
 
-		if (phase < numLeds)
-		{
-			strip->setPixelColor(phase, color);
-		}
-		else
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			strip->setPixelColor(phase - numLeds, 0);
+			bool lit = (i <= edge) == wipingOn;
+			out.SetPixelColor(i, lit ? color : 0);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectScanner:
+	void DrawScanner(const EffectFrame &f, SegmentView &out)
 	{
-		if (numLeds < 2)
-			break;
-		strip->clear();
-		uint8_t trailLen = activeCmd.length > 0 ? activeCmd.length : 5;
-		uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
+		if (f.pixels < 2)
+			return;
+		out.Clear();
+		uint8_t trailLen = f.length;
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
 
-		uint16_t maxPos = numLeds - 1;
+		uint16_t maxPos = f.pixels - 1;
 		uint16_t pos = 0;
 		if (maxPos > 0)
 		{
 			uint16_t cycleLen = maxPos * 2;
-			uint16_t phase = step % cycleLen;
+			uint16_t phase = f.step % cycleLen;
 			pos = (phase <= maxPos) ? phase : cycleLen - phase;
 		}
 
-		strip->setPixelColor(pos, ApplyIntensity(color, activeCmd.intensity));
+		out.SetPixelColor(pos, ApplyIntensity(color, f.cmd.intensity));
 
 		for (uint8_t i = 1; i <= trailLen; i++)
 		{
-			float fade = pow(0.6f, (float)i);
-			uint8_t trailIntensity = activeCmd.intensity * fade;
+			uint8_t trailIntensity = Scale8(f.cmd.intensity, FadeCurve(kFadeCurve60, i));
 			uint32_t trailColor = ApplyIntensity(color, trailIntensity);
 
 			int leftPos = (int)pos - i;
 			int rightPos = (int)pos + i;
 			if (leftPos >= 0)
-				strip->setPixelColor(leftPos, trailColor);
-			if (rightPos < numLeds)
-				strip->setPixelColor(rightPos, trailColor);
+				out.SetPixelColor(leftPos, trailColor);
+			if (rightPos < f.pixels)
+				out.SetPixelColor(rightPos, trailColor);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectConfetti:
+	void DrawConfetti(const EffectFrame &f, SegmentView &out)
 	{
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			uint32_t curColor = strip->getPixelColor(i);
+			uint32_t curColor = out.GetPixelColor(i);
 			uint8_t r = ((curColor >> 16) & 0xFF);
 			uint8_t g = ((curColor >> 8) & 0xFF);
 			uint8_t b = (curColor & 0xFF);
@@ -569,412 +676,971 @@ void UpdateLedEffect()
 			r = (r > fadeAmt) ? r - fadeAmt : 0;
 			g = (g > fadeAmt) ? g - fadeAmt : 0;
 			b = (b > fadeAmt) ? b - fadeAmt : 0;
-			strip->setPixelColor(i, strip->Color(r, g, b));
+			out.SetPixelColor(i, PixelOutput::Color(r, g, b));
 		}
 
 		uint8_t numNew = 1 + random(2);
 		for (uint8_t n = 0; n < numNew; n++)
 		{
-			uint16_t pos = random(numLeds);
+			uint16_t pos = random(f.pixels);
 			uint32_t randColor = WheelColor(random(256));
-			randColor = ApplyIntensity(randColor, activeCmd.intensity);
-			strip->setPixelColor(pos, randColor);
+			randColor = ApplyIntensity(randColor, f.cmd.intensity);
+			out.SetPixelColor(pos, randColor);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectLightning:
+	void DrawLightning(const EffectFrame &f, SegmentView &out)
 	{
 		// Fade all pixels toward black
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			uint32_t curColor = strip->getPixelColor(i);
+			uint32_t curColor = out.GetPixelColor(i);
 			uint8_t r = ((curColor >> 16) & 0xFF);
 			uint8_t g = ((curColor >> 8) & 0xFF);
 			uint8_t b = (curColor & 0xFF);
 			r = r > 40 ? r - 40 : 0;
 			g = g > 40 ? g - 40 : 0;
 			b = b > 40 ? b - 40 : 0;
-			strip->setPixelColor(i, strip->Color(r, g, b));
+			out.SetPixelColor(i, PixelOutput::Color(r, g, b));
 		}
 
-		uint8_t chance = activeCmd.length > 0 ? activeCmd.length : 8;
+		uint8_t chance = f.length;
 		if (random(100) < chance)
 		{
-			uint16_t flashPos = random(numLeds > 5 ? numLeds - 5 : 0);
+			uint16_t flashPos = random(f.pixels > 5 ? f.pixels - 5 : 0);
 			uint8_t flashLen = 3 + random(5);
-			for (uint8_t i = 0; i < flashLen && (flashPos + i) < numLeds; i++)
+			for (uint8_t i = 0; i < flashLen && (flashPos + i) < f.pixels; i++)
 			{
-				uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-				color = ApplyIntensity(color, activeCmd.intensity);
-				strip->setPixelColor(flashPos + i, color);
+				uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+				color = ApplyIntensity(color, f.cmd.intensity);
+				out.SetPixelColor(flashPos + i, color);
 			}
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectPolice:
+	void DrawPolice(const EffectFrame &f, SegmentView &out)
 	{
-		uint16_t half = numLeds / 2;
-		bool phase = ((step / 3) % 2) == 0;
+		uint16_t half = f.pixels / 2;
+		bool phase = ((f.step / 3) % 2) == 0;
 
-		uint32_t colorA = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-		colorA = ApplyIntensity(colorA, activeCmd.intensity);
-		uint32_t colorB = ApplyIntensity(strip->Color(255, 255, 255), activeCmd.intensity);
+		uint32_t colorA = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+		colorA = ApplyIntensity(colorA, f.cmd.intensity);
+		uint32_t colorB = ApplyIntensity(PixelOutput::Color(255, 255, 255), f.cmd.intensity);
 
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
 			if (i < half)
-				strip->setPixelColor(i, phase ? colorA : 0);
+				out.SetPixelColor(i, phase ? colorA : 0);
 			else
-				strip->setPixelColor(i, phase ? 0 : colorB);
+				out.SetPixelColor(i, phase ? 0 : colorB);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectStacking:
+	void DrawStacking(const EffectFrame &f, SegmentView &out)
 	{
-		static uint16_t stackHeight = 0;
-		static uint16_t dotPos = 0;
+		if (f.pixels == 0)
+			return;
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+		color = ApplyIntensity(color, f.cmd.intensity);
 
-		if (step == 1)
+		// A dot falls from pixel 1 onto the stack, one pixel per step; with
+		// stackHeight pixels stacked, that fall takes landingPos steps
+		uint32_t cycleLen = 0;
+		for (uint16_t h = 0; h < f.pixels; h++)
 		{
-			stackHeight = 0;
-			dotPos = 0;
-			strip->clear();
+			cycleLen += max<uint16_t>(f.pixels - 1 - h, 1);
 		}
 
-		uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-		color = ApplyIntensity(color, activeCmd.intensity);
-
-		// Clear previous dot position
-		if (dotPos < numLeds)
-			strip->setPixelColor(dotPos, 0);
-
-		dotPos++;
-		uint16_t landingPos = numLeds - 1 - stackHeight;
-
-		if (dotPos >= landingPos)
+		uint32_t remaining = f.step % cycleLen;
+		uint16_t stackHeight = 0;
+		uint16_t landingPos = f.pixels - 1;
+		while (remaining >= max<uint16_t>(landingPos, 1))
 		{
-			strip->setPixelColor(landingPos, color);
+			remaining -= max<uint16_t>(landingPos, 1);
 			stackHeight++;
-			dotPos = 0;
-
-			if (stackHeight >= numLeds)
-			{
-				stackHeight = 0;
-				strip->clear();
-			}
-		}
-		else
-		{
-			strip->setPixelColor(dotPos, color);
+			landingPos--;
 		}
-		strip->show();
-		break;
+
+		out.Clear();
+		if (stackHeight > 0)
+			out.Fill(color, landingPos + 1, stackHeight);
+		uint16_t dotPos = remaining + 1;
+		out.SetPixelColor(dotPos >= landingPos ? landingPos : dotPos, color);
 	}
 
-	case Cmd::kEffectMarquee:
+	void DrawMarquee(const EffectFrame &f, SegmentView &out)
 	{
-		uint8_t spacing = activeCmd.length > 0 ? activeCmd.length : 5;
-		uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
-		color = ApplyIntensity(color, activeCmd.intensity);
+		uint8_t spacing = f.length;
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
+		color = ApplyIntensity(color, f.cmd.intensity);
 
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			if ((i + step) % spacing == 0)
-				strip->setPixelColor(i, color);
+			if ((i + f.step) % spacing == 0)
+				out.SetPixelColor(i, color);
 			else
-				strip->setPixelColor(i, 0);
+				out.SetPixelColor(i, 0);
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectRipple:
+	void DrawRipple(const EffectFrame &f, SegmentView &out)
 	{
-		strip->clear();
-		uint16_t center = numLeds / 2;
+		out.Clear();
+		uint16_t center = f.pixels / 2;
 		uint16_t maxRadius = center;
-		uint16_t radius = step % (maxRadius + 5); // +5 for gap between ripples
+		uint16_t radius = f.step % (maxRadius + 5); // +5 for gap between ripples
 
-		uint32_t color = strip->Color(activeCmd.r, activeCmd.g, activeCmd.b);
+		uint32_t color = PixelOutput::Color(f.cmd.r, f.cmd.g, f.cmd.b);
 
 		if (radius <= maxRadius)
 		{
-			uint8_t trailLen = activeCmd.length > 0 ? activeCmd.length : 3;
+			uint8_t trailLen = f.length;
 			for (uint8_t t = 0; t < trailLen; t++)
 			{
 				int r = (int)radius - t;
 				if (r < 0) break;
-				float fade = pow(0.7f, (float)t);
-				uint8_t trailIntensity = activeCmd.intensity * fade;
+				uint8_t trailIntensity = Scale8(f.cmd.intensity, FadeCurve(kFadeCurve70, t));
 				uint32_t trailColor = ApplyIntensity(color, trailIntensity);
 
 				int posLeft = center - r;
 				int posRight = center + r;
-				if (posLeft >= 0 && posLeft < numLeds)
-					strip->setPixelColor(posLeft, trailColor);
-				if (posRight >= 0 && posRight < numLeds && posRight != posLeft)
-					strip->setPixelColor(posRight, trailColor);
+				if (posLeft >= 0 && posLeft < f.pixels)
+					out.SetPixelColor(posLeft, trailColor);
+				if (posRight >= 0 && posRight < f.pixels && posRight != posLeft)
+					out.SetPixelColor(posRight, trailColor);
 			}
 		}
-		strip->show();
-		break;
 	}
 
-	case Cmd::kEffectPlasma:
+	void DrawPlasma(const EffectFrame &f, SegmentView &out)
 	{
-		for (uint16_t i = 0; i < numLeds; i++)
+		PlasmaKernel plasma(f.stepFixed);
+		for (uint16_t i = 0; i < f.pixels; i++)
 		{
-			float v1 = sin((float)i / 3.0f + (float)step / 7.0f);
-			float v2 = sin((float)i / 5.0f - (float)step / 11.0f);
-			float v3 = sin(((float)i + (float)step) / 9.0f);
-			float val = (v1 + v2 + v3 + 3.0f) / 6.0f; // 0.0 - 1.0
+			uint32_t color = WheelColor(plasma.Next());
+			color = ApplyIntensity(color, f.cmd.intensity);
+			out.SetPixelColor(i, color);
+		}
+	}
+
+	// One entry per line of effects.json, see effect_table.h
+#define EFFECT_DESCRIPTOR(key, id, name, speed, length, redraw, stateSize) \
+	{id, name, speed, length, EffectRedraw::redraw, &Draw##key, stateSize},
+
+	constexpr EffectDescriptor kEffects[kEffectCount] = {EFFECT_TABLE(EFFECT_DESCRIPTOR)};
+
+#undef EFFECT_DESCRIPTOR
+
+	constexpr bool IsTableConsistent(size_t i = 0)
+	{
+		return i == kEffectCount ||
+				 (kEffectIndex[kEffects[i].id - kEffectIdFirst] == i && kEffects[i].stateSize <= kEffectStateSize &&
+				  IsTableConsistent(i + 1));
+	}
+	static_assert(IsTableConsistent(), "effect_table.h out of date or effect state too large, run generate_effects.py");
 
-			uint8_t hue = (uint8_t)(val * 255.0f);
-			uint32_t color = WheelColor(hue);
-			color = ApplyIntensity(color, activeCmd.intensity);
-			strip->setPixelColor(i, color);
+	/**
+	 * @brief Descriptor of an effect ID, nullptr if there is no such effect
+	 */
+	const EffectDescriptor *FindEffect(uint8_t id)
+	{
+		uint8_t slot = id - kEffectIdFirst;
+		if (slot >= kEffectSlots || kEffectIndex[slot] >= kEffectCount)
+			return nullptr;
+		return &kEffects[kEffectIndex[slot]];
+	}
+
+	const char *GetEffectName(uint8_t effect)
+	{
+		const EffectDescriptor *descriptor = FindEffect(effect);
+		return descriptor != nullptr ? descriptor->name : "Unknown";
+	}
+
+	/**
+	 * @brief Time since the layer's effect started
+	 * SYNC effects run on network time from the start time the gateway put
+	 * in the frame, so every Nano lands on the same phase.
+	 */
+	uint32_t EffectElapsed(const Layer &layer)
+	{
+		if (HasSyncFlag(layer.cmd) && layer.cmd.syncTime != 0 && IsNetworkTimeSynced())
+		{
+			int32_t elapsed = GetNetworkTimeMs() - layer.cmd.syncTime;
+			return elapsed > 0 ? elapsed : 0;
 		}
-		strip->show();
-		break;
+		return millis() - layer.effectStart;
 	}
 
-	default:
-		break;
+	/**
+	 * @brief How far a layer's crossfade got, 0 shows the old frame and 255 the new effect
+	 * Runs on the effect's own clock, so SYNC effects fade in step on every Nano.
+	 */
+	uint8_t TransitionLevel(const Layer &layer)
+	{
+		uint32_t elapsed = EffectElapsed(layer);
+		return elapsed < layer.cmd.duration ? (elapsed * 255) / layer.cmd.duration : 255;
 	}
-}
 
-void UpdateStandbyAnimation()
-{
-	if (!initialized)
-		return;
+	/**
+	 * @brief Keep a layer's current frame of a segment to crossfade the next effect from
+	 * A crossfade that is still running is baked in at its current level.
+	 */
+	void StartTransition(const Segment &seg, size_t l)
+	{
+		const Layer &layer = seg.layers[l];
+		uint8_t *from = &transitionBuffers[l][seg.start * 3];
+		const uint8_t *live = &layerBuffers[l][seg.start * 3];
+		size_t size = seg.length * 3;
 
-	static uint32_t lastStandbyUpdate = 0;
+		if (layer.active && layer.fading)
+		{
+			uint8_t level = TransitionLevel(layer);
+			for (size_t i = 0; i < size; i++)
+			{
+				from[i] = Blend8(from[i], live[i], level);
+			}
+		}
+		else
+		{
+			memcpy(from, live, size);
+		}
+	}
 
-	constexpr uint32_t kUpdateInterval = 1500;
-	constexpr float kMinBrightness = 0.01f;  // 1%
-	constexpr float kMaxBrightness = 0.04f;  // 4%
-	constexpr float kColorVariation = 0.20f; // 20% color deviation
-	constexpr float kUpdateChanceMin = 0.10f; // 10% of LEDs
-	constexpr float kUpdateChanceMax = 0.20f; // 20% of LEDs
+	/**
+	 * @brief Start an effect on a layer of the segment the command picks, or of all segments
+	 */
+	void StartEffect(const Command &cmd)
+	{
+		if (cmd.segment > kMaxSegments || (cmd.segment != kSegmentAll && segments[cmd.segment - 1].length == 0))
+			return;
 
-	uint32_t now = millis();
+		// Coming from another mode, everything without an effect stays dark
+		if (mode != RenderMode::kEffect)
+		{
+			strip->Clear();
+			for (size_t l = 0; l < kMaxLayers; l++)
+			{
+				memset(layerBuffers[l], 0, numLeds * 3);
+				for (Segment &seg : segments)
+					seg.layers[l].active = false;
+			}
+		}
 
-	// Initialize all LEDs when entering standby animation
-	if (standbyNeedsInit)
+		for (size_t i = 0; i < kMaxSegments; i++)
+		{
+			if (!IsTargetSegment(cmd, i))
+				continue;
+
+			// duration is the crossfade time for effects, 0 switches right away
+			if (cmd.duration > 0)
+				StartTransition(segments[i], cmd.layer);
+
+			Layer &layer = segments[i].layers[cmd.layer];
+			layer.cmd = cmd;
+			layer.effect = FindEffect(cmd.effect);
+			memset(layer.state, 0, sizeof(layer.state));
+			layer.active = true;
+			layer.effectStart = millis();
+			layer.step = 0;
+			layer.forceRedraw = true;
+			layer.fading = cmd.duration > 0;
+		}
+
+		mode = RenderMode::kEffect;
+		renderStats.effect = cmd.effect;
+		renderStats.lastFrameCycles = 0;
+		renderStats.maxFrameCycles = 0;
+		renderStats.frames = 0;
+		identifyActive = false;
+		standbyNeedsInit = true;
+	}
+
+	/**
+	 * @brief Set blend mode and opacity of a layer, the effect keeps running
+	 */
+	void SetLayerMix(const Command &cmd)
 	{
-		for (uint16_t i = 0; i < numLeds; i++)
+		for (size_t i = 0; i < kMaxSegments; i++)
+		{
+			if (!IsTargetSegment(cmd, i))
+				continue;
+
+			Layer &layer = segments[i].layers[cmd.layer];
+			layer.blend = cmd.r <= BlendMode::kMultiply ? cmd.r : BlendMode::kAlpha;
+			layer.opacity = cmd.intensity;
+			layer.forceRedraw = true;
+		}
+	}
+
+	/**
+	 * @brief Draw the next frame of a layer's effect if it is due
+	 * Only draws into the layer buffer, the caller composites and shows the frame.
+	 * @param redrawAll Draw even if the effect did not change
+	 * @returns true if a frame was drawn
+	 */
+	bool RenderEffect(Layer &layer, SegmentView &out, bool redrawAll)
+	{
+		const EffectDescriptor *effect = layer.effect;
+		if (effect == nullptr)
+			return false;
+		const Command &cmd = layer.cmd;
+
+		// speed is the duration of one step, so the frame is a pure function of
+		// (command, elapsed time) no matter how often we get here
+		uint32_t elapsed = EffectElapsed(layer);
+		uint16_t speed = cmd.speed > 0 ? cmd.speed : effect->speed;
+		uint32_t step = elapsed / speed;
+		uint32_t stepFixed = (step << 8) | (((elapsed % speed) << 8) / speed); // 8.8 fixed point, wraps
+
+		bool redraw = redrawAll || layer.forceRedraw;
+		layer.forceRedraw = false;
+		bool stepChanged = redraw || step != layer.step;
+		layer.step = step;
+
+		switch (effect->redraw)
+		{
+		case EffectRedraw::kStatic:
+			if (!redraw)
+				return false;
+			break;
+		case EffectRedraw::kStep:
+			if (!stepChanged)
+				return false;
+			break;
+		case EffectRedraw::kSmooth:
+			break;
+		}
+
+		EffectFrame frame = {cmd, out.NumPixels(), cmd.length > 0 ? cmd.length : effect->length, step, stepFixed, layer.state};
+		effect->draw(frame, out);
+		return true;
+	}
+
+	/**
+	 * @brief Blend one layer pixel onto the pixel composited so far
+	 */
+	void BlendPixel(uint8_t *dst, const uint8_t *src, uint8_t mode, uint8_t opacity)
+	{
+		for (uint8_t c = 0; c < 3; c++)
 		{
-			float brightness = kMinBrightness + (random(100) / 100.0f) * (kMaxBrightness - kMinBrightness);
-			float colorVarR = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
-			float colorVarG = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
-			float colorVarB = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
+			uint8_t top = Scale8(src[c], opacity);
+			switch (mode)
+			{
+			case BlendMode::kAdd:
+				dst[c] = min<uint16_t>(dst[c] + top, 255);
+				break;
+			case BlendMode::kMax:
+				dst[c] = max<uint8_t>(dst[c], top);
+				break;
+			case BlendMode::kMultiply:
+				// Opacity 0 leaves the pixel, 255 multiplies by the layer fully
+				dst[c] = Scale8(dst[c], 255 - Scale8(255 - src[c], opacity));
+				break;
+			default:
+				dst[c] = dst[c] + ((static_cast<int16_t>(src[c]) - dst[c]) * opacity) / 255;
+				break;
+			}
+		}
+	}
 
-			uint8_t r = constrain((int)(config.standbyR * brightness * colorVarR), 0, 255);
-			uint8_t g = constrain((int)(config.standbyG * brightness * colorVarG), 0, 255);
-			uint8_t b = constrain((int)(config.standbyB * brightness * colorVarB), 0, 255);
+	/**
+	 * @brief Combine the layers of a segment into the strip's back buffer
+	 * @param levels Crossfade level per layer, 255 = no crossfade
+	 */
+	void CompositeSegment(const Segment &seg, const uint8_t *levels)
+	{
+		for (uint16_t p = seg.start; p < seg.start + seg.length; p++)
+		{
+			uint8_t rgb[3] = {0, 0, 0};
+			for (size_t l = 0; l < kMaxLayers; l++)
+			{
+				const Layer &layer = seg.layers[l];
+				if (!layer.active || layer.opacity == 0)
+					continue;
+
+				const uint8_t *src = &layerBuffers[l][p * 3];
+				uint8_t mixed[3];
+				if (levels[l] < 255)
+				{
+					const uint8_t *from = &transitionBuffers[l][p * 3];
+					for (uint8_t c = 0; c < 3; c++)
+					{
+						mixed[c] = Blend8(from[c], src[c], levels[l]);
+					}
+					src = mixed;
+				}
+				BlendPixel(rgb, src, layer.blend, layer.opacity);
+			}
+			strip->SetPixelColor(p, PixelOutput::Color(rgb[0], rgb[1], rgb[2]));
+		}
+	}
+
+	void RenderStandbyAnimation()
+	{
+		static uint32_t lastStandbyUpdate = 0;
+
+		constexpr uint32_t kUpdateInterval = 1500;
+		constexpr float kMinBrightness = 0.01f;  // 1%
+		constexpr float kMaxBrightness = 0.04f;  // 4%
+		constexpr float kColorVariation = 0.20f; // 20% color deviation
+		constexpr float kUpdateChanceMin = 0.10f; // 10% of LEDs
+		constexpr float kUpdateChanceMax = 0.20f; // 20% of LEDs
+
+		uint32_t now = millis();
+
+		// Initialize all LEDs when entering standby animation
+		if (standbyNeedsInit)
+		{
+			for (uint16_t i = 0; i < numLeds; i++)
+			{
+				float brightness = kMinBrightness + (random(100) / 100.0f) * (kMaxBrightness - kMinBrightness);
+				float colorVarR = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
+				float colorVarG = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
+				float colorVarB = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
 
-			strip->setPixelColor(i, strip->Color(r, g, b));
+				uint8_t r = constrain((int)(config.standbyR * brightness * colorVarR), 0, 255);
+				uint8_t g = constrain((int)(config.standbyG * brightness * colorVarG), 0, 255);
+				uint8_t b = constrain((int)(config.standbyB * brightness * colorVarB), 0, 255);
+
+				strip->SetPixelColor(i, PixelOutput::Color(r, g, b));
+			}
+			strip->Show();
+			standbyNeedsInit = false;
+			lastStandbyUpdate = now;
+			return;
 		}
-		strip->show();
-		standbyNeedsInit = false;
+
+		if (now - lastStandbyUpdate < kUpdateInterval)
+			return;
 		lastStandbyUpdate = now;
-		return;
+
+		// Randomly update 10-20% of LEDs
+		float updateChance = kUpdateChanceMin + (random(100) / 100.0f) * (kUpdateChanceMax - kUpdateChanceMin);
+		int updateThreshold = (int)(updateChance * 100);
+
+		for (uint16_t i = 0; i < numLeds; i++)
+		{
+			if (random(100) < updateThreshold)
+			{
+				float brightness = kMinBrightness + (random(100) / 100.0f) * (kMaxBrightness - kMinBrightness);
+				float colorVarR = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
+				float colorVarG = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
+				float colorVarB = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
+
+				uint8_t r = constrain((int)(config.standbyR * brightness * colorVarR), 0, 255);
+				uint8_t g = constrain((int)(config.standbyG * brightness * colorVarG), 0, 255);
+				uint8_t b = constrain((int)(config.standbyB * brightness * colorVarB), 0, 255);
+
+				strip->SetPixelColor(i, PixelOutput::Color(r, g, b));
+			}
+		}
+
+		strip->Show();
 	}
 
-	if (now - lastStandbyUpdate < kUpdateInterval)
-		return;
-	lastStandbyUpdate = now;
+	void RenderUnconfiguredAnimation()
+	{
+		static uint32_t lastUpdate = 0;
+		static uint16_t phase = 0;
+
+		uint32_t now = millis();
+		if (now - lastUpdate < 30)
+			return;
+		lastUpdate = now;
 
-	// Randomly update 10-20% of LEDs
-	float updateChance = kUpdateChanceMin + (random(100) / 100.0f) * (kUpdateChanceMax - kUpdateChanceMin);
-	int updateThreshold = (int)(updateChance * 100);
+		phase += 313; // 0.03 rad
 
-	for (uint16_t i = 0; i < numLeds; i++)
+		uint8_t r = 10 + Scale8(15, Sin8Phase(phase));
+		strip->Fill(PixelOutput::Color(r, 0, 0), 0, numLeds);
+		strip->Show();
+	}
+
+	void RenderPairingAnimation()
 	{
-		if (random(100) < updateThreshold)
+		static uint32_t lastBlink = 0;
+		static bool ledOn = false;
+
+		uint32_t now = millis();
+		if (now - lastBlink < 150)
+			return;
+		lastBlink = now;
+
+		ledOn = !ledOn;
+		if (ledOn)
+		{
+			strip->Fill(PixelOutput::Color(0, 0, 100), 0, numLeds);
+		}
+		else
 		{
-			float brightness = kMinBrightness + (random(100) / 100.0f) * (kMaxBrightness - kMinBrightness);
-			float colorVarR = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
-			float colorVarG = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
-			float colorVarB = 1.0f + ((random(200) - 100) / 100.0f) * kColorVariation;
+			strip->Clear();
+		}
+		strip->Show();
+	}
 
-			uint8_t r = constrain((int)(config.standbyR * brightness * colorVarR), 0, 255);
-			uint8_t g = constrain((int)(config.standbyG * brightness * colorVarG), 0, 255);
-			uint8_t b = constrain((int)(config.standbyB * brightness * colorVarB), 0, 255);
+	void RenderDimWhiteStandby()
+	{
+		static uint32_t lastDimUpdate = 0;
+		uint32_t now = millis();
+		if (now - lastDimUpdate < 100)
+			return;
+		lastDimUpdate = now;
 
-			strip->setPixelColor(i, strip->Color(r, g, b));
+		strip->Fill(PixelOutput::Color(5, 5, 5), 0, numLeds);
+		strip->Show();
+	}
+
+	void RenderEmergency()
+	{
+		bool on = ((millis() / 100) % 2) == 0;
+		if (on)
+		{
+			SetLedColor(255, 0, 0);
+		}
+		else
+		{
+			ClearLeds();
 		}
 	}
 
-	strip->show();
-}
+	/**
+	 * @returns true while the identify blink covers the strip
+	 */
+	bool RenderIdentify()
+	{
+		if (!identifyActive)
+			return false;
 
-void SetIdentifyEffect(uint16_t durationMs)
-{
-	identifyActive = true;
-	identifyEnd = millis() + durationMs;
-	LOG("Identify effect started");
-}
+		if (millis() - identifyStart >= identifyDuration)
+		{
+			identifyActive = false;
+			ClearLeds();
+			forceRedraw = true;
+			return false;
+		}
 
-void SetEmergencyEffect()
-{
-	emergencyActive = true;
-	LOG("Emergency effect started");
-}
+		bool on = ((millis() / 200) % 2) == 0;
+		if (on)
+		{
+			SetLedColor(255, 255, 255);
+		}
+		else
+		{
+			ClearLeds();
+		}
+		return true;
+	}
 
-void UpdateUnconfiguredAnimation()
-{
-	if (!initialized)
-		return;
+	/**
+	 * @returns true while a feedback flash sequence covers the strip
+	 */
+	bool RenderFeedback()
+	{
+		if (!feedbackActive)
+			return false;
 
-	static uint32_t lastUpdate = 0;
-	static float phase = 0;
+		uint32_t now = millis();
+		uint16_t phaseDuration = feedbackOn ? feedbackOnMs : feedbackOffMs;
+		if (now - feedbackPhaseStart < phaseDuration)
+			return true;
 
-	uint32_t now = millis();
-	if (now - lastUpdate < 30)
-		return;
-	lastUpdate = now;
+		feedbackPhaseStart = now;
+		if (feedbackOn)
+		{
+			feedbackOn = false;
+			ClearLeds();
+			return true;
+		}
 
-	phase += 0.03f;
-	if (phase > 2.0f * PI)
-		phase -= 2.0f * PI;
+		if (--feedbackRemaining == 0)
+		{
+			feedbackActive = false;
+			ClearLeds();
+			forceRedraw = true;
+			return false;
+		}
 
-	float brightness = 0.2f + 0.3f * (1.0f + sin(phase)) / 2.0f;
+		feedbackOn = true;
+		strip->Fill(feedbackColor, 0, numLeds);
+		strip->Show();
+		return true;
+	}
 
-	uint8_t r = static_cast<uint8_t>(50 * brightness);
-	strip->fill(strip->Color(r, 0, 0), 0, numLeds);
-	strip->show();
-}
+	void StartFeedback(const Command &cmd)
+	{
+		if (cmd.length == 0)
+			return;
 
-void UpdatePairingAnimation()
-{
-	if (!initialized)
-		return;
+		feedbackActive = true;
+		feedbackOn = true;
+		feedbackColor = PixelOutput::Color(cmd.r, cmd.g, cmd.b);
+		feedbackOnMs = cmd.speed;
+		feedbackOffMs = cmd.duration;
+		feedbackRemaining = cmd.length;
+		feedbackPhaseStart = millis();
 
-	static uint32_t lastBlink = 0;
-	static bool ledOn = false;
+		strip->Fill(feedbackColor, 0, numLeds);
+		strip->Show();
+	}
 
-	uint32_t now = millis();
-	if (now - lastBlink < 150)
-		return;
-	lastBlink = now;
+	/**
+	 * @brief Flash the first LED on top of the standby animations
+	 */
+	void RenderHeartbeatFlash()
+	{
+		if (!heartbeatFlashActive)
+			return;
+
+		if (millis() - heartbeatFlashStart >= kHeartbeatFlashDuration)
+		{
+			heartbeatFlashActive = false;
+			// Restore first LED to standby color
+			standbyNeedsInit = true;
+			return;
+		}
 
-	ledOn = !ledOn;
-	if (ledOn)
+		strip->SetPixelColor(0, PixelOutput::Color(50, 50, 50));
+		strip->Show();
+	}
+
+	void SetMode(RenderMode newMode)
 	{
-		strip->fill(strip->Color(0, 0, 100), 0, numLeds);
+		mode = newMode;
+		identifyActive = false;
+		standbyNeedsInit = true;
 	}
-	else
+
+	void ApplyRenderCommand(const Command &cmd)
 	{
-		strip->clear();
+		if (IsEffectCommand(cmd.effect))
+		{
+			StartEffect(cmd);
+			return;
+		}
+
+		switch (cmd.effect)
+		{
+		case RenderCmd::kReinitialize:
+			CreateStrip();
+			break;
+
+		case Cmd::kStateOff:
+			SetMode(RenderMode::kOff);
+			ClearLeds();
+			break;
+
+		case Cmd::kStateEmergency:
+			SetMode(RenderMode::kEmergency);
+			break;
+
+		case Cmd::kIdentify:
+			identifyActive = true;
+			identifyStart = millis();
+			identifyDuration = cmd.duration;
+			break;
+
+		case RenderCmd::kStandby:
+			SetMode(RenderMode::kStandby);
+			break;
+
+		case RenderCmd::kUnconfigured:
+			SetMode(RenderMode::kUnconfigured);
+			break;
+
+		case RenderCmd::kPairing:
+			SetMode(RenderMode::kPairing);
+			break;
+
+		case RenderCmd::kDimWhite:
+			SetMode(RenderMode::kDimWhite);
+			break;
+
+		case RenderCmd::kFeedback:
+			StartFeedback(cmd);
+			break;
+
+		case RenderCmd::kHeartbeatFlash:
+			heartbeatFlashActive = true;
+			heartbeatFlashStart = millis();
+			break;
+
+		case RenderCmd::kSegments:
+			LoadSegmentLayout();
+			ClearLeds();
+			break;
+
+		case RenderCmd::kLayerMix:
+			SetLayerMix(cmd);
+			break;
+		}
 	}
-	strip->show();
-}
 
-void SetPairingSuccessFeedback()
-{
-	if (!initialized)
-		return;
+	void RenderFrame()
+	{
+		if (RenderFeedback() || RenderIdentify())
+			return;
+
+		switch (mode)
+		{
+		case RenderMode::kOff:
+			break;
+
+		case RenderMode::kEffect:
+		{
+			uint32_t start = ESP.getCycleCount();
+			bool drawn = false;
+			for (Segment &seg : segments)
+			{
+				bool changed = false;
+				uint8_t levels[kMaxLayers];
+				for (size_t l = 0; l < kMaxLayers; l++)
+				{
+					levels[l] = 255;
+					Layer &layer = seg.layers[l];
+					if (!layer.active || layer.opacity == 0)
+						continue;
+
+					SegmentView out(layerBuffers[l], seg);
+					if (RenderEffect(layer, out, forceRedraw))
+						changed = true;
+
+					// A crossfade changes the picture every frame, including the last one at 255
+					if (layer.fading)
+					{
+						levels[l] = TransitionLevel(layer);
+						layer.fading = levels[l] < 255;
+						changed = true;
+					}
+				}
+
+				if (changed || (forceRedraw && seg.length > 0))
+				{
+					CompositeSegment(seg, levels);
+					drawn = true;
+				}
+			}
+			forceRedraw = false;
+
+			if (drawn)
+			{
+				strip->Show();
+				uint32_t cycles = ESP.getCycleCount() - start;
+				renderStats.lastFrameCycles = cycles;
+				if (cycles > renderStats.maxFrameCycles)
+					renderStats.maxFrameCycles = cycles;
+				renderStats.frames++;
+			}
+			break;
+		}
+
+		case RenderMode::kEmergency:
+			RenderEmergency();
+			break;
+
+		case RenderMode::kStandby:
+			RenderStandbyAnimation();
+			RenderHeartbeatFlash();
+			break;
+
+		case RenderMode::kUnconfigured:
+			RenderUnconfiguredAnimation();
+			break;
 
-	for (int i = 0; i < 3; i++)
+		case RenderMode::kPairing:
+			RenderPairingAnimation();
+			break;
+
+		case RenderMode::kDimWhite:
+			RenderDimWhiteStandby();
+			RenderHeartbeatFlash();
+			break;
+		}
+	}
+
+	/**
+	 * @brief Render loop, pinned to the APP core
+	 * Draws at a fixed kRenderFps. A new command wakes the task and is drawn
+	 * right away instead of waiting for the next frame slot.
+	 */
+	void RenderTask(void *)
 	{
-		strip->fill(strip->Color(0, 100, 0), 0, numLeds);
-		strip->show();
-		delay(100);
-		strip->clear();
-		strip->show();
-		delay(100);
+		nextFrame = millis();
+		for (;;)
+		{
+			bool applied = false;
+			Command cmd;
+			while (renderQueue.Pop(cmd))
+			{
+				ApplyRenderCommand(cmd);
+				applied = true;
+			}
+
+			uint32_t now = millis();
+			bool due = (int32_t)(now - nextFrame) >= 0;
+			if (due || applied)
+			{
+				RenderFrame();
+			}
+			if (due)
+			{
+				nextFrame += kRenderIntervalMs;
+				// Fell behind (long frame) - skip frames instead of catching up
+				if ((int32_t)(now - nextFrame) >= 0)
+					nextFrame = now + kRenderIntervalMs;
+			}
+
+			uint32_t wait = nextFrame - millis();
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((int32_t)wait > 0 ? wait : 0));
+		}
 	}
 }
 
-void SetPairingFailedFeedback()
+void InitializeLeds()
 {
-	if (!initialized)
+	LOG("Initializing LEDs");
+
+	CreateStrip();
+
+	if (renderTaskHandle != nullptr)
 		return;
 
-	for (int i = 0; i < 5; i++)
+	BaseType_t result = xTaskCreatePinnedToCore(RenderTask, "render", kRenderTaskStackSize, nullptr,
+															  kRenderTaskPriority, &renderTaskHandle, kRenderTaskCore);
+	if (result != pdPASS)
 	{
-		strip->fill(strip->Color(100, 0, 0), 0, numLeds);
-		strip->show();
-		delay(80);
-		strip->clear();
-		strip->show();
-		delay(80);
+		LOG("Failed to start render task");
+		renderTaskHandle = nullptr;
 	}
 }
 
-void SetConfigSuccessFeedback()
+void ReinitializeLeds()
 {
-	if (!initialized)
-		return;
+	PostRenderCommand(RenderCmd::kReinitialize);
+}
 
-	strip->fill(strip->Color(0, 150, 0), 0, numLeds);
-	strip->show();
-	delay(1000);
-	strip->clear();
-	strip->show();
-	LOG("Config success feedback shown");
+void TurnOffLeds()
+{
+	if (PostRenderCommand(Cmd::kStateOff))
+		lastModeCmd = Cmd::kStateOff;
 }
 
-void SetConfigFailedFeedback()
+void TurnOffLedsImmediate()
+{
+	TurnOffLeds();
+}
+
+void SetLedCount(uint8_t count)
 {
-	if (!initialized)
+	config.ledCount = count;
+	SaveConfig();
+
+	ReinitializeLeds();
+	PostFeedback(255, 0, 0, 500, 0, 1);
+	LOGF("LED count set to %u\n", count);
+}
+
+void SetLedEffect(const Command &cmd)
+{
+	LOGF("Effect: %s | RGB(%u,%u,%u) | Brightness: %u%% | Speed: %u | Duration: %u | Length: %u | Rainbow: %u\n",
+		  GetEffectName(cmd.effect), cmd.r, cmd.g, cmd.b, (cmd.intensity * 100) / 255, cmd.speed, cmd.duration, cmd.length, cmd.rainbow);
+
+	if (PostRenderCommand(cmd))
+		lastModeCmd = cmd.effect;
+}
+
+void SetLedSegment(uint8_t segment, uint16_t start, uint16_t length, uint8_t flags)
+{
+	if (segment > kMaxSegments)
+	{
+		LOGF("Invalid segment %u\n", segment);
 		return;
+	}
 
-	for (int i = 0; i < 3; i++)
+	portENTER_CRITICAL(&segmentTableMux);
+	if (segment == kSegmentAll)
 	{
-		strip->fill(strip->Color(150, 0, 0), 0, numLeds);
-		strip->show();
-		delay(300);
-		strip->clear();
-		strip->show();
-		delay(300);
+		memset(segmentTable, 0, sizeof(segmentTable));
 	}
-	LOG("Config failed feedback shown");
+	else
+	{
+		SegmentConfig &entry = segmentTable[segment - 1];
+		entry.start = start;
+		entry.length = length;
+		entry.flags = flags;
+	}
+	portEXIT_CRITICAL(&segmentTableMux);
+
+	SaveSegments();
+	PostRenderCommand(RenderCmd::kSegments);
+	LOGF("Segment %u: start=%u length=%u flags=0x%02X\n", segment, start, length, flags);
 }
 
-void TriggerHeartbeatFlash()
+void SetLedLayerMix(const Command &cmd)
 {
-	heartbeatFlashActive = true;
-	heartbeatFlashEnd = millis() + kHeartbeatFlashDuration;
+	Command mix = cmd;
+	mix.effect = RenderCmd::kLayerMix;
+	PostRenderCommand(mix);
+	LOGF("Layer %u of segment %u: blend=%u opacity=%u\n", cmd.layer, cmd.segment, cmd.r, cmd.intensity);
 }
 
-bool UpdateHeartbeatFlash()
+void ShowStandbyAnimation()
 {
-	if (!initialized || !heartbeatFlashActive)
-		return false;
+	PostModeCommand(RenderCmd::kStandby);
+}
 
-	if (millis() >= heartbeatFlashEnd)
-	{
-		heartbeatFlashActive = false;
-		// Restore first LED to standby color
-		standbyNeedsInit = true;
-		return false;
-	}
+void ShowUnconfiguredAnimation()
+{
+	PostModeCommand(RenderCmd::kUnconfigured);
+}
 
-	// Only flash the first LED
-	strip->setPixelColor(0, strip->Color(50, 50, 50));
-	strip->show();
-	return true;
+void ShowPairingAnimation()
+{
+	PostModeCommand(RenderCmd::kPairing);
 }
 
 void ShowDimWhiteStandby()
 {
-	if (!initialized)
-		return;
+	PostModeCommand(RenderCmd::kDimWhite);
+}
 
-	static uint32_t lastDimUpdate = 0;
-	uint32_t now = millis();
-	if (now - lastDimUpdate < 100)
-		return;
-	lastDimUpdate = now;
+void SetIdentifyEffect(uint16_t durationMs)
+{
+	Command cmd = {};
+	cmd.effect = Cmd::kIdentify;
+	cmd.duration = durationMs;
+	PostRenderCommand(cmd);
+	LOG("Identify effect started");
+}
 
-	strip->fill(strip->Color(5, 5, 5), 0, numLeds);
-	strip->show();
+void SetEmergencyEffect()
+{
+	if (PostRenderCommand(Cmd::kStateEmergency))
+		lastModeCmd = Cmd::kStateEmergency;
+	LOG("Emergency effect started");
+}
+
+void SetPairingSuccessFeedback()
+{
+	PostFeedback(0, 100, 0, 100, 100, 3);
+}
+
+void SetPairingFailedFeedback()
+{
+	PostFeedback(100, 0, 0, 80, 80, 5);
+}
+
+void SetConfigSuccessFeedback()
+{
+	PostFeedback(0, 150, 0, 1000, 0, 1);
+	LOG("Config success feedback shown");
+}
+
+void SetConfigFailedFeedback()
+{
+	PostFeedback(150, 0, 0, 300, 300, 3);
+	LOG("Config failed feedback shown");
+}
+
+void TriggerHeartbeatFlash()
+{
+	PostRenderCommand(RenderCmd::kHeartbeatFlash);
 }
@@ -7,7 +7,9 @@
 #include "led_handler.h"
 #include "logging.h"
 #include "ota_handler.h"
+#include "scene_store.h"
 #include "states.h"
+#include "telemetry.h"
 
 State currentState = kInit;
 
@@ -19,6 +21,7 @@ void setup()
   LOG("Nano starting...");
 
   InitializeEEPROM();
+  InitializeScenes();
   InitializeLeds();
   InitializeButton();
 
@@ -42,4 +45,6 @@ void loop()
   }
 
   HandleState(currentState);
+  ProcessTelemetry(currentState);
+  ProcessScenes();
 }
@@ -0,0 +1,130 @@
+#include "net_time.h"
+
+#include <esp_timer.h>
+
+#include "constants.h"
+#include "logging.h"
+
+namespace
+{
+   portMUX_TYPE offsetMux = portMUX_INITIALIZER_UNLOCKED;
+   int64_t offsetUs = 0;
+
+   // One sample per beacon: gateway time - local receive time = offset - delay.
+   // Delay is never negative, so the largest sample is the best estimate.
+   int64_t samples[kTimeSampleWindow];
+   size_t sampleIndex = 0;
+   size_t sampleCount = 0;
+
+   // Run of samples far below the window, see OnTimeBeacon
+   int64_t lowSample = 0;
+   size_t lowCount = 0;
+
+   bool synced = false;
+   uint32_t lastBeacon = 0;
+
+   int64_t BestSample()
+   {
+      int64_t best = samples[0];
+      for (size_t i = 1; i < sampleCount; i++)
+      {
+         if (samples[i] > best)
+            best = samples[i];
+      }
+      return best;
+   }
+
+   void ResetWindow()
+   {
+      sampleCount = 0;
+      sampleIndex = 0;
+      lowCount = 0;
+   }
+}
+
+void OnTimeBeacon(int64_t gatewayTimeUs, int64_t localRxTimeUs)
+{
+   int64_t sample = gatewayTimeUs - localRxTimeUs;
+
+   lastBeacon = millis();
+
+   if (sampleCount > 0)
+   {
+      int64_t best = BestSample();
+      if (sample - best > kTimeStepThresholdUs)
+      {
+         // Delay only ever lowers a sample, so a jump up is a real clock change
+         ResetWindow();
+      }
+      else if (best - sample > kTimeStepThresholdUs)
+      {
+         // A late beacon (ESP-NOW retry, busy WiFi task) is dropped. Only a run
+         // of low samples that agree with each other moves the clock back, e.g.
+         // after a gateway reboot.
+         if (lowCount > 0 && llabs(sample - lowSample) <= kTimeStepThresholdUs)
+         {
+            lowCount++;
+            lowSample = max(lowSample, sample);
+         }
+         else
+         {
+            lowCount = 1;
+            lowSample = sample;
+         }
+
+         if (lowCount < kTimeOutlierRun)
+            return;
+
+         sample = lowSample;
+         ResetWindow();
+      }
+      else
+      {
+         lowCount = 0;
+      }
+   }
+
+   samples[sampleIndex] = sample;
+   sampleIndex = (sampleIndex + 1) % kTimeSampleWindow;
+   if (sampleCount < kTimeSampleWindow)
+      sampleCount++;
+
+   int64_t target = BestSample();
+   int64_t correction = target - offsetUs;
+
+   // Step on the first beacon or a large error, otherwise slew so running
+   // effects never jump
+   if (!synced || llabs(correction) > kTimeStepThresholdUs)
+   {
+      LOGF("Network time stepped by %ld us\n", (long)correction);
+   }
+   else
+   {
+      correction = constrain(correction, -kTimeMaxSlewUs, kTimeMaxSlewUs);
+   }
+
+   portENTER_CRITICAL(&offsetMux);
+   offsetUs += correction;
+   portEXIT_CRITICAL(&offsetMux);
+
+   synced = true;
+}
+
+bool IsNetworkTimeSynced()
+{
+   return synced && millis() - lastBeacon < kTimeSyncTimeout;
+}
+
+int64_t GetNetworkTimeUs()
+{
+   portENTER_CRITICAL(&offsetMux);
+   int64_t offset = offsetUs;
+   portEXIT_CRITICAL(&offsetMux);
+
+   return esp_timer_get_time() + offset;
+}
+
+uint32_t GetNetworkTimeMs()
+{
+   return static_cast<uint32_t>(GetNetworkTimeUs() / 1000);
+}
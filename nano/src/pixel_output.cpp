@@ -0,0 +1,175 @@
+#include "pixel_output.h"
+
+#include <esp_timer.h>
+
+#include "logging.h"
+
+namespace
+{
+   rmt_item32_t bit0Item;
+   rmt_item32_t bit1Item;
+
+   // Set by the RMT ISR when the last bit of a frame has left the pin
+   volatile int64_t txEndUs = 0;
+
+   void IRAM_ATTR OnTxEnd(rmt_channel_t channel, void *arg)
+   {
+      if (channel == kPixelRmtChannel)
+      {
+         txEndUs = esp_timer_get_time();
+      }
+   }
+
+   /**
+    * @brief RMT translator, converts GRB bytes to WS2812 bit symbols
+    * Runs in the RMT ISR whenever the channel memory needs a refill.
+    */
+   void IRAM_ATTR TranslateToRmt(const void *src, rmt_item32_t *dest, size_t srcSize,
+                                 size_t wantedNum, size_t *translatedSize, size_t *itemNum)
+   {
+      if (src == nullptr || dest == nullptr)
+      {
+         *translatedSize = 0;
+         *itemNum = 0;
+         return;
+      }
+
+      const uint8_t *bytes = static_cast<const uint8_t *>(src);
+      size_t size = 0;
+      size_t num = 0;
+
+      while (size < srcSize && num < wantedNum)
+      {
+         for (int bit = 7; bit >= 0; bit--)
+         {
+            dest->val = (bytes[size] & (1 << bit)) ? bit1Item.val : bit0Item.val;
+            dest++;
+         }
+         num += 8;
+         size++;
+      }
+
+      *translatedSize = size;
+      *itemNum = num;
+   }
+
+   rmt_item32_t MakeItem(uint32_t highNs, uint32_t lowNs, uint32_t ticksPerUs)
+   {
+      rmt_item32_t item;
+      item.level0 = 1;
+      item.duration0 = (highNs * ticksPerUs) / 1000;
+      item.level1 = 0;
+      item.duration1 = (lowNs * ticksPerUs) / 1000;
+      return item;
+   }
+}
+
+PixelOutput::PixelOutput(uint16_t numPixels, uint8_t pin)
+    : numPixels(numPixels), pin(pin), numBytes(static_cast<size_t>(numPixels) * 3)
+{
+   frontBuffer = new uint8_t[numBytes]();
+   backBuffer = new uint8_t[numBytes]();
+}
+
+PixelOutput::~PixelOutput()
+{
+   if (started)
+   {
+      rmt_wait_tx_done(kPixelRmtChannel, portMAX_DELAY);
+      rmt_driver_uninstall(kPixelRmtChannel);
+   }
+   delete[] frontBuffer;
+   delete[] backBuffer;
+}
+
+bool PixelOutput::Begin()
+{
+   rmt_config_t rmtConfig = RMT_DEFAULT_CONFIG_TX(static_cast<gpio_num_t>(pin), kPixelRmtChannel);
+   rmtConfig.clk_div = kPixelRmtClockDivider;
+
+   if (rmt_config(&rmtConfig) != ESP_OK || rmt_driver_install(kPixelRmtChannel, 0, 0) != ESP_OK)
+   {
+      LOG("RMT init failed");
+      return false;
+   }
+
+   uint32_t counterHz = 0;
+   rmt_get_counter_clock(kPixelRmtChannel, &counterHz);
+   uint32_t ticksPerUs = counterHz / 1000000;
+   bit0Item = MakeItem(kPixelT0HighNs, kPixelT0LowNs, ticksPerUs);
+   bit1Item = MakeItem(kPixelT1HighNs, kPixelT1LowNs, ticksPerUs);
+
+   rmt_translator_init(kPixelRmtChannel, TranslateToRmt);
+   rmt_register_tx_end_callback(OnTxEnd, nullptr);
+   started = true;
+
+   Clear();
+   Show();
+   return true;
+}
+
+void PixelOutput::SetPixelColor(uint16_t index, uint32_t color)
+{
+   if (index >= numPixels)
+      return;
+
+   uint8_t *p = &backBuffer[index * 3];
+   p[0] = (color >> 8) & 0xFF;
+   p[1] = (color >> 16) & 0xFF;
+   p[2] = color & 0xFF;
+}
+
+uint32_t PixelOutput::GetPixelColor(uint16_t index) const
+{
+   if (index >= numPixels)
+      return 0;
+
+   const uint8_t *p = &backBuffer[index * 3];
+   return Color(p[1], p[0], p[2]);
+}
+
+void PixelOutput::Fill(uint32_t color, uint16_t first, uint16_t count)
+{
+   uint16_t end = (count == 0 || first + count > numPixels) ? numPixels : first + count;
+   for (uint16_t i = first; i < end; i++)
+   {
+      SetPixelColor(i, color);
+   }
+}
+
+void PixelOutput::Clear()
+{
+   memset(backBuffer, 0, numBytes);
+}
+
+void PixelOutput::Show()
+{
+   if (!started)
+      return;
+
+   if (transmitting)
+   {
+      rmt_wait_tx_done(kPixelRmtChannel, portMAX_DELAY);
+
+      // The strip only latches the last frame after the line stayed low for
+      // kPixelLatchUs, anything sent earlier is taken as more pixel data.
+      // If the end callback has not run yet, count from now.
+      int64_t endUs = txEndUs;
+      if (endUs < txStartUs)
+      {
+         endUs = esp_timer_get_time();
+      }
+      while (esp_timer_get_time() - endUs < kPixelLatchUs)
+      {
+      }
+   }
+
+   uint8_t *finished = backBuffer;
+   backBuffer = frontBuffer;
+   frontBuffer = finished;
+   memcpy(backBuffer, frontBuffer, numBytes);
+
+   txStartUs = esp_timer_get_time();
+   rmt_write_sample(kPixelRmtChannel, frontBuffer, numBytes, false);
+   transmitting = true;
+}
@@ -0,0 +1,122 @@
+#include "scene_store.h"
+
+#include <Preferences.h>
+
+#include "constants.h"
+#include "eeprom_handler.h"
+#include "logging.h"
+
+namespace
+{
+   const char *kNamespace = "scenes";
+
+   uint16_t tableId = 0;
+   uint8_t scenes[kSceneCount][kFrameSize];
+   uint8_t used[kSceneCount / 8] = {};
+
+   bool dirty = false;
+   uint32_t lastChange = 0;
+
+   bool IsUsed(uint8_t sceneId)
+   {
+      return used[sceneId / 8] & (1 << (sceneId % 8));
+   }
+
+   void MarkChanged()
+   {
+      dirty = true;
+      lastChange = millis();
+   }
+
+   void SaveScenes()
+   {
+      Preferences prefs;
+      if (!prefs.begin(kNamespace, false))
+      {
+         LOG("Scene NVS open failed");
+         return;
+      }
+
+      prefs.putUShort("table", tableId);
+      prefs.putBytes("used", used, sizeof(used));
+      prefs.putBytes("data", scenes, sizeof(scenes));
+      prefs.end();
+
+      LOGF("Scene table %u saved (%u scenes)\n", tableId, GetSceneCount());
+   }
+}
+
+void InitializeScenes()
+{
+   Preferences prefs;
+   if (!prefs.begin(kNamespace, true))
+      return;
+
+   if (prefs.getBytesLength("used") == sizeof(used) && prefs.getBytesLength("data") == sizeof(scenes))
+   {
+      tableId = prefs.getUShort("table", 0);
+      prefs.getBytes("used", used, sizeof(used));
+      prefs.getBytes("data", scenes, sizeof(scenes));
+      LOGF("Scene table %u loaded (%u scenes)\n", tableId, GetSceneCount());
+   }
+   prefs.end();
+}
+
+void BeginSceneTable(uint16_t id)
+{
+   if (id == tableId)
+      return;
+
+   tableId = id;
+   memset(used, 0, sizeof(used));
+   MarkChanged();
+   LOGF("Scene table %u started\n", tableId);
+}
+
+bool StoreScene(uint8_t sceneId, const uint8_t *command)
+{
+   uint16_t groups = (static_cast<uint16_t>(command[4]) << 8) | command[5];
+   if (!IsEffectCommand(command[3]) || (groups & config.groups) == 0)
+      return false;
+
+   if (IsUsed(sceneId) && memcmp(scenes[sceneId], command, kFrameSize) == 0)
+      return true;
+
+   memcpy(scenes[sceneId], command, kFrameSize);
+   used[sceneId / 8] |= 1 << (sceneId % 8);
+   MarkChanged();
+   return true;
+}
+
+bool LoadScene(uint16_t id, uint8_t sceneId, Command &cmd)
+{
+   if (id != tableId || !IsUsed(sceneId))
+      return false;
+
+   cmd = ParseCommand(scenes[sceneId]);
+   return true;
+}
+
+void ProcessScenes()
+{
+   if (dirty && millis() - lastChange >= kScenePersistDelayMs)
+   {
+      dirty = false;
+      SaveScenes();
+   }
+}
+
+uint16_t GetSceneTableId()
+{
+   return tableId;
+}
+
+uint16_t GetSceneCount()
+{
+   uint16_t count = 0;
+   for (uint8_t bits : used)
+   {
+      count += __builtin_popcount(bits);
+   }
+   return count;
+}
@@ -5,6 +5,7 @@
 #include "espnow_handler.h"
 #include "led_handler.h"
 #include "logging.h"
+#include "scene_store.h"
 
 namespace
 {
@@ -164,6 +165,14 @@ void ProcessCommand(State &currentState, const Command &cmd)
 			config.meshTTL = min(cmd.length, kMaxMeshTTL);
 			LOGF("Mesh TTL set to %u\n", config.meshTTL);
 			break;
+
+		case Cmd::kSetSegment:
+			SetLedSegment(cmd.length, cmd.duration, cmd.speed, cmd.r);
+			break;
+
+		case Cmd::kSetLayer:
+			SetLedLayerMix(cmd);
+			break;
 		}
 		return;
 	}
@@ -221,6 +230,27 @@ void ProcessCommand(State &currentState, const Command &cmd)
 			extern NanoConfig config;
 			LOGF("Debug: groups=0x%04X leds=%u ttl=%u\n",
 				  config.groups, config.ledCount, config.meshTTL);
+			{
+				RxStats rx = GetRxStats();
+				LOGF("RX: queued=%lu high=%lu overflows=%lu\n",
+					  (unsigned long)rx.queued, (unsigned long)rx.highWater, (unsigned long)rx.overflows);
+
+				MeshStats mesh = GetMeshStats();
+				LOGF("Mesh: sent=%lu suppressed=%lu dropped=%lu\n",
+					  (unsigned long)mesh.sent, (unsigned long)mesh.suppressed, (unsigned long)mesh.dropped);
+
+				StressStats stress = GetStressStats();
+				LOGF("Stress: received=%lu dup=%lu ooo=%lu missing=%lu proc avg=%lu max=%lu us\n",
+					  (unsigned long)stress.received, (unsigned long)stress.duplicates,
+					  (unsigned long)stress.outOfOrder, (unsigned long)stress.missing,
+					  (unsigned long)stress.avgProcessingUs, (unsigned long)stress.maxProcessingUs);
+				LOGF("Scenes: table=%u stored=%u\n", GetSceneTableId(), GetSceneCount());
+
+				RenderStats stats = GetRenderStats();
+				LOGF("Render: fx=0x%02X leds=%u frames=%lu cycles last=%lu max=%lu\n",
+					  stats.effect, stats.numLeds, (unsigned long)stats.frames,
+					  (unsigned long)stats.lastFrameCycles, (unsigned long)stats.maxFrameCycles);
+			}
 			break;
 		}
 	}
@@ -240,7 +270,7 @@ void HandleInitState(State &currentState)
 
 void HandleUnconfiguredState(State &currentState)
 {
-	UpdateStandbyAnimation();
+	ShowStandbyAnimation();
 }
 
 void HandlePairingState(State &currentState)
@@ -276,12 +306,12 @@ void HandlePairingState(State &currentState)
 		lastPairingRequest = now;
 	}
 
-	UpdatePairingAnimation();
+	ShowPairingAnimation();
 }
 
 void HandleConnectingState(State &currentState)
 {
-	UpdateStandbyAnimation();
+	ShowStandbyAnimation();
 }
 
 void HandleStandbyState(State &currentState)
@@ -294,17 +324,11 @@ void HandleStandbyState(State &currentState)
 		return;
 	}
 
-	// If heartbeat flash is active, show it
-	if (UpdateHeartbeatFlash())
-	{
-		return;
-	}
-
 	// Behavior based on heartbeat presence
 	if (lastHeartbeatTime == 0)
 	{
 		// Kein Heartbeat = vor Auftritt → farbige Verläufe
-		UpdateStandbyAnimation();
+		ShowStandbyAnimation();
 	}
 	else
 	{
@@ -325,11 +349,8 @@ void HandleActiveState(State &currentState)
 		return;
 	}
 
-	if (effectActive)
-	{
-		UpdateLedEffect();
-	}
-	else
+	// Rendering runs on its own task, only watch for the effect ending here
+	if (!effectActive)
 	{
 		currentState = kStandby;
 	}
@@ -368,7 +389,7 @@ void HandleBlackoutState(State &currentState)
 void HandleDisconnectedState(State &currentState)
 {
 	// Show wave animation when disconnected (no heartbeat)
-	UpdateStandbyAnimation();
+	ShowStandbyAnimation();
 }
 
 void StartPairing()
@@ -409,7 +430,7 @@ bool OnConfigSetReceived(uint8_t deviceRegister, uint16_t ledCount, uint8_t stan
 	}
 
 	pairingActive = false;
-	InitializeLeds();
+	ReinitializeLeds();
 	SetConfigSuccessFeedback();
 	currentState = kConnecting;
 	return true;
@@ -0,0 +1,110 @@
+#include "telemetry.h"
+
+#include <esp_timer.h>
+#include <WiFi.h>
+
+#include "constants.h"
+#include "eeprom_handler.h"
+#include "espnow_handler.h"
+#include "logging.h"
+#include "net_time.h"
+#include "ota_handler.h"
+
+namespace
+{
+   constexpr uint32_t kSlotMs = kTelemetryIntervalMs / kTelemetrySlots;
+
+   int64_t lastLoopUs = 0;
+   uint32_t maxLoopUs = 0;
+
+   uint32_t scheduledPeriod = 0xFFFFFFFF;
+   uint32_t sendAtMs = 0;
+   bool sendPending = false;
+   uint8_t beaconNumber = 0;
+
+   /**
+    * @brief Slot of this Nano, stable across reboots
+    */
+   uint32_t OwnSlot()
+   {
+      uint8_t mac[6];
+      WiFi.macAddress(mac);
+
+      uint32_t hash = config.deviceRegister;
+      for (uint8_t byte : mac)
+      {
+         hash = hash * 31 + byte;
+      }
+      return hash % kTelemetrySlots;
+   }
+
+   uint16_t Saturate16(uint32_t value)
+   {
+      return value > 0xFFFF ? 0xFFFF : value;
+   }
+
+   void WriteU16(uint8_t *dest, uint16_t value)
+   {
+      dest[0] = (value >> 8) & 0xFF;
+      dest[1] = value & 0xFF;
+   }
+
+   uint16_t ReadBatteryMv()
+   {
+      if (kBatteryAdcPin < 0)
+         return 0;
+
+      return Saturate16(analogReadMilliVolts(kBatteryAdcPin) * kBatteryDividerRatio);
+   }
+
+   void SendStatusBeacon(State state)
+   {
+      RxStats rx = GetRxStats();
+      MeshStats mesh = GetMeshStats();
+
+      uint8_t beacon[kTelemetryBeaconSize];
+      beacon[0] = Cmd::kStatusBeacon;
+      beacon[1] = state;
+      beacon[2] = GetFirmwareVersion() & 0xFF;
+      beacon[3] = config.deviceRegister;
+      WriteU16(&beacon[4], GetLastHubSeq());
+      WriteU16(&beacon[6], Saturate16(rx.overflows));
+      WriteU16(&beacon[8], Saturate16(mesh.dropped));
+      WriteU16(&beacon[10], Saturate16(maxLoopUs));
+      beacon[12] = static_cast<uint8_t>(GetLastRssi());
+      WriteU16(&beacon[13], ReadBatteryMv());
+      beacon[15] = beaconNumber++;
+      beacon[16] = (IsNetworkTimeSynced() ? 0x01 : 0) | (IsHeartbeatTimedOut() ? 0x02 : 0);
+
+      SendBroadcast(beacon, sizeof(beacon));
+      maxLoopUs = 0;
+   }
+}
+
+void ProcessTelemetry(State state)
+{
+   int64_t nowUs = esp_timer_get_time();
+   if (lastLoopUs != 0 && nowUs - lastLoopUs > maxLoopUs)
+      maxLoopUs = nowUs - lastLoopUs;
+   lastLoopUs = nowUs;
+
+   // Unpaired Nanos are unknown to the hub, pairing has its own requests
+   if (!IsDeviceConfigured() || state == kPairing)
+      return;
+
+   uint32_t nowMs = GetNetworkTimeMs();
+   uint32_t period = nowMs / kTelemetryIntervalMs;
+
+   if (period != scheduledPeriod)
+   {
+      scheduledPeriod = period;
+      sendAtMs = period * kTelemetryIntervalMs + OwnSlot() * kSlotMs + random(kSlotMs / 2);
+      sendPending = true;
+   }
+
+   if (sendPending && static_cast<int32_t>(nowMs - sendAtMs) >= 0)
+   {
+      sendPending = false;
+      SendStatusBeacon(state);
+   }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Just enough of Arduino.h for fast_math.h in the [env:native] tests
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+
+#ifndef PI
+#define PI 3.14159265358979323846
+#endif
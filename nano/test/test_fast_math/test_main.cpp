@@ -0,0 +1,221 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include <unity.h>
+
+#include "effect_kernels.h"
+#include "fast_math.h"
+
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+/*
+ * Checks the fast_math.h tables against the float math they replaced and
+ * times the old sin()/pow() effect loops against the effect_kernels.h
+ * kernels the effects draw with now.
+ *
+ *   pio test -e native     host, nanoseconds per frame
+ *   pio test -e esp32dev   on the Nano, CPU cycles per frame
+ */
+
+namespace
+{
+   constexpr uint16_t kStripSizes[] = {30, 150, 300};
+   constexpr uint32_t kFrames = 200;
+   constexpr uint8_t kLength = 10;
+
+   uint8_t pixels[300];
+   volatile uint32_t sink = 0; // keeps the compiler from dropping the loops
+
+   uint32_t Now()
+   {
+#ifdef ARDUINO
+      return ESP.getCycleCount();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+#endif
+   }
+
+   const char *kUnit =
+#ifdef ARDUINO
+       "cycles";
+#else
+       "ns";
+#endif
+
+   // Old loops, as in led_handler.cpp before fast_math.h
+
+   void WaveFloat(uint16_t n, uint32_t step)
+   {
+      for (uint16_t i = 0; i < n; i++)
+      {
+         float wave = sin(2.0f * PI * ((float)i / kLength + (float)step / 20.0f));
+         pixels[i] = ((wave + 1.0f) / 2.0f) * 255;
+      }
+   }
+
+   void DnaFloat(uint16_t n, uint32_t step)
+   {
+      for (uint16_t i = 0; i < n; i++)
+      {
+         float mix = (sin(2.0f * PI * ((float)i / kLength + (float)step / 20.0f)) + 1.0f) / 2.0f;
+         pixels[i] = 64 + (uint8_t)((255 - 64) * (1.0f - mix));
+      }
+   }
+
+   void PlasmaFloat(uint16_t n, uint32_t step)
+   {
+      for (uint16_t i = 0; i < n; i++)
+      {
+         float v1 = sin((float)i / 3.0f + (float)step / 7.0f);
+         float v2 = sin((float)i / 5.0f - (float)step / 11.0f);
+         float v3 = sin(((float)i + (float)step) / 9.0f);
+         pixels[i] = ((v1 + v2 + v3 + 3.0f) / 6.0f) * 255.0f;
+      }
+   }
+
+   void MeteorFloat(uint16_t n, uint32_t step)
+   {
+      for (uint16_t j = 0; j < n; j += 2 * kLength)
+      {
+         for (uint8_t i = 0; i < kLength; i++)
+         {
+            pixels[(step - i + j + n) % n] = 255 * pow(0.8f, i);
+         }
+      }
+   }
+
+   // The same effects through the kernels of effect_kernels.h that
+   // DrawWave/DrawDna/DrawPlasma/DrawMeteor in led_handler.cpp use
+
+   void WaveFixed(uint16_t n, uint32_t step)
+   {
+      WaveKernel wave(step << 8, kLength);
+      for (uint16_t i = 0; i < n; i++)
+      {
+         pixels[i] = Scale8(255, wave.Next());
+      }
+   }
+
+   void DnaFixed(uint16_t n, uint32_t step)
+   {
+      WaveKernel wave(step << 8, kLength);
+      for (uint16_t i = 0; i < n; i++)
+      {
+         pixels[i] = 64 + Scale8(255 - 64, 255 - wave.Next());
+      }
+   }
+
+   void PlasmaFixed(uint16_t n, uint32_t step)
+   {
+      PlasmaKernel plasma(step << 8);
+      for (uint16_t i = 0; i < n; i++)
+      {
+         pixels[i] = plasma.Next();
+      }
+   }
+
+   void MeteorFixed(uint16_t n, uint32_t step)
+   {
+      for (uint16_t j = 0; j < n; j += 2 * kLength)
+      {
+         for (uint8_t i = 0; i < kLength; i++)
+         {
+            pixels[MeteorPixel(step, j, i, n)] = MeteorTrail(i);
+         }
+      }
+   }
+
+   uint32_t TimeFrame(void (*loop)(uint16_t, uint32_t), uint16_t n)
+   {
+      uint32_t start = Now();
+      for (uint32_t step = 0; step < kFrames; step++)
+      {
+         loop(n, step);
+         sink += pixels[step % n];
+      }
+      return (Now() - start) / kFrames;
+   }
+
+   void Compare(const char *effect, void (*before)(uint16_t, uint32_t), void (*after)(uint16_t, uint32_t))
+   {
+      for (uint16_t n : kStripSizes)
+      {
+         uint32_t old = TimeFrame(before, n);
+         uint32_t now = TimeFrame(after, n);
+
+         char line[96];
+         snprintf(line, sizeof(line), "%-7s %3u LEDs: float %7lu %s, fast_math %6lu %s per frame", effect, n,
+                  (unsigned long)old, kUnit, (unsigned long)now, kUnit);
+         TEST_MESSAGE(line);
+      }
+   }
+}
+
+void test_sin8_matches_sin()
+{
+   for (int theta = 0; theta < 256; theta++)
+   {
+      float expected = 127.5f + 127.5f * sin(2.0f * PI * theta / 256.0f);
+      TEST_ASSERT_FLOAT_WITHIN(1.0f, expected, Sin8(theta));
+   }
+}
+
+void test_fade_curves_match_pow()
+{
+   const uint8_t *curves[] = {kFadeCurve80, kFadeCurve70, kFadeCurve60};
+   const float rates[] = {0.8f, 0.7f, 0.6f};
+   for (size_t c = 0; c < 3; c++)
+   {
+      for (uint8_t i = 0; i < kFadeCurveSize; i++)
+      {
+         TEST_ASSERT_FLOAT_WITHIN(1.0f, 255.0f * pow(rates[c], i), FadeCurve(curves[c], i));
+      }
+   }
+}
+
+void test_blend8_ends()
+{
+   for (int v = 0; v < 256; v += 15)
+   {
+      TEST_ASSERT_EQUAL_UINT8(v, Blend8(v, 200, 0));
+      TEST_ASSERT_EQUAL_UINT8(v, Blend8(200, v, 255));
+   }
+}
+
+void test_benchmark_effect_loops()
+{
+   Compare("Wave", WaveFloat, WaveFixed);
+   Compare("DNA", DnaFloat, DnaFixed);
+   Compare("Plasma", PlasmaFloat, PlasmaFixed);
+   Compare("Meteor", MeteorFloat, MeteorFixed);
+}
+
+int RunTests()
+{
+   UNITY_BEGIN();
+   RUN_TEST(test_sin8_matches_sin);
+   RUN_TEST(test_fade_curves_match_pow);
+   RUN_TEST(test_blend8_ends);
+   RUN_TEST(test_benchmark_effect_loops);
+   return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup()
+{
+   delay(2000); // let the test runner open the serial port
+   RunTests();
+}
+
+void loop()
+{
+}
+#else
+int main()
+{
+   return RunTests();
+}
+#endif
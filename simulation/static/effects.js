@@ -0,0 +1,28 @@
+// Generated by nano/generate_effects.py from nano/effects.json - do not edit
+export const EFFECTS = [
+   { id: 0x20, key: 'SOLID', name: 'Solid', speed: 50, length: 0 },
+   { id: 0x21, key: 'BLINK', name: 'Blink', speed: 50, length: 0 },
+   { id: 0x23, key: 'RAINBOW', name: 'Rainbow', speed: 50, length: 0 },
+   { id: 0x24, key: 'RAINBOW_CYCLE', name: 'Rainbow Cycle', speed: 50, length: 0 },
+   { id: 0x25, key: 'CHASE', name: 'Chase', speed: 50, length: 3 },
+   { id: 0x26, key: 'THEATER_CHASE', name: 'Theater Chase', speed: 50, length: 0 },
+   { id: 0x27, key: 'TWINKLE', name: 'Twinkle', speed: 50, length: 10 },
+   { id: 0x29, key: 'FIRE', name: 'Fire', speed: 50, length: 0 },
+   { id: 0x2A, key: 'PULSE', name: 'Pulse', speed: 50, length: 40 },
+   { id: 0x2C, key: 'GRADIENT', name: 'Gradient', speed: 50, length: 0 },
+   { id: 0x2D, key: 'WAVE', name: 'Wave', speed: 50, length: 10 },
+   { id: 0x2E, key: 'METEOR', name: 'Meteor', speed: 50, length: 4 },
+   { id: 0x30, key: 'DNA', name: 'DNA Helix', speed: 50, length: 10 },
+   { id: 0x31, key: 'BOUNCE', name: 'Bounce', speed: 50, length: 3 },
+   { id: 0x32, key: 'COLOR_WIPE', name: 'Color Wipe', speed: 50, length: 0 },
+   { id: 0x33, key: 'SCANNER', name: 'Scanner', speed: 50, length: 5 },
+   { id: 0x34, key: 'CONFETTI', name: 'Confetti', speed: 50, length: 0 },
+   { id: 0x35, key: 'LIGHTNING', name: 'Lightning', speed: 50, length: 8 },
+   { id: 0x36, key: 'POLICE', name: 'Police', speed: 50, length: 0 },
+   { id: 0x37, key: 'STACKING', name: 'Stacking', speed: 50, length: 0 },
+   { id: 0x38, key: 'MARQUEE', name: 'Marquee', speed: 50, length: 5 },
+   { id: 0x39, key: 'RIPPLE', name: 'Ripple', speed: 50, length: 3 },
+   { id: 0x3A, key: 'PLASMA', name: 'Plasma', speed: 50, length: 0 },
+]
+
+export const EFFECT_BY_ID = Object.fromEntries(EFFECTS.map(effect => [effect.id, effect]))